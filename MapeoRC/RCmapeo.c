@@ -6,177 +6,920 @@
 #include <stdio.h>
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
-#include "hardware/pwm.h"
 #include "control_pid.h"
+#include "rc_capture.h"
+#include "servo_out.h"
+#include "scheduler.h"
+#include "seqlock.h"
+#include "fast_math.h"
+#include "i2c_async.h"
+#include "accel_stream.h"
+#include "cic_decimator.h"
+#include "ahrs.h"
+#include "cycle_counter.h"
+#include "telemetry.h"
+#include "dlog.h"
+#include "blackbox.h"
+#if FLIGHT_MULTICORE || BLACKBOX
+#include "pico/multicore.h"
+#endif
 
-// Pines al que se conecta la señal PWM
-#define PWM_Cn1 0   ///< Dirección
-#define PWM_Cn2 1   ///< Elevación
-#define PWM_Cn4 2   ///< Alas
-#define PWM_Cn6 3   ///< Switch control
-
-// Pines al que se conecta la señal PWM saliente
-#define PWM_OUT1 4  ///< Dirección d
-#define PWM_OUT2 5  ///< Dirección t
-#define PWM_OUT3 6  ///< Elevación
-#define PWM_OUT4 7  ///< Ala derecha
-#define PWM_OUT5 8  ///< Ala izquierda
-
-/**
- * @brief Mide el ciclo de trabajo de la señal PWM en el pin especificado.
- * 
- * @param gpio Pin GPIO al cual se conecta la señal PWM.
- * @return Ciclo de trabajo en porcentaje.
- */
-float measure_duty_cycle(uint gpio) {
-    absolute_time_t t1, t2, t3, t4;
-    uint32_t high_time, low_time;
-    float duty_cycle;
-
-    // Espera a que la señal sea alta
-    while (!gpio_get(gpio));
-
-    // Marca el tiempo de inicio del pulso alto
-    t1 = get_absolute_time();
-    
-    // Espera a que la señal sea baja
-    while (gpio_get(gpio));
-    
-    // Marca el tiempo de fin del pulso alto y comienzo del pulso bajo
-    t2 = get_absolute_time();
-
-    // Espera a que la señal sea alta nuevamente
-    while (!gpio_get(gpio));
-    
-    // Marca el tiempo de fin del pulso bajo
-    t3 = get_absolute_time();
-
-    // Calcula el tiempo en alto y en bajo
-    high_time = absolute_time_diff_us(t1, t2);
-    low_time = absolute_time_diff_us(t2, t3);
-
-    // Calcula el ciclo de trabajo
-    duty_cycle = (float)high_time / (high_time + low_time) * 100.0f;
-
-    return duty_cycle;
+// Estimadores de actitud
+#define ATTITUDE_ACCEL 0    ///< Pitch del acelerómetro suavizado con el filtro de Kalman de un estado
+#define ATTITUDE_GYRO 1     ///< Giróscopo integrado y corregido con el acelerómetro (ángulo + sesgo)
+#define ATTITUDE_AHRS 2     ///< Cuaternión de Madgwick con acelerómetro, giróscopo y magnetómetro
+
+#ifndef ATTITUDE_ESTIMATOR
+#define ATTITUDE_ESTIMATOR ATTITUDE_ACCEL ///< Estimador de actitud usado por el lazo de control
+#endif
+
+#ifndef CONTROL_CASCADE
+#define CONTROL_CASCADE 0   ///< 1 para el lazo de ángulo en cascada con un lazo de velocidad más rápido
+#endif
+
+#if CONTROL_CASCADE && ATTITUDE_ESTIMATOR == ATTITUDE_ACCEL
+#error "CONTROL_CASCADE necesita el giróscopo: usa ATTITUDE_ESTIMATOR GYRO o AHRS"
+#endif
+
+#ifndef CONTROL_INCREMENTAL_PID
+#define CONTROL_INCREMENTAL_PID 0 ///< 1 para el lazo de ángulo con PID incremental de coeficientes fijos
+#endif
+
+#if CONTROL_INCREMENTAL_PID && CONTROL_CASCADE
+#error "CONTROL_INCREMENTAL_PID es para el lazo único: no se combina con CONTROL_CASCADE"
+#endif
+
+#define PITCH_KALMAN_Q 1.0f     ///< Variancia del proceso del pitch por segundo (0.01 por paso a 100 Hz)
+#define PITCH_KALMAN_R 0.1f     ///< Variancia del pitch medido con el acelerómetro
+#define GYRO_PITCH_SIGN 1.0f    ///< Signo del eje Y del giróscopo respecto al pitch del acelerómetro
+#define GYRO_CALIBRATION_SAMPLES 100 ///< Muestras promediadas al arrancar para el sesgo inicial
+#define DEG_TO_RAD 0.0174532925f     ///< Conversión de grados a radianes
+
+// Frecuencia de cada grupo de tareas
+#ifndef RATE_CONTROL_HZ
+#define RATE_CONTROL_HZ 100     ///< Lectura del sensor, filtro de Kalman y PID
+#endif
+#define RATE_RC_HZ 50           ///< Lectura del receptor (una trama RC)
+#define RATE_SERVO_HZ 50        ///< Publicación de las salidas (una trama PWM)
+#define RATE_TELEMETRY_HZ 10    ///< Mensajes por USB
+
+_Static_assert(SCHEDULER_RATE_VALID(RATE_CONTROL_HZ), "RATE_CONTROL_HZ debe dividir la frecuencia del tic base");
+_Static_assert(SCHEDULER_RATE_VALID(RATE_RC_HZ), "RATE_RC_HZ debe dividir la frecuencia del tic base");
+_Static_assert(SCHEDULER_RATE_VALID(RATE_SERVO_HZ), "RATE_SERVO_HZ debe dividir la frecuencia del tic base");
+_Static_assert(SCHEDULER_RATE_VALID(RATE_TELEMETRY_HZ), "RATE_TELEMETRY_HZ debe dividir la frecuencia del tic base");
+
+/// Ejecuciones del lazo por cada lectura del magnetómetro (no da muestras nuevas más deprisa)
+#define MAG_READ_DIVIDER ((RATE_CONTROL_HZ + HMC5883L_ODR_HZ - 1) / HMC5883L_ODR_HZ)
+
+// Ganancias y límites de los ejes; la salida se escala a us con CONTROL_US_PER_UNIT
+#define PID_KP 1.0f             ///< Ganancia proporcional
+#define PID_KI 0.1f             ///< Ganancia integral
+#define PID_KD 0.05f            ///< Ganancia derivativa
+#define PID_OUTPUT_LIMIT 15.0f  ///< +-300 us: lo que admiten las dos alas alrededor de su centro
+#define CONTROL_US_PER_UNIT 20.0f ///< us de pulso por unidad de salida del PID
+#define ROLL_MIX_SIGN 1         ///< Sentido del alabeo en la mezcla diferencial de las alas
+#define WING_RIGHT_CENTER_US 1800 ///< Ala derecha con salida nula del control
+#define WING_LEFT_CENTER_US 1500  ///< Ala izquierda con salida nula del control
+
+/// Periodo nominal entre medidas del pitch: el de las salidas del decimador o el del lazo
+#if ACCEL_MODE != ACCEL_MODE_POLL
+#define PITCH_SAMPLE_US (1000000u * ACCEL_DECIMATION / ACCEL_ODR_HZ)
+#else
+#define PITCH_SAMPLE_US (1000000u / RATE_CONTROL_HZ)
+#endif
+
+/// El PID incremental avanza una vez por cada salida del decimador cuando el acelerómetro llega
+/// por interrupción: las ráfagas del FIFO traen varias muestras en una misma ejecución del lazo
+#define PID_PER_SAMPLE (CONTROL_INCREMENTAL_PID && ATTITUDE_ESTIMATOR == ATTITUDE_ACCEL && \
+                        ACCEL_MODE != ACCEL_MODE_POLL)
+
+/// Frecuencia a la que el PID recibe medidas nuevas: la de las muestras con PID_PER_SAMPLE
+#if PID_PER_SAMPLE
+#define PID_UPDATE_HZ ((float)ACCEL_ODR_HZ / ACCEL_DECIMATION)
+#else
+#define PID_UPDATE_HZ RATE_CONTROL_HZ
+#endif
+
+// Cascada ángulo/velocidad: el lazo externo de ángulo (RATE_CONTROL_HZ) manda una velocidad
+// al lazo interno del giróscopo, que corre CASCADE_INNER_RATIO veces más rápido y mueve las alas.
+// El periodo interno sale del externo en tics base, así que la relación tiene que dividirlo:
+// con el lazo externo a 100 Hz (10 tics) valen 1, 2, 5 y 10
+#ifndef CASCADE_INNER_RATIO
+#define CASCADE_INNER_RATIO 5           ///< Ejecuciones del lazo interno por cada una del externo
+#endif
+#define INNER_PERIOD_TICKS (SCHEDULER_PERIOD_TICKS(RATE_CONTROL_HZ) / CASCADE_INNER_RATIO)
+#define RATE_INNER_HZ SCHEDULER_RATE_FROM_TICKS(INNER_PERIOD_TICKS) ///< Frecuencia del lazo de velocidad
+
+#if CONTROL_CASCADE
+_Static_assert(CASCADE_INNER_RATIO > 0 && SCHEDULER_PERIOD_TICKS(RATE_CONTROL_HZ) % CASCADE_INNER_RATIO == 0,
+               "CASCADE_INNER_RATIO debe dividir el periodo en tics del lazo de control");
+#endif
+
+#define ANGLE_KP 4.0f                   ///< grados/s pedidos por grado de error
+#define ANGLE_RATE_LIMIT 150.0f         ///< Máxima velocidad pedida por el lazo externo, grados/s
+#define RATE_KP 0.15f                   ///< Ganancia proporcional del lazo de velocidad
+#define RATE_KI 0.1f                    ///< Ganancia integral del lazo de velocidad
+#define RATE_KD 0.003f                  ///< Ganancia derivativa del lazo de velocidad
+#define RATE_D_CUTOFF_HZ 30.0f          ///< Corte del filtro de la derivada del lazo de velocidad
+
+// Los pulsos se manejan en us sobre la trama de 20 ms (1 % de ciclo de trabajo = 200 us)
+#define SERVO_CENTER_US 1660 ///< Centro de los canales invertidos (8.3 %)
+#define RC_NEUTRAL_US 1500   ///< Pulso de palanca centrada con el que se fijan las salidas sin receptor
+
+/**
+ * @brief Instantánea del receptor, publicada por la tarea RC.
+ */
+typedef struct {
+    int32_t pulse[RC_CAPTURE_CHANNELS]; ///< Últimos pulsos del receptor en us
+    bool stabilize;                     ///< Modo de estabilización seleccionado por el switch
+} RcSnapshot;
+
+/**
+ * @brief Instantánea del lazo de control, publicada por la tarea de control.
+ */
+typedef struct {
+    int32_t wing_right_us;  ///< Pulso del ala derecha
+    int32_t wing_left_us;   ///< Pulso del ala izquierda
+    bool valid;             ///< Hay al menos una salida calculada
+} ControlSnapshot;
+
+static Scheduler scheduler;         ///< Control y telemetría (núcleo 0)
+#if FLIGHT_MULTICORE
+static Scheduler io_scheduler;      ///< Receptor y servos (núcleo 1)
+static SchedulerTask *task_servo_info;
+#endif
+static SchedulerTask *task_control_info;
+
+static KalmanFilter kalman_filter;
+static int32_t accel_last[3];       ///< Última muestra (o salida decimada) del acelerómetro
+#if ATTITUDE_ESTIMATOR == ATTITUDE_GYRO
+static AngleKalman angle_filter;
+#elif ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+static Ahrs ahrs;
+static AhrsEuler attitude;          ///< Última orientación en grados
+static float gyro_bias[3];          ///< Sesgo del giróscopo medido al arrancar, grados/s
+static int16_t mag_last[3];         ///< Última muestra del magnetómetro
+static uint32_t ahrs_cycles;        ///< Ciclos de la última actualización del AHRS
+static uint32_t ahrs_cycles_max;    ///< Máximo de ciclos por actualización
+#endif
+#if CONTROL_INCREMENTAL_PID
+static PIDIncremental pid_axes[PID_BANK_MAX_AXES]; ///< Un controlador por ángulo estabilizado
+static float pid_output[PID_BANK_MAX_AXES];        ///< Última salida de cada eje
+static uint32_t pid_num_axes;
+#else
+static PIDBank pid_bank;            ///< Un eje por ángulo estabilizado
+#endif
+#if CONTROL_CASCADE
+static PIDBank rate_bank;           ///< Lazo interno: un eje de velocidad por cada eje de ángulo
+static SchedulerTask *task_rate_info;
+#endif
+static int axis_pitch;
+#if ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+static int axis_roll;
+#endif
+#if ATTITUDE_ESTIMATOR != ATTITUDE_ACCEL
+static float pitch_rate, roll_rate; ///< Velocidades sin sesgo, grados/s
+#endif
+static float pitch, filtered_pitch, control_signal;
+#if ACCEL_MODE != ACCEL_MODE_POLL
+static CicDecimator accel_decimator;
+static uint32_t sensor_latency_us; ///< Edad de la última muestra al pasar por el filtro
+#endif
+
+/// Configuración del acelerómetro elegida al compilar
+static const Adxl345Config accel_config = {
+    .odr_hz = ACCEL_ODR_HZ,
+    .range_g = ACCEL_RANGE_G,
+    .full_res = true,
+};
+
+static SeqLock rc_lock;
+static RcSnapshot rc_shared;
+static SeqLock control_lock;
+static ControlSnapshot control_shared;
+
+/// Modo de estabilización visto por el lado de entradas/salidas
+static bool io_stabilize;
+
+/**
+ * @brief Lee la última instantánea del receptor.
+ *
+ * @param out Copia de la instantánea.
+ */
+static void rc_snapshot_read(RcSnapshot *out) {
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&rc_lock);
+        *out = rc_shared;
+    } while (seqlock_read_retry(&rc_lock, seq));
 }
 
 /**
- * @brief Configura el pin GPIO para generar una señal PWM con el ciclo de trabajo especificado.
- * 
- * @param gpio Pin GPIO al cual se generará la señal PWM.
- * @param duty_cycle Ciclo de trabajo en porcentaje.
+ * @brief Lee la última instantánea del lazo de control.
+ *
+ * @param out Copia de la instantánea.
  */
-void setup_pwm(uint gpio, float duty_cycle) {
-    switch (gpio) {
-        case 7:
-            if(duty_cycle < 7.0) {
-                duty_cycle = 7.0;
-            } else if(duty_cycle > 10.5) {
-                duty_cycle = 10.5;
-            }
-            break;
-        case 8:
-            if(duty_cycle < 6.0) {
-                duty_cycle = 6.0;
-            } else if(duty_cycle > 9.5) {
-                duty_cycle = 9.5;
+static void control_snapshot_read(ControlSnapshot *out) {
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&control_lock);
+        *out = control_shared;
+    } while (seqlock_read_retry(&control_lock, seq));
+}
+
+/**
+ * @brief Tarea del receptor: lee los canales, actualiza las salidas manuales y el modo.
+ *
+ * @param dt Tiempo desde la ejecución anterior, en segundos.
+ */
+static void task_rc(float dt) {
+    RcSnapshot rc;
+    rc.pulse[0] = rc_capture_pulse_us(PWM_Cn1);
+    rc.pulse[1] = rc_capture_pulse_us(PWM_Cn2);
+    rc.pulse[2] = rc_capture_pulse_us(PWM_Cn4);
+    rc.pulse[3] = rc_capture_pulse_us(PWM_Cn6);
+
+    // Sin tramas recientes en todos los canales (antes de enlazar o tras perder la señal) las
+    // superficies van a la posición de palanca centrada y las alas a su centro, sin estabilizar
+    static bool rc_failsafe;
+    bool failsafe = !rc_capture_valid(PWM_Cn1) || !rc_capture_valid(PWM_Cn2) || !rc_capture_valid(PWM_Cn4) ||
+                    !rc_capture_valid(PWM_Cn6);
+    if (failsafe != rc_failsafe) {
+        DLOG("Receptor sin señal %d: salidas neutras hasta la siguiente trama", failsafe);
+    }
+    rc_failsafe = failsafe;
+    if (failsafe) {
+        servo_out_set_us(PWM_OUT1, RC_NEUTRAL_US - 120);
+        servo_out_set_us(PWM_OUT2, 2 * SERVO_CENTER_US - RC_NEUTRAL_US);
+        servo_out_set_us(PWM_OUT3, RC_NEUTRAL_US + 200);
+        servo_out_set_us(PWM_OUT4, WING_RIGHT_CENTER_US);
+        servo_out_set_us(PWM_OUT5, WING_LEFT_CENTER_US);
+        rc.stabilize = false;
+    } else {
+        int32_t pulse3 = 2 * SERVO_CENTER_US - rc.pulse[2];
+        servo_out_set_us(PWM_OUT1, rc.pulse[0] - 120);
+        servo_out_set_us(PWM_OUT2, 2 * SERVO_CENTER_US - rc.pulse[0]);
+        servo_out_set_us(PWM_OUT3, rc.pulse[1] + 200);
+
+        rc.stabilize = rc.pulse[3] < 1800 && (pulse3 < 1700 && pulse3 > 1620);
+        if (rc.stabilize != io_stabilize) {
+            DLOG("Estabilización %d (Cn4 %ld us, Cn6 %ld us)", rc.stabilize, (long)rc.pulse[2], (long)rc.pulse[3]);
+        }
+        if (!rc.stabilize) {
+            servo_out_set_us(PWM_OUT4, pulse3 + 100);
+            servo_out_set_us(PWM_OUT5, pulse3 - 180);
+        }
+    }
+    io_stabilize = rc.stabilize;
+
+    seqlock_write_begin(&rc_lock);
+    rc_shared = rc;
+    seqlock_write_end(&rc_lock);
+}
+
+/**
+ * @brief Pasa una muestra del acelerómetro al estimador de actitud.
+ *
+ * @param accX Valor del eje X (cuentas o salida del decimador).
+ * @param accY Valor del eje Y.
+ * @param accZ Valor del eje Z.
+ * @param timestamp_us Instante de adquisición de la muestra.
+ * @return Verdadero si el estimador actualizó el pitch filtrado.
+ */
+static bool attitude_accel_update(int32_t accX, int32_t accY, int32_t accZ, uint32_t timestamp_us) {
+    calculate_pitch(accX, accY, accZ, &pitch);
+    accel_last[0] = accX;
+    accel_last[1] = accY;
+    accel_last[2] = accZ;
+#if ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+    // El AHRS avanza con el giróscopo; el acelerómetro solo guarda la referencia de gravedad
+    return false;
+#elif ATTITUDE_ESTIMATOR == ATTITUDE_GYRO
+    filtered_pitch = angle_kalman_correct(&angle_filter, pitch + 3.0f);
+    return true;
+#else
+    // Predice hasta el instante de la muestra y corrige; una muestra ya fusionada no vuelve a corregir
+    if (!kalman_correct(&kalman_filter, pitch + 3.0f, timestamp_us)) {
+        return false;
+    }
+    filtered_pitch = kalman_estimate(&kalman_filter);
+    return true;
+#endif
+}
+
+#if ATTITUDE_ESTIMATOR != ATTITUDE_ACCEL
+/**
+ * @brief Toma la última muestra del giróscopo, avanza el estimador y lanza la siguiente lectura.
+ *
+ * @param dt Tiempo desde la muestra anterior, en segundos.
+ * @return Verdadero si había una muestra nueva.
+ */
+static bool attitude_gyro_update(float dt) {
+    int16_t gyroX, gyroY, gyroZ;
+    bool sample = read_gyro_result(&gyroX, &gyroY, &gyroZ);
+    read_gyro_start();
+
+#if ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+    // Cada muestra del giróscopo avanza el cuaternión con la última referencia del
+    // acelerómetro y del magnetómetro, leídos a su propio ritmo
+    static uint32_t mag_divider;
+    read_magnetometer_result(&mag_last[0], &mag_last[1], &mag_last[2]);
+    if (++mag_divider >= MAG_READ_DIVIDER) {
+        mag_divider = 0;
+        read_magnetometer_start();
+    }
+    if (!sample) {
+        return false;
+    }
+
+    roll_rate = gyroX / ITG3205_LSB_PER_DPS - gyro_bias[0];
+    pitch_rate = GYRO_PITCH_SIGN * (gyroY / ITG3205_LSB_PER_DPS - gyro_bias[1]);
+    float yaw_rate = gyroZ / ITG3205_LSB_PER_DPS - gyro_bias[2];
+
+    uint32_t start = cycle_counter_now();
+    ahrs_update(&ahrs, roll_rate * DEG_TO_RAD, GYRO_PITCH_SIGN * pitch_rate * DEG_TO_RAD, yaw_rate * DEG_TO_RAD,
+                accel_last[0], accel_last[1], accel_last[2], mag_last[0], mag_last[1], mag_last[2], dt);
+    ahrs_get_euler(&ahrs, &attitude);
+    ahrs_cycles = cycle_counter_elapsed(start, cycle_counter_now());
+    ahrs_cycles_max = MAX(ahrs_cycles_max, ahrs_cycles);
+    filtered_pitch = attitude.pitch + 3.0f;
+#else
+    if (!sample) {
+        return false;
+    }
+
+    filtered_pitch = angle_kalman_predict(&angle_filter, GYRO_PITCH_SIGN * gyroY / ITG3205_LSB_PER_DPS, dt);
+    pitch_rate = angle_filter.rate;
+    roll_rate = 0.0f;
+#endif
+    return true;
+}
+#endif
+
+#if BLACKBOX
+/**
+ * @brief Guarda una salida del controlador en el registro de vuelo.
+ *
+ * Los valores en coma flotante se guardan en centésimas o milésimas para que las
+ * diferencias entre registros consecutivos ocupen pocos bytes.
+ *
+ * @param output Salida de cada eje de la banca.
+ * @param wing_right_us Pulso del ala derecha.
+ * @param wing_left_us Pulso del ala izquierda.
+ */
+static void control_record(const float *output, int32_t wing_right_us, int32_t wing_left_us) {
+    RcSnapshot rc;
+    rc_snapshot_read(&rc);
+    int32_t fields[BLACKBOX_FIELDS];
+    fields[BB_TIMESTAMP_US] = (int32_t)time_us_32();
+    for (int i = 0; i < 4; i++) {
+        fields[BB_RC_CN1 + i] = rc.pulse[i];
+    }
+    for (int i = 0; i < 3; i++) {
+        fields[BB_ACCEL_X + i] = accel_last[i];
+    }
+    fields[BB_PITCH_CDEG] = (int32_t)(pitch * 100.0f);
+    fields[BB_FILTERED_CDEG] = (int32_t)(filtered_pitch * 100.0f);
+
+    // Términos del eje de pitch del controlador que mueve las alas; el incremental no los separa
+#if CONTROL_INCREMENTAL_PID
+    fields[BB_P_TERM_MILLI] = 0;
+    fields[BB_I_TERM_MILLI] = 0;
+    fields[BB_D_TERM_MILLI] = 0;
+#else
+#if CONTROL_CASCADE
+    const PIDBank *bank = &rate_bank;
+#else
+    const PIDBank *bank = &pid_bank;
+#endif
+    fields[BB_P_TERM_MILLI] = (int32_t)(bank->kp[axis_pitch] * bank->previous_error[axis_pitch] * 1000.0f);
+    fields[BB_I_TERM_MILLI] = (int32_t)(bank->ki[axis_pitch] * bank->integral[axis_pitch] * 1000.0f);
+    fields[BB_D_TERM_MILLI] = (int32_t)(bank->kd[axis_pitch] * bank->derivative[axis_pitch] * 1000.0f);
+#endif
+    fields[BB_OUTPUT_PITCH_MILLI] = (int32_t)(output[axis_pitch] * 1000.0f);
+#if ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+    fields[BB_OUTPUT_ROLL_MILLI] = (int32_t)(output[axis_roll] * 1000.0f);
+#else
+    fields[BB_OUTPUT_ROLL_MILLI] = 0;
+#endif
+    fields[BB_WING_RIGHT_US] = wing_right_us;
+    fields[BB_WING_LEFT_US] = wing_left_us;
+    blackbox_record(fields);
+}
+
+#endif
+
+/**
+ * @brief Publica la salida de los controladores como pulsos de las alas.
+ *
+ * El pitch mueve las dos alas en el mismo sentido y el alabeo en sentidos opuestos.
+ *
+ * @param output Salida de cada eje de la banca.
+ */
+static void control_publish(const float *output) {
+    int32_t control_us = (int32_t)(output[axis_pitch] * CONTROL_US_PER_UNIT);
+    int32_t roll_us = 0;
+#if ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+    roll_us = ROLL_MIX_SIGN * (int32_t)(output[axis_roll] * CONTROL_US_PER_UNIT);
+#endif
+    int32_t wing_right_us = control_us + roll_us + WING_RIGHT_CENTER_US;
+    int32_t wing_left_us = control_us - roll_us + WING_LEFT_CENTER_US;
+    seqlock_write_begin(&control_lock);
+    control_shared.wing_right_us = wing_right_us;
+    control_shared.wing_left_us = wing_left_us;
+    control_shared.valid = true;
+    seqlock_write_end(&control_lock);
+
+#if TELEMETRY_BINARY
+    // Una trama por salida del controlador: solo copias, sin formatear nada en el lazo
+    RcSnapshot rc;
+    rc_snapshot_read(&rc);
+    TelemetryControl frame;
+    frame.timestamp_us = time_us_32();
+    for (int i = 0; i < 3; i++) {
+        frame.accel[i] = accel_last[i];
+    }
+    for (int i = 0; i < 4; i++) {
+        frame.rc_pulse[i] = (int16_t)rc.pulse[i];
+    }
+    frame.pitch = pitch;
+    frame.filtered_pitch = filtered_pitch;
+    frame.output_pitch = output[axis_pitch];
+#if ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+    frame.output_roll = output[axis_roll];
+#else
+    frame.output_roll = 0.0f;
+#endif
+    frame.wing_right_us = (int16_t)wing_right_us;
+    frame.wing_left_us = (int16_t)wing_left_us;
+    frame.flags = TELEMETRY_FLAG_STABILIZE | (CONTROL_CASCADE ? TELEMETRY_FLAG_CASCADE : 0);
+    telemetry_send(TELEMETRY_TYPE_CONTROL, &frame, sizeof(frame));
+#endif
+
+#if BLACKBOX
+    control_record(output, wing_right_us, wing_left_us);
+#endif
+}
+
+#if CONTROL_INCREMENTAL_PID
+/**
+ * @brief Transferencia sin saltos al entrar en estabilización.
+ *
+ * Deshace la mezcla de control_publish() sobre la posición manual de las alas para
+ * que los controladores arranquen desde donde el piloto las dejó.
+ *
+ * @param rc Instantánea del receptor.
+ */
+static void control_bumpless_start(const RcSnapshot *rc) {
+    int32_t pulse3 = 2 * SERVO_CENTER_US - rc->pulse[2];
+    float right = (pulse3 + 100 - WING_RIGHT_CENTER_US) / CONTROL_US_PER_UNIT;
+    float left = (pulse3 - 180 - WING_LEFT_CENTER_US) / CONTROL_US_PER_UNIT;
+    pid_incremental_reset(&pid_axes[axis_pitch], 0.5f * (right + left));
+#if ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+    pid_incremental_reset(&pid_axes[axis_roll], ROLL_MIX_SIGN * 0.5f * (right - left));
+#endif
+}
+#endif
+
+/**
+ * @brief Tarea de control: lee los sensores, estima el pitch y calcula el PID.
+ *
+ * @param dt Tiempo medido desde la ejecución anterior, en segundos.
+ */
+static void task_control(float dt) {
+    RcSnapshot rc;
+    rc_snapshot_read(&rc);
+
+#if CONTROL_INCREMENTAL_PID
+    static bool was_stabilized;
+    if (rc.stabilize && !was_stabilized) {
+        control_bumpless_start(&rc);
+    }
+    was_stabilized = rc.stabilize;
+#else
+    // Al volver a estabilizar el PID arranca de cero: ni la integral ni la medida anterior
+    // de la última vez que se cerró el lazo
+    static bool was_stabilized;
+    if (rc.stabilize && !was_stabilized) {
+        pid_bank_reset(&pid_bank);
+    }
+    was_stabilized = rc.stabilize;
+
+    // Tiempo real desde la última actualización del PID: el lazo puede correr más deprisa
+    // que el sensor y el PID solo avanza con medidas nuevas
+    static float pid_dt;
+    pid_dt = rc.stabilize ? pid_dt + dt : 0.0f;
+#endif
+
+#if ACCEL_MODE == ACCEL_MODE_POLL
+    if (!rc.stabilize) {
+        return;
+    }
+#endif
+
+    bool updated = false;
+
+#if ATTITUDE_ESTIMATOR != ATTITUDE_ACCEL && !CONTROL_CASCADE
+    // El giróscopo se integra en cada ejecución: el PID ve el pitch con la latencia de una
+    // lectura aunque el acelerómetro llegue más despacio o decimado
+    if (rc.stabilize) {
+        updated = attitude_gyro_update(dt);
+    }
+#endif
+
+#if ACCEL_MODE != ACCEL_MODE_POLL
+    // Pasa todas las muestras llegadas desde la ejecución anterior por el decimador y cada
+    // salida por el filtro; fuera del modo de estabilización se descartan para no acumularlas
+    AccelSample sample;
+    while (accel_stream_pop(&sample)) {
+        int16_t raw[CIC_AXES] = {sample.x, sample.y, sample.z};
+        int32_t acc[CIC_AXES];
+        if (cic_push(&accel_decimator, raw, acc) && rc.stabilize) {
+            bool fused = attitude_accel_update(acc[0], acc[1], acc[2], sample.timestamp_us);
+            updated |= fused;
+            sensor_latency_us = time_us_32() - sample.timestamp_us;
+#if PID_PER_SAMPLE
+            // Coeficientes calculados para el periodo entre muestras: un paso por muestra fusionada,
+            // y de una ráfaga solo se publica la última salida
+            if (fused) {
+                pid_output[axis_pitch] = pid_incremental_update(&pid_axes[axis_pitch], filtered_pitch);
             }
-            break;
-        default:
-            break;
+#endif
+        }
+    }
+#else
+    // Toma la muestra leída por DMA durante el periodo anterior y lanza ya la siguiente,
+    // de modo que el bus trabaja mientras se calculan el filtro y el PID
+    int16_t accX, accY, accZ;
+    if (read_accelerometer_result(&accX, &accY, &accZ)) {
+        updated |= attitude_accel_update(accX, accY, accZ, read_accelerometer_timestamp_us());
+    }
+    read_accelerometer_start();
+#endif
+
+#if CONTROL_CASCADE
+    // El lazo interno ya mantiene el ángulo al día con el giróscopo: el externo corre siempre
+    if (!rc.stabilize) {
+        return;
+    }
+#else
+    if (!updated) {
+        return;
+    }
+#endif
+
+    float measured[PID_BANK_MAX_AXES];
+    measured[axis_pitch] = filtered_pitch;
+#if ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+    measured[axis_roll] = attitude.roll;
+#endif
+#if CONTROL_INCREMENTAL_PID
+    // Coeficientes fijos para PID_UPDATE_HZ: sin multiplicar ni dividir por dt
+#if !PID_PER_SAMPLE
+    for (uint32_t i = 0; i < pid_num_axes; i++) {
+        pid_output[i] = pid_incremental_update(&pid_axes[i], measured[i]);
+    }
+#endif
+    control_signal = pid_output[axis_pitch];
+    control_publish(pid_output);
+#else
+    // Calcula la señal de control de todos los ejes en una pasada con el dt medido
+    pid_bank_update(&pid_bank, measured, pid_dt);
+    pid_dt = 0.0f;
+
+#if CONTROL_CASCADE
+    // La salida del lazo de ángulo es la velocidad pedida al lazo interno
+    for (uint32_t i = 0; i < pid_bank.num_axes; i++) {
+        rate_bank.setpoint[i] = pid_bank.output[i];
+    }
+#else
+    control_signal = pid_bank.output[axis_pitch];
+    control_publish(pid_bank.output);
+#endif
+#endif
+}
+
+#if CONTROL_CASCADE
+/**
+ * @brief Lazo interno de la cascada: integra el giróscopo y controla la velocidad angular.
+ *
+ * @param dt Tiempo medido desde la ejecución anterior, en segundos.
+ */
+static void task_rate(float dt) {
+    RcSnapshot rc;
+    rc_snapshot_read(&rc);
+
+    // Corre antes que el lazo externo: al volver a estabilizar pide velocidad nula hasta
+    // que este calcule la suya, sin estado de la vez anterior
+    static bool was_stabilized;
+    if (rc.stabilize && !was_stabilized) {
+        pid_bank_reset(&rate_bank);
+        for (uint32_t i = 0; i < rate_bank.num_axes; i++) {
+            rate_bank.setpoint[i] = 0.0f;
+        }
+    }
+    was_stabilized = rc.stabilize;
+
+    if (!rc.stabilize || !attitude_gyro_update(dt)) {
+        return;
+    }
+
+    float measured[PID_BANK_MAX_AXES];
+    measured[axis_pitch] = pitch_rate;
+#if ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+    measured[axis_roll] = roll_rate;
+#endif
+    pid_bank_update(&rate_bank, measured, dt);
+    control_signal = rate_bank.output[axis_pitch];
+    control_publish(rate_bank.output);
+}
+#endif
+
+/**
+ * @brief Tarea de salidas: aplica la última salida del control y publica la trama de servos.
+ *
+ * @param dt Tiempo desde la ejecución anterior, en segundos.
+ */
+static void task_servo(float dt) {
+    if (io_stabilize) {
+        ControlSnapshot control;
+        control_snapshot_read(&control);
+        if (control.valid) {
+            servo_out_set_us(PWM_OUT4, control.wing_right_us);
+            servo_out_set_us(PWM_OUT5, control.wing_left_us);
+        }
     }
-    
-    // Configura el pin PWM
-    gpio_set_function(gpio, GPIO_FUNC_PWM);
+    servo_out_publish();
+}
 
-    // Obtén el slice del PWM para el pin
-    uint slice_num = pwm_gpio_to_slice_num(gpio);
+/**
+ * @brief Tarea de telemetría: envía el estado por USB fuera del lazo de control.
+ *
+ * @param dt Tiempo desde la ejecución anterior, en segundos.
+ */
+static void task_telemetry(float dt) {
+    RcSnapshot rc;
+    rc_snapshot_read(&rc);
 
-    // Configura el PWM con un divisor ajustado para obtener la frecuencia deseada
-    float clkdiv = 38.146;  // Divisor calculado para 50 Hz
-    pwm_set_clkdiv(slice_num, clkdiv);
+#if TELEMETRY_BINARY
+    TelemetryStatus status;
+    status.timestamp_us = time_us_32();
+    for (int i = 0; i < 4; i++) {
+        status.rc_pulse[i] = (int16_t)rc.pulse[i];
+    }
+    status.control_dt = task_control_info->dt;
+    status.control_max_us = task_control_info->max_exec_us;
+    status.control_misses = task_control_info->deadline_misses;
+    status.control_jitter_us = task_control_info->max_jitter_us;
+#if ACCEL_MODE != ACCEL_MODE_POLL
+    status.sensor_latency_us = sensor_latency_us;
+    status.sensor_overruns = accel_stream_overruns();
+    status.accel_frac_bits = CIC_OUTPUT_FRAC_BITS;
+#else
+    status.sensor_latency_us = 0;
+    status.sensor_overruns = 0;
+    status.accel_frac_bits = 0;
+#endif
+    status.telemetry_drops = telemetry_drops();
+#if ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+    status.roll = attitude.roll;
+    status.pitch = attitude.pitch;
+    status.yaw = attitude.yaw;
+    status.ahrs_cycles = ahrs_cycles;
+    status.ahrs_cycles_max = ahrs_cycles_max;
+#else
+    status.roll = 0.0f;
+    status.pitch = filtered_pitch;
+    status.yaw = 0.0f;
+    status.ahrs_cycles = 0;
+    status.ahrs_cycles_max = 0;
+#endif
+#if ATTITUDE_ESTIMATOR != ATTITUDE_ACCEL
+    status.rate_measured = pitch_rate;
+#else
+    status.rate_measured = 0.0f;
+#endif
+#if CONTROL_CASCADE
+    status.rate_setpoint = rate_bank.setpoint[axis_pitch];
+    status.rate_max_us = task_rate_info->max_exec_us;
+    status.rate_misses = task_rate_info->deadline_misses;
+#else
+    status.rate_setpoint = 0.0f;
+    status.rate_max_us = 0;
+    status.rate_misses = 0;
+#endif
+    status.flags = (rc.stabilize ? TELEMETRY_FLAG_STABILIZE : 0) | (CONTROL_CASCADE ? TELEMETRY_FLAG_CASCADE : 0);
+    telemetry_send(TELEMETRY_TYPE_STATUS, &status, sizeof(status));
+    dlog_flush();
+#else
+    printf("Pulso Cn1: %ld us\n", (long)rc.pulse[0]);
+    if (rc.stabilize) {
+        printf("Raw Pitch: %.2f, Filtered Pitch: %.2f, Control Signal: %.2f\n", pitch, filtered_pitch, control_signal);
+    }
+    printf("Control dt: %.4f s, max: %lu us, jitter max: %lu us, plazos perdidos: %lu\n", task_control_info->dt,
+           (unsigned long)task_control_info->max_exec_us, (unsigned long)task_control_info->max_jitter_us,
+           (unsigned long)task_control_info->deadline_misses);
+#if FLIGHT_MULTICORE
+    // El núcleo 1 registra la tarea al arrancar
+    if (task_servo_info) {
+        printf("Servos (núcleo 1): max: %lu us, jitter max: %lu us\n", (unsigned long)task_servo_info->max_exec_us,
+               (unsigned long)task_servo_info->max_jitter_us);
+    }
+#endif
+#if CONTROL_CASCADE
+    printf("Lazo de velocidad: %.1f grados/s pedidos, %.1f medidos, max: %lu us, plazos perdidos: %lu\n",
+           rate_bank.setpoint[axis_pitch], pitch_rate, (unsigned long)task_rate_info->max_exec_us,
+           (unsigned long)task_rate_info->deadline_misses);
+#endif
+#if ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+    printf("Roll: %.2f, Pitch: %.2f, Yaw: %.2f, AHRS: %lu ciclos (max %lu)\n", attitude.roll, attitude.pitch,
+           attitude.yaw, (unsigned long)ahrs_cycles, (unsigned long)ahrs_cycles_max);
+#endif
+#if ACCEL_MODE != ACCEL_MODE_POLL
+    printf("Latencia del sensor: %lu us, muestras perdidas: %lu\n", (unsigned long)sensor_latency_us,
+           (unsigned long)accel_stream_overruns());
+#endif
+#endif
+}
 
-    // Configura el nivel de salida para el duty cycle
-    uint16_t level = duty_cycle * (float)(1 << 16) / 100.0f;
-    pwm_set_gpio_level(gpio, level);
+#if ATTITUDE_ESTIMATOR != ATTITUDE_ACCEL
+/**
+ * @brief Promedia el giróscopo en reposo para arrancar el estimador con su sesgo.
+ *
+ * @param bias Sesgo de cada eje en grados/s.
+ */
+static void gyro_calibrate_bias(float bias[3]) {
+    int32_t sum[3] = {0, 0, 0};
+    for (int i = 0; i < GYRO_CALIBRATION_SAMPLES; i++) {
+        int16_t gyro[3];
+        read_gyro(&gyro[0], &gyro[1], &gyro[2]);
+        for (int j = 0; j < 3; j++) {
+            sum[j] += gyro[j];
+        }
+        sleep_ms(2);
+    }
+    for (int j = 0; j < 3; j++) {
+        bias[j] = sum[j] / (float)GYRO_CALIBRATION_SAMPLES / ITG3205_LSB_PER_DPS;
+    }
+}
+#endif
 
-    // Habilita el PWM
-    pwm_set_enabled(slice_num, true);
+#if FLIGHT_MULTICORE
+/**
+ * @brief Programa del núcleo 1: captura del receptor y salidas de servo.
+ *
+ * La captura y las salidas nunca esperan al I2C ni al lazo de control del núcleo 0.
+ * Corren dentro de la interrupción del tic, así que tampoco esperan al hilo de este
+ * núcleo, que con BLACKBOX se queda programando y borrando la flash (un borrado lleva
+ * unos 45 ms). El binario copy_to_ram tiene las interrupciones en RAM, de modo que
+ * siguen entrando mientras la flash está ocupada.
+ */
+static void core1_main() {
+    rc_capture_init();
+    servo_out_init();
+
+    // Grupo de alarmas propio para que el tic de este planificador interrumpa al núcleo 1
+    alarm_pool_t *pool = alarm_pool_create_with_unused_hardware_alarm(4);
+
+    scheduler_init(&io_scheduler);
+    scheduler_add_task(&io_scheduler, "rc", RATE_RC_HZ, task_rc);
+    task_servo_info = scheduler_add_task(&io_scheduler, "servo", RATE_SERVO_HZ, task_servo);
+    scheduler_start_irq(&io_scheduler, pool);
+#if BLACKBOX
+    blackbox_run();
+#else
+    while (1) {
+        __wfi();
+    }
+#endif
 }
+#endif
 
 /**
- * @brief Función principal. Configura los pines, inicializa los periféricos y ejecuta el bucle principal.
- * 
+ * @brief Función principal. Configura los pines, inicializa los periféricos y ejecuta el planificador.
+ *
  * @return Código de estado del programa.
  */
 int main() {
     stdio_init_all();
-    
-    // Configura los pines como entrada
-    gpio_init(PWM_Cn1);
-    gpio_set_dir(PWM_Cn1, GPIO_IN);
-    gpio_init(PWM_Cn2);
-    gpio_set_dir(PWM_Cn2, GPIO_IN);
-    gpio_init(PWM_Cn4);
-    gpio_set_dir(PWM_Cn4, GPIO_IN);
-    gpio_init(PWM_Cn6);
-    gpio_set_dir(PWM_Cn6, GPIO_IN);
-    
-    // Configura los pines de salida PWM
-    gpio_set_function(PWM_OUT1, GPIO_FUNC_PWM);
-    gpio_set_function(PWM_OUT2, GPIO_FUNC_PWM);
-    gpio_set_function(PWM_OUT3, GPIO_FUNC_PWM);
-    gpio_set_function(PWM_OUT4, GPIO_FUNC_PWM);
-    gpio_set_function(PWM_OUT5, GPIO_FUNC_PWM);
+#if TELEMETRY_BINARY
+    dlog_init();
+#endif
+
+#if FAST_MATH_BENCHMARK
+    sleep_ms(2000); // Da tiempo a abrir el puerto USB
+    fast_math_benchmark();
+#endif
+#if CONTROL_BENCHMARK
+    sleep_ms(2000); // Da tiempo a abrir el puerto USB
+    control_benchmark();
+#endif
 
     // Inicializa periféricos adicionales
     i2c_init_gy();
     gy85_init();
-    
-    KalmanFilter kalman_filter;
-    kalman_init(&kalman_filter, 0.01, 0.1, 0); // Inicializa el filtro de Kalman
-
-    PIDController pid_controller;
-    pid_controller_init(&pid_controller, 1.0, 0.1, 0.05, 0); // Inicializa el controlador PID
+    gy85_accel_configure(&accel_config);
+#if ATTITUDE_ESTIMATOR != ATTITUDE_ACCEL
+    gy85_gyro_init(1000, ITG3205_DLPF_42HZ);
+    sleep_ms(50); // Arranque del PLL del giróscopo
+    float bias[3];
+    gyro_calibrate_bias(bias);
+#endif
+#if ATTITUDE_ESTIMATOR == ATTITUDE_GYRO
+    angle_kalman_init(&angle_filter, 0.001f, 0.003f, 0.03f, 0.0f, GYRO_PITCH_SIGN * bias[1]);
+#elif ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+    gy85_mag_init();
+    for (int j = 0; j < 3; j++) {
+        gyro_bias[j] = bias[j];
+    }
+    ahrs_init(&ahrs, AHRS_DEFAULT_BETA);
+    cycle_counter_init();
+#endif
+#if ACCEL_MODE != ACCEL_MODE_POLL
+    cic_init(&accel_decimator, ACCEL_DECIMATION);
+    accel_stream_init();
+#endif
+    i2c_async_init(i2c0); // Las lecturas del sensor pasan a DMA
+#if ACCEL_MODE != ACCEL_MODE_POLL
+    accel_stream_start();
+#endif
 
-    // Bucle principal
-    while (1) {
-        float duty_cycle1 = measure_duty_cycle(PWM_Cn1);
-        float duty_cycle2 = measure_duty_cycle(PWM_Cn2);
-        float duty_cycle3 = measure_duty_cycle(PWM_Cn4);
-        float duty_cycle4 = measure_duty_cycle(PWM_Cn6);
-        duty_cycle3 = (8.3 + (8.3 - duty_cycle3));
-        printf("Ciclo de trabajo: %.2f\n", duty_cycle1);
-        setup_pwm(PWM_OUT1, duty_cycle1 - 0.6);
-        setup_pwm(PWM_OUT2, (8.3 + (8.3 - duty_cycle1)));
-        setup_pwm(PWM_OUT3, duty_cycle2 + 1.0);
-
-        if (duty_cycle4 < 9.0 && (duty_cycle3 < 8.5 && duty_cycle3 > 8.1)) {
-            int16_t accX, accY, accZ;
-            float pitch, filtered_pitch, control_signal;
-
-            read_accelerometer(&accX, &accY, &accZ);
-            calculate_pitch(accX, accY, accZ, &pitch);
-
-            // Aplica el filtro de Kalman al ángulo de pitch
-            filtered_pitch = kalman_update(&kalman_filter, pitch + 3.0);
-
-            // Calcula la señal de control usando el controlador PID
-            control_signal = pid_controller_update(&pid_controller, filtered_pitch, 0.1); // Suponiendo dt = 0.1s
-
-            // Ajusta el ángulo del servo motor basado en la señal de control con límites personalizados
-            setup_pwm(PWM_OUT4, (control_signal / 10.0) + 9.0);
-            setup_pwm(PWM_OUT5, (control_signal / 10.0) + 7.5);
-
-            printf("Raw Pitch: %.2f, Filtered Pitch: %.2f, Control Signal: %.2f\n", pitch, filtered_pitch, control_signal);
-        } else {
-            setup_pwm(PWM_OUT4, duty_cycle3 + 0.5);
-            setup_pwm(PWM_OUT5, duty_cycle3 - 0.9);
-        }
-        
-        sleep_ms(80);  // Espera antes de medir nuevamente
+#if BLACKBOX
+    // Deja flash borrada por delante antes de que corra ningún lazo
+    if (!blackbox_init()) {
+        DLOG("blackbox: la zona del registro se solapa con el programa");
     }
+#endif
+
+    // Cada corrección predice hasta el instante de su muestra; al periodo nominal, con la ganancia fija
+    kalman_init_steady(&kalman_filter, PITCH_KALMAN_Q, PITCH_KALMAN_R, 0, PITCH_SAMPLE_US);
+    // Inicializa los controladores PID (setpoint 0: nivelado)
+#if CONTROL_INCREMENTAL_PID
+    axis_pitch = pid_num_axes++;
+    pid_incremental_init(&pid_axes[axis_pitch], PID_KP, PID_KI, PID_KD, PID_UPDATE_HZ,
+                         -PID_OUTPUT_LIMIT, PID_OUTPUT_LIMIT);
+#if ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+    axis_roll = pid_num_axes++;
+    pid_incremental_init(&pid_axes[axis_roll], PID_KP, PID_KI, PID_KD, PID_UPDATE_HZ,
+                         -PID_OUTPUT_LIMIT, PID_OUTPUT_LIMIT);
+#endif
+#else
+    pid_bank_init(&pid_bank);
+#if CONTROL_CASCADE
+    // Lazo externo proporcional con la velocidad pedida limitada; el interno, con los mismos
+    // índices de eje, deriva la medida filtrada para no saltar con cada cambio de setpoint
+    pid_bank_init(&rate_bank);
+    axis_pitch = pid_bank_add_axis(&pid_bank, ANGLE_KP, 0.0f, 0.0f, -ANGLE_RATE_LIMIT, ANGLE_RATE_LIMIT);
+    pid_bank_add_axis(&rate_bank, RATE_KP, RATE_KI, RATE_KD, -PID_OUTPUT_LIMIT, PID_OUTPUT_LIMIT);
+    pid_bank_set_derivative(&rate_bank, axis_pitch, RATE_D_CUTOFF_HZ, true);
+#if ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+    axis_roll = pid_bank_add_axis(&pid_bank, ANGLE_KP, 0.0f, 0.0f, -ANGLE_RATE_LIMIT, ANGLE_RATE_LIMIT);
+    pid_bank_add_axis(&rate_bank, RATE_KP, RATE_KI, RATE_KD, -PID_OUTPUT_LIMIT, PID_OUTPUT_LIMIT);
+    pid_bank_set_derivative(&rate_bank, axis_roll, RATE_D_CUTOFF_HZ, true);
+#endif
+#else
+    axis_pitch = pid_bank_add_axis(&pid_bank, PID_KP, PID_KI, PID_KD, -PID_OUTPUT_LIMIT, PID_OUTPUT_LIMIT);
+#if ATTITUDE_ESTIMATOR == ATTITUDE_AHRS
+    axis_roll = pid_bank_add_axis(&pid_bank, PID_KP, PID_KI, PID_KD, -PID_OUTPUT_LIMIT, PID_OUTPUT_LIMIT);
+#endif
+#endif
+#endif
+
+#if FLIGHT_MULTICORE
+    // El núcleo 1 atiende el receptor y los servos; este núcleo, el sensor y el PID
+    multicore_launch_core1(core1_main);
+
+    scheduler_init(&scheduler);
+#if CONTROL_CASCADE
+    task_rate_info = scheduler_add_task(&scheduler, "rate", RATE_INNER_HZ, task_rate);
+#endif
+    task_control_info = scheduler_add_task(&scheduler, "control", RATE_CONTROL_HZ, task_control);
+    scheduler_add_task(&scheduler, "telemetry", RATE_TELEMETRY_HZ, task_telemetry);
+#else
+#if BLACKBOX
+    // El núcleo 1 queda libre: programa y borra la flash sin pasar por este planificador
+    multicore_launch_core1(blackbox_run);
+#endif
+
+    // Inicia la captura de los canales del receptor
+    rc_capture_init();
+
+    // Configura una sola vez las salidas de los servos
+    servo_out_init();
+
+    // Tareas por orden de prioridad (de mayor a menor frecuencia)
+    scheduler_init(&scheduler);
+#if CONTROL_CASCADE
+    task_rate_info = scheduler_add_task(&scheduler, "rate", RATE_INNER_HZ, task_rate);
+#endif
+    task_control_info = scheduler_add_task(&scheduler, "control", RATE_CONTROL_HZ, task_control);
+    scheduler_add_task(&scheduler, "rc", RATE_RC_HZ, task_rc);
+    scheduler_add_task(&scheduler, "servo", RATE_SERVO_HZ, task_servo);
+    scheduler_add_task(&scheduler, "telemetry", RATE_TELEMETRY_HZ, task_telemetry);
+#endif
+
+    scheduler_start(&scheduler, NULL);
+    scheduler_run(&scheduler);
 
     return 0;
 }
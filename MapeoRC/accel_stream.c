@@ -0,0 +1,281 @@
+/**
+ * @file accel_stream.c
+ * @brief Flujo de muestras del ADXL345 guiado por su interrupción INT1.
+ *
+ * Dos modos, elegidos con ACCEL_MODE:
+ * - FIFO: el FIFO del sensor acumula ACCEL_FIFO_WATERMARK muestras y levanta INT1.
+ *   La interrupción del GPIO lanza una ráfaga de transacciones I2C por DMA que se
+ *   encadenan desde la interrupción de fin: FIFO_STATUS y luego una lectura de 6
+ *   bytes por entrada (el ADXL345 saca una entrada del FIFO por cada lectura de
+ *   DATAX0..DATAZ1). El instante de cada muestra se reconstruye a partir de la
+ *   frecuencia de muestreo.
+ * - DRDY: INT1 es DATA_READY. La interrupción del GPIO marca el instante de la
+ *   muestra y lanza su lectura; cada muestra se lee una sola vez y el bus queda
+ *   libre entre muestras.
+ *
+ * Las muestras van a un anillo con su instante de adquisición. Las interrupciones
+ * del GPIO y del DMA tienen la misma prioridad y no se interrumpen entre sí, así
+ * que el estado de la lectura en curso no necesita bloqueos.
+ */
+
+#include "accel_stream.h"
+#include "i2c_async.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+#if ACCEL_MODE != ACCEL_MODE_POLL
+
+#define ADXL345_INT_ENABLE 0x2E     ///< Habilitación de interrupciones
+#define ADXL345_INT_MAP 0x2F        ///< Asignación de interrupciones a INT1/INT2
+#define ADXL345_DATAX0 0x32         ///< Primer registro de datos
+#define ADXL345_FIFO_CTL 0x38       ///< Modo del FIFO y watermark
+#define ADXL345_FIFO_STATUS 0x39    ///< Entradas en el FIFO
+
+#define ADXL345_INT_DATA_READY 0x80 ///< Bit de la interrupción de dato nuevo
+#define ADXL345_INT_WATERMARK 0x02  ///< Bit de la interrupción de watermark
+#define ADXL345_FIFO_STREAM 0x80    ///< Modo stream: el FIFO guarda las 32 últimas muestras
+
+#define ACCEL_SAMPLE_PERIOD_US (1000000 / ACCEL_ODR_HZ) ///< Periodo entre muestras
+
+static AccelSample accel_ring[ACCEL_SAMPLE_RING_SIZE];
+static volatile uint32_t accel_head;        ///< Índice de escritura (solo la interrupción)
+static volatile uint32_t accel_tail;        ///< Índice de lectura (solo el consumidor)
+static volatile uint32_t accel_overruns;
+
+static volatile bool drain_active;          ///< Hay una lectura en curso
+static volatile bool drain_pending;         ///< Llegó una interrupción durante la lectura
+static volatile uint32_t drdy_edge_us;      ///< Instante del último flanco de DATA_READY
+static uint8_t drain_buf[6];                ///< Muestra leída por DMA
+static uint32_t drain_left;                 ///< Entradas que faltan por leer en la ráfaga
+static uint32_t drain_time_us;              ///< Instante de la muestra más reciente de la lectura
+
+#if ACCEL_MODE == ACCEL_MODE_FIFO
+static uint8_t drain_status;                ///< FIFO_STATUS leído por DMA
+
+static void accel_drain_status_done(bool ok, void *context);
+static void accel_drain_recheck_done(bool ok, void *context);
+#endif
+static void accel_drain_sample_done(bool ok, void *context);
+
+/**
+ * @brief Guarda una muestra en el anillo (lado productor).
+ *
+ * @param sample Muestra a guardar.
+ */
+static inline void accel_ring_push(const AccelSample *sample) {
+    uint32_t head = accel_head;
+    if (head - accel_tail >= ACCEL_SAMPLE_RING_SIZE) {
+        accel_overruns++;
+        return;
+    }
+    accel_ring[head & (ACCEL_SAMPLE_RING_SIZE - 1)] = *sample;
+    __dmb();
+    accel_head = head + 1;
+}
+
+/**
+ * @brief Empieza una lectura: en modo FIFO, por cuántas entradas tiene; en modo DRDY, la muestra nueva.
+ */
+static void accel_drain_begin() {
+    drain_active = true;
+    drain_pending = false;
+#if ACCEL_MODE == ACCEL_MODE_FIFO
+    bool started = i2c_async_read(GY85_ADDR, ADXL345_FIFO_STATUS, &drain_status, 1, accel_drain_status_done, NULL);
+#else
+    drain_time_us = drdy_edge_us;
+    drain_left = 1;
+    bool started = i2c_async_read(GY85_ADDR, ADXL345_DATAX0, drain_buf, 6, accel_drain_sample_done, NULL);
+#endif
+    if (!started) {
+        // Cola del bus llena: se reintenta desde el consumidor
+        drain_active = false;
+        drain_pending = true;
+    }
+}
+
+/**
+ * @brief Termina la ráfaga; si llegó otra interrupción mientras tanto, empieza otra.
+ */
+static void accel_drain_end() {
+    drain_active = false;
+    if (drain_pending) {
+        accel_drain_begin();
+    }
+}
+
+/**
+ * @brief Lanza la lectura de la siguiente entrada del FIFO.
+ */
+static void accel_drain_next_sample() {
+    if (!i2c_async_read(GY85_ADDR, ADXL345_DATAX0, drain_buf, 6, accel_drain_sample_done, NULL)) {
+        drain_pending = true;
+        accel_drain_end();
+    }
+}
+
+#if ACCEL_MODE == ACCEL_MODE_FIFO
+/**
+ * @brief Fin de la lectura de FIFO_STATUS: decide cuántas muestras leer.
+ *
+ * @param ok Verdadero si la transacción terminó sin error.
+ * @param context No se usa.
+ */
+static void accel_drain_status_done(bool ok, void *context) {
+    uint32_t entries = drain_status & 0x3F;
+    if (!ok || entries == 0) {
+        drain_pending |= !ok;
+        accel_drain_end();
+        return;
+    }
+
+    drain_time_us = time_us_32();
+    drain_left = MIN(entries, ACCEL_FIFO_MAX_BURST);
+    accel_drain_next_sample();
+}
+
+/**
+ * @brief Fin de la comprobación tras una ráfaga: sigue solo si INT1 continúa activa.
+ *
+ * @param ok Verdadero si la transacción terminó sin error.
+ * @param context No se usa.
+ */
+static void accel_drain_recheck_done(bool ok, void *context) {
+    if (ok && (drain_status & 0x3F) < ACCEL_FIFO_WATERMARK) {
+        // INT1 ya bajó: la siguiente ráfaga la dispara el próximo flanco
+        accel_drain_end();
+        return;
+    }
+    accel_drain_status_done(ok, context);
+}
+#endif
+
+/**
+ * @brief Fin de la lectura de una entrada: la encola y sigue con la ráfaga.
+ *
+ * @param ok Verdadero si la transacción terminó sin error.
+ * @param context No se usa.
+ */
+static void accel_drain_sample_done(bool ok, void *context) {
+    if (!ok) {
+        drain_pending = true;
+        accel_drain_end();
+        return;
+    }
+
+    // La entrada más reciente del FIFO se adquirió justo antes de leer FIFO_STATUS
+    AccelSample sample;
+    sample.x = (drain_buf[1] << 8) | drain_buf[0];
+    sample.y = (drain_buf[3] << 8) | drain_buf[2];
+    sample.z = (drain_buf[5] << 8) | drain_buf[4];
+    sample.timestamp_us = drain_time_us - (drain_left - 1) * ACCEL_SAMPLE_PERIOD_US;
+    accel_ring_push(&sample);
+
+    if (--drain_left > 0) {
+        accel_drain_next_sample();
+        return;
+    }
+
+#if ACCEL_MODE == ACCEL_MODE_DRDY
+    // DATA_READY baja al leer los datos; la siguiente muestra trae su propio flanco
+    accel_drain_end();
+#else
+    // Pudo llenarse de nuevo mientras se leía; si sigue sobre el watermark, INT1 no bajó
+    // y no habrá otro flanco, así que se comprueba otra vez antes de terminar
+    if (!i2c_async_read(GY85_ADDR, ADXL345_FIFO_STATUS, &drain_status, 1, accel_drain_recheck_done, NULL)) {
+        drain_pending = true;
+        accel_drain_end();
+    }
+#endif
+}
+
+/**
+ * @brief Interrupción del pin INT1: el FIFO alcanzó el watermark o hay una muestra nueva.
+ */
+static void accel_stream_gpio_irq() {
+    uint32_t events = gpio_get_irq_event_mask(ACCEL_INT_PIN);
+    if (!events) {
+        return;
+    }
+    drdy_edge_us = time_us_32();
+    gpio_acknowledge_irq(ACCEL_INT_PIN, events);
+
+    if (drain_active) {
+        drain_pending = true;
+    } else {
+        accel_drain_begin();
+    }
+}
+
+/**
+ * @brief Configura el FIFO y la interrupción del ADXL345 con escrituras bloqueantes.
+ */
+void accel_stream_init() {
+    write_register(ADXL345_INT_ENABLE, 0x00);   // Sin interrupciones mientras se configura
+    write_register(ADXL345_FIFO_CTL, 0x00);     // Modo bypass: vacía el FIFO
+    write_register(ADXL345_INT_MAP, 0x00);      // Todas las interrupciones a INT1
+#if ACCEL_MODE == ACCEL_MODE_FIFO
+    write_register(ADXL345_FIFO_CTL, ADXL345_FIFO_STREAM | ACCEL_FIFO_WATERMARK);
+    write_register(ADXL345_INT_ENABLE, ADXL345_INT_WATERMARK);
+#else
+    write_register(ADXL345_INT_ENABLE, ADXL345_INT_DATA_READY);
+#endif
+
+    gpio_init(ACCEL_INT_PIN);
+    gpio_set_dir(ACCEL_INT_PIN, GPIO_IN);
+}
+
+/**
+ * @brief Habilita la interrupción del pin INT1 y lanza la primera lectura.
+ */
+void accel_stream_start() {
+    gpio_add_raw_irq_handler(ACCEL_INT_PIN, accel_stream_gpio_irq);
+    gpio_set_irq_enabled(ACCEL_INT_PIN, GPIO_IRQ_EDGE_RISE, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+
+    // Si INT1 ya estaba activa no habrá flanco: se lee una vez a mano
+    uint32_t status = save_and_disable_interrupts();
+    if (!drain_active) {
+        drdy_edge_us = time_us_32();
+        accel_drain_begin();
+    }
+    restore_interrupts(status);
+}
+
+/**
+ * @brief Saca la muestra más antigua pendiente (lado consumidor).
+ *
+ * @param sample Muestra leída.
+ * @return Falso si no hay muestras nuevas.
+ */
+bool accel_stream_pop(AccelSample *sample) {
+    // Reintenta una lectura que no pudo empezar o falló; INT1 sigue activa y no dará otro flanco
+    if (drain_pending && !drain_active) {
+        uint32_t status = save_and_disable_interrupts();
+        if (drain_pending && !drain_active) {
+            accel_drain_begin();
+        }
+        restore_interrupts(status);
+    }
+
+    uint32_t tail = accel_tail;
+    if (tail == accel_head) {
+        return false;
+    }
+    __dmb();
+    *sample = accel_ring[tail & (ACCEL_SAMPLE_RING_SIZE - 1)];
+    __dmb();
+    accel_tail = tail + 1;
+    return true;
+}
+
+/**
+ * @brief Muestras descartadas porque el consumidor no vació el anillo a tiempo.
+ *
+ * @return Número de muestras perdidas desde el arranque.
+ */
+uint32_t accel_stream_overruns() {
+    return accel_overruns;
+}
+
+#endif // ACCEL_MODE != ACCEL_MODE_POLL
@@ -0,0 +1,56 @@
+/**
+ * @file accel_stream.h
+ * @brief Flujo de muestras del ADXL345 guiado por su interrupción INT1.
+ */
+
+#ifndef ACCEL_STREAM_H
+#define ACCEL_STREAM_H
+
+#include "pico/stdlib.h"
+#include "control_pid.h"
+
+#define ACCEL_INT_PIN 16            ///< GPIO cableado a INT1 del ADXL345
+#define ACCEL_FIFO_WATERMARK 16     ///< Muestras en el FIFO que disparan la interrupción (1 a 31)
+#define ACCEL_FIFO_MAX_BURST 32     ///< Máximo de muestras leídas por ráfaga (tamaño del FIFO)
+#define ACCEL_SAMPLE_RING_SIZE 64   ///< Muestras en espera del consumidor (potencia de 2)
+
+/**
+ * @brief Muestra del acelerómetro con su instante de adquisición.
+ */
+typedef struct {
+    int16_t x;              ///< Eje X en cuentas
+    int16_t y;              ///< Eje Y en cuentas
+    int16_t z;              ///< Eje Z en cuentas
+    uint32_t timestamp_us;  ///< Instante estimado de adquisición (time_us_32)
+} AccelSample;
+
+/**
+ * @brief Configura el FIFO y la interrupción del ADXL345 (watermark o DATA_READY según ACCEL_MODE).
+ *
+ * Usa escrituras bloqueantes: debe llamarse después de gy85_init() y antes de i2c_async_init().
+ */
+void accel_stream_init();
+
+/**
+ * @brief Habilita la interrupción del pin INT1 y lanza la primera lectura.
+ *
+ * Requiere i2c_async_init(); la interrupción queda en el núcleo que llama a la función.
+ */
+void accel_stream_start();
+
+/**
+ * @brief Saca la muestra más antigua pendiente.
+ *
+ * @param sample Muestra leída.
+ * @return Falso si no hay muestras nuevas.
+ */
+bool accel_stream_pop(AccelSample *sample);
+
+/**
+ * @brief Muestras descartadas porque el consumidor no vació el anillo a tiempo.
+ *
+ * @return Número de muestras perdidas desde el arranque.
+ */
+uint32_t accel_stream_overruns();
+
+#endif // ACCEL_STREAM_H
@@ -0,0 +1,184 @@
+/**
+ * @file ahrs.c
+ * @brief Filtro de Madgwick en float con las rutinas rápidas de fast_math.
+ *
+ * El giróscopo se integra como derivada del cuaternión y un paso de descenso de
+ * gradiente, escalado por beta, lo corrige hacia la gravedad medida por el
+ * acelerómetro y el campo medido por el magnetómetro. Todas las normalizaciones
+ * usan fast_inv_sqrtf() y los ángulos fast_atan2f(), de modo que una
+ * actualización completa no llama a ninguna rutina de double ni a sqrtf().
+ */
+
+#include "ahrs.h"
+#include "fast_math.h"
+
+/**
+ * @brief Inicializa el estimador con la orientación nula.
+ *
+ * @param ahrs Puntero al estimador.
+ * @param beta Ganancia de la corrección.
+ */
+void ahrs_init(Ahrs *ahrs, float beta) {
+    ahrs->q0 = 1.0f;
+    ahrs->q1 = 0.0f;
+    ahrs->q2 = 0.0f;
+    ahrs->q3 = 0.0f;
+    ahrs->beta = beta;
+}
+
+/**
+ * @brief Paso de corrección con acelerómetro y magnetómetro (ya normalizados).
+ *
+ * @param ahrs Puntero al estimador.
+ * @param ax Aceleración normalizada en X.
+ * @param ay Aceleración normalizada en Y.
+ * @param az Aceleración normalizada en Z.
+ * @param mx Campo normalizado en X.
+ * @param my Campo normalizado en Y.
+ * @param mz Campo normalizado en Z.
+ * @param s Gradiente resultante (sin normalizar).
+ */
+static void ahrs_gradient_marg(const Ahrs *ahrs, float ax, float ay, float az,
+                               float mx, float my, float mz, float s[4]) {
+    float q0 = ahrs->q0, q1 = ahrs->q1, q2 = ahrs->q2, q3 = ahrs->q3;
+
+    // Dirección del campo en el marco de tierra, reducida al plano x-z
+    float hx = mx * (q0 * q0 + q1 * q1 - q2 * q2 - q3 * q3) + 2.0f * my * (q1 * q2 - q0 * q3)
+             + 2.0f * mz * (q1 * q3 + q0 * q2);
+    float hy = 2.0f * mx * (q0 * q3 + q1 * q2) + my * (q0 * q0 - q1 * q1 + q2 * q2 - q3 * q3)
+             + 2.0f * mz * (q2 * q3 - q0 * q1);
+    float hxy = hx * hx + hy * hy;
+    float bx = hxy * fast_inv_sqrtf(hxy);
+    float bz = 2.0f * mx * (q1 * q3 - q0 * q2) + 2.0f * my * (q0 * q1 + q2 * q3)
+             + mz * (q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3);
+
+    // Error entre las direcciones estimadas y las medidas
+    float fg1 = 2.0f * (q1 * q3 - q0 * q2) - ax;
+    float fg2 = 2.0f * (q0 * q1 + q2 * q3) - ay;
+    float fg3 = 1.0f - 2.0f * (q1 * q1 + q2 * q2) - az;
+    float fb1 = 2.0f * bx * (0.5f - q2 * q2 - q3 * q3) + 2.0f * bz * (q1 * q3 - q0 * q2) - mx;
+    float fb2 = 2.0f * bx * (q1 * q2 - q0 * q3) + 2.0f * bz * (q0 * q1 + q2 * q3) - my;
+    float fb3 = 2.0f * bx * (q0 * q2 + q1 * q3) + 2.0f * bz * (0.5f - q1 * q1 - q2 * q2) - mz;
+
+    // Gradiente = J' * f
+    s[0] = -2.0f * q2 * fg1 + 2.0f * q1 * fg2
+         - 2.0f * bz * q2 * fb1 + 2.0f * (-bx * q3 + bz * q1) * fb2 + 2.0f * bx * q2 * fb3;
+    s[1] = 2.0f * q3 * fg1 + 2.0f * q0 * fg2 - 4.0f * q1 * fg3
+         + 2.0f * bz * q3 * fb1 + 2.0f * (bx * q2 + bz * q0) * fb2 + 2.0f * (bx * q3 - 2.0f * bz * q1) * fb3;
+    s[2] = -2.0f * q0 * fg1 + 2.0f * q3 * fg2 - 4.0f * q2 * fg3
+         + 2.0f * (-2.0f * bx * q2 - bz * q0) * fb1 + 2.0f * (bx * q1 + bz * q3) * fb2
+         + 2.0f * (bx * q0 - 2.0f * bz * q2) * fb3;
+    s[3] = 2.0f * q1 * fg1 + 2.0f * q2 * fg2
+         + 2.0f * (-2.0f * bx * q3 + bz * q1) * fb1 + 2.0f * (-bx * q0 + bz * q2) * fb2 + 2.0f * bx * q1 * fb3;
+}
+
+/**
+ * @brief Paso de corrección solo con el acelerómetro (ya normalizado).
+ *
+ * @param ahrs Puntero al estimador.
+ * @param ax Aceleración normalizada en X.
+ * @param ay Aceleración normalizada en Y.
+ * @param az Aceleración normalizada en Z.
+ * @param s Gradiente resultante (sin normalizar).
+ */
+static void ahrs_gradient_imu(const Ahrs *ahrs, float ax, float ay, float az, float s[4]) {
+    float q0 = ahrs->q0, q1 = ahrs->q1, q2 = ahrs->q2, q3 = ahrs->q3;
+
+    float fg1 = 2.0f * (q1 * q3 - q0 * q2) - ax;
+    float fg2 = 2.0f * (q0 * q1 + q2 * q3) - ay;
+    float fg3 = 1.0f - 2.0f * (q1 * q1 + q2 * q2) - az;
+
+    s[0] = -2.0f * q2 * fg1 + 2.0f * q1 * fg2;
+    s[1] = 2.0f * q3 * fg1 + 2.0f * q0 * fg2 - 4.0f * q1 * fg3;
+    s[2] = -2.0f * q0 * fg1 + 2.0f * q3 * fg2 - 4.0f * q2 * fg3;
+    s[3] = 2.0f * q1 * fg1 + 2.0f * q2 * fg2;
+}
+
+/**
+ * @brief Integra una muestra de los tres sensores.
+ *
+ * @param ahrs Puntero al estimador.
+ * @param gx Velocidad angular en X, rad/s.
+ * @param gy Velocidad angular en Y, rad/s.
+ * @param gz Velocidad angular en Z, rad/s.
+ * @param ax Aceleración en X.
+ * @param ay Aceleración en Y.
+ * @param az Aceleración en Z.
+ * @param mx Campo magnético en X.
+ * @param my Campo magnético en Y.
+ * @param mz Campo magnético en Z.
+ * @param dt Tiempo desde la muestra anterior, en segundos.
+ */
+void ahrs_update(Ahrs *ahrs, float gx, float gy, float gz, float ax, float ay, float az,
+                 float mx, float my, float mz, float dt) {
+    float q0 = ahrs->q0, q1 = ahrs->q1, q2 = ahrs->q2, q3 = ahrs->q3;
+
+    // Derivada del cuaternión por el giróscopo: 0.5 * q x (0, g)
+    float dq0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    float dq1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+    float dq2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+    float dq3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+    float a2 = ax * ax + ay * ay + az * az;
+    if (a2 > 0.0f) {
+        float inv = fast_inv_sqrtf(a2);
+        ax *= inv;
+        ay *= inv;
+        az *= inv;
+
+        float s[4];
+        float m2 = mx * mx + my * my + mz * mz;
+        if (m2 > 0.0f) {
+            inv = fast_inv_sqrtf(m2);
+            ahrs_gradient_marg(ahrs, ax, ay, az, mx * inv, my * inv, mz * inv, s);
+        } else {
+            ahrs_gradient_imu(ahrs, ax, ay, az, s);
+        }
+
+        float s2 = s[0] * s[0] + s[1] * s[1] + s[2] * s[2] + s[3] * s[3];
+        if (s2 > 0.0f) {
+            float k = ahrs->beta * fast_inv_sqrtf(s2);
+            dq0 -= k * s[0];
+            dq1 -= k * s[1];
+            dq2 -= k * s[2];
+            dq3 -= k * s[3];
+        }
+    }
+
+    q0 += dq0 * dt;
+    q1 += dq1 * dt;
+    q2 += dq2 * dt;
+    q3 += dq3 * dt;
+
+    float inv = fast_inv_sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    ahrs->q0 = q0 * inv;
+    ahrs->q1 = q1 * inv;
+    ahrs->q2 = q2 * inv;
+    ahrs->q3 = q3 * inv;
+}
+
+/**
+ * @brief Convierte la orientación actual a ángulos de Euler.
+ *
+ * @param ahrs Puntero al estimador.
+ * @param euler Ángulos en grados.
+ */
+void ahrs_get_euler(const Ahrs *ahrs, AhrsEuler *euler) {
+    float q0 = ahrs->q0, q1 = ahrs->q1, q2 = ahrs->q2, q3 = ahrs->q3;
+
+    euler->roll = fast_atan2f(2.0f * (q0 * q1 + q2 * q3), 1.0f - 2.0f * (q1 * q1 + q2 * q2))
+                * FAST_MATH_RAD_TO_DEG;
+
+    // asin(sp) como atan2(sp, sqrt(1 - sp^2)) para reutilizar la rutina rápida
+    float sp = 2.0f * (q0 * q2 - q1 * q3);
+    if (sp > 1.0f) {
+        sp = 1.0f;
+    } else if (sp < -1.0f) {
+        sp = -1.0f;
+    }
+    float cp2 = 1.0f - sp * sp;
+    euler->pitch = fast_atan2f(sp, cp2 > 0.0f ? cp2 * fast_inv_sqrtf(cp2) : 0.0f) * FAST_MATH_RAD_TO_DEG;
+
+    euler->yaw = fast_atan2f(2.0f * (q0 * q3 + q1 * q2), 1.0f - 2.0f * (q2 * q2 + q3 * q3))
+               * FAST_MATH_RAD_TO_DEG;
+}
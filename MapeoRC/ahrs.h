@@ -0,0 +1,71 @@
+/**
+ * @file ahrs.h
+ * @brief Estimador de actitud en cuaterniones (filtro de Madgwick) para los tres sensores de la GY-85.
+ */
+
+#ifndef AHRS_H
+#define AHRS_H
+
+#include <stdint.h>
+
+#define AHRS_DEFAULT_BETA 0.1f ///< Ganancia del descenso de gradiente (rad/s)
+
+/**
+ * @brief Estado del estimador: cuaternión de orientación del cuerpo respecto a la tierra.
+ */
+typedef struct {
+    float q0;   ///< Componente escalar
+    float q1;   ///< Componente x
+    float q2;   ///< Componente y
+    float q3;   ///< Componente z
+    float beta; ///< Ganancia de la corrección con acelerómetro y magnetómetro
+} Ahrs;
+
+/**
+ * @brief Ángulos de Euler en grados.
+ */
+typedef struct {
+    float roll;     ///< Alabeo
+    float pitch;    ///< Cabeceo (mismo signo que calculate_pitch())
+    float yaw;      ///< Guiñada respecto al norte magnético
+} AhrsEuler;
+
+/**
+ * @brief Inicializa el estimador con la orientación nula.
+ *
+ * @param ahrs Puntero al estimador.
+ * @param beta Ganancia de la corrección (mayor converge antes, menor filtra más).
+ */
+void ahrs_init(Ahrs *ahrs, float beta);
+
+/**
+ * @brief Integra una muestra de los tres sensores.
+ *
+ * El acelerómetro y el magnetómetro se normalizan, así que valen en cualquier
+ * escala. Si el magnetómetro es cero se usa solo el acelerómetro (sin guiñada
+ * absoluta); si también lo es, solo se integra el giróscopo.
+ *
+ * @param ahrs Puntero al estimador.
+ * @param gx Velocidad angular en X, rad/s.
+ * @param gy Velocidad angular en Y, rad/s.
+ * @param gz Velocidad angular en Z, rad/s.
+ * @param ax Aceleración en X.
+ * @param ay Aceleración en Y.
+ * @param az Aceleración en Z.
+ * @param mx Campo magnético en X.
+ * @param my Campo magnético en Y.
+ * @param mz Campo magnético en Z.
+ * @param dt Tiempo desde la muestra anterior, en segundos.
+ */
+void ahrs_update(Ahrs *ahrs, float gx, float gy, float gz, float ax, float ay, float az,
+                 float mx, float my, float mz, float dt);
+
+/**
+ * @brief Convierte la orientación actual a ángulos de Euler.
+ *
+ * @param ahrs Puntero al estimador.
+ * @param euler Ángulos en grados.
+ */
+void ahrs_get_euler(const Ahrs *ahrs, AhrsEuler *euler);
+
+#endif // AHRS_H
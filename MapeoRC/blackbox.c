@@ -0,0 +1,330 @@
+/**
+ * @file blackbox.c
+ * @brief Registro de vuelo en la zona libre de la flash QSPI.
+ *
+ * El lazo de control solo codifica registros en uno de dos buffers de RAM del tamaño
+ * de un sector. El núcleo 1 programa las páginas completas de uno u otro, una por
+ * llamada, y el buffer lleno se cierra y se cambia por el otro sin esperar a la
+ * flash. Así un corte de alimentación pierde como mucho la página en curso y el
+ * sector cerrado pendiente.
+ *
+ * Mientras la flash se programa o borra no se puede ejecutar desde ella. El binario
+ * se construye copy_to_ram (código, datos e interrupciones en RAM), de modo que el
+ * núcleo 0 sigue con el lazo de control mientras el núcleo 1 espera a la flash.
+ * Programar una página lleva menos de 1 ms y borrar un sector unos 45 ms; ninguna de
+ * las dos cosas pasa por el planificador del núcleo 0.
+ *
+ * Los dos núcleos no comparten ningún contador que ambos modifiquen: el lazo cuenta
+ * los sectores que abre, el núcleo 1 los que borra y las páginas que programa, y cada
+ * buffer pasa de uno a otro con su indicador in_use.
+ *
+ * Desgaste: el anillo recorre todos los sectores de la zona en orden y continúa tras
+ * cada arranque donde quedó, así que todos se borran el mismo número de veces. Lo que
+ * se borra por delante de la cabeza es siempre lo más antiguo del anillo.
+ */
+
+#include <string.h>
+#include "blackbox.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "hardware/regs/addressmap.h"
+
+#if !PICO_COPY_TO_RAM
+#error "El registro de vuelo necesita el binario copy_to_ram (opción BLACKBOX de CMake)"
+#endif
+
+#define BB_REGION_SIZE (BLACKBOX_FLASH_KB * 1024u)                  ///< Bytes del anillo
+#define BB_REGION_OFFSET (PICO_FLASH_SIZE_BYTES - BB_REGION_SIZE)   ///< Inicio del anillo en la flash
+#define BB_SECTORS (BB_REGION_SIZE / BLACKBOX_SECTOR_SIZE)          ///< Sectores del anillo
+#define BB_ERASE_AHEAD (BLACKBOX_ERASE_AHEAD_KB * 1024u / BLACKBOX_SECTOR_SIZE) ///< Sectores a dejar borrados
+#define BB_ERASE_LOW (BB_ERASE_AHEAD / 2)   ///< Reserva por debajo de la cual se borra aunque no se permita
+#define BB_RUN_IDLE_US 1000                 ///< Espera de blackbox_run() entre llamadas
+
+_Static_assert(BLACKBOX_SECTOR_SIZE == FLASH_SECTOR_SIZE, "El sector del formato no es el de la flash");
+_Static_assert(BLACKBOX_PAGE_SIZE == FLASH_PAGE_SIZE, "La página del formato no es la de la flash");
+_Static_assert(BB_ERASE_AHEAD + 2 < BB_SECTORS, "BLACKBOX_ERASE_AHEAD_KB debe dejar sitio a los sectores en uso");
+
+extern char __flash_binary_end; ///< Fin de la imagen del programa en la flash (enlazador)
+
+/**
+ * @brief Un buffer de sector en RAM.
+ */
+typedef struct {
+    uint8_t data[BLACKBOX_SECTOR_SIZE]; ///< Contenido del sector (0xFF donde no hay datos)
+    volatile uint32_t len;              ///< Bytes ocupados (los escribe el lazo)
+    uint32_t sector;                    ///< Sector de destino dentro del anillo
+    uint32_t pages_done;                ///< Páginas ya programadas (las cuenta el núcleo 1)
+    volatile bool in_use;               ///< Lo activa el lazo al abrirlo y lo limpia el núcleo 1 al terminar
+    volatile bool closed;               ///< Ya no admite registros
+} BlackboxBuffer;
+
+static BlackboxBuffer bb_buf[2];
+static uint32_t bb_fill;                ///< Buffer que recibe registros
+static int32_t bb_prev[BLACKBOX_FIELDS]; ///< Campos del registro anterior del sector
+static uint32_t bb_start;               ///< Sector del anillo en que empezó este arranque
+static uint32_t bb_opened;              ///< Sectores abiertos desde bb_start (solo el lazo)
+static volatile uint32_t bb_erased;     ///< Sectores borrados desde bb_start (solo el núcleo 1)
+static uint32_t bb_sequence;            ///< Secuencia del siguiente sector
+static uint32_t bb_session;             ///< Arranque actual
+static bool bb_enabled;
+static uint32_t bb_dropped;
+
+/**
+ * @brief Dirección XIP de un sector del anillo, para leerlo.
+ *
+ * @param sector Índice del sector.
+ * @return Puntero al contenido del sector.
+ */
+static inline const uint8_t *blackbox_sector_ptr(uint32_t sector) {
+    return (const uint8_t *)(XIP_NOCACHE_NOALLOC_BASE + BB_REGION_OFFSET + sector * BLACKBOX_SECTOR_SIZE);
+}
+
+/**
+ * @brief Comprueba si un sector está entero en blanco.
+ *
+ * @param sector Índice del sector.
+ * @return Verdadero si todos sus bytes valen 0xFF.
+ */
+static bool blackbox_sector_blank(uint32_t sector) {
+    const uint32_t *words = (const uint32_t *)blackbox_sector_ptr(sector);
+    for (uint32_t i = 0; i < BLACKBOX_SECTOR_SIZE / sizeof(uint32_t); i++) {
+        if (words[i] != 0xFFFFFFFFu) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Deja borrado el siguiente sector por delante de los ya borrados.
+ */
+static void blackbox_erase_next() {
+    uint32_t sector = (bb_start + bb_erased) % BB_SECTORS;
+    if (!blackbox_sector_blank(sector)) {
+        flash_range_erase(BB_REGION_OFFSET + sector * BLACKBOX_SECTOR_SIZE, BLACKBOX_SECTOR_SIZE);
+    }
+    // El lazo no abre el sector hasta ver el contador ya incrementado
+    __dmb();
+    bb_erased++;
+}
+
+/**
+ * @brief Empieza a llenar el buffer activo en el siguiente sector borrado.
+ *
+ * @return Falso si no queda ningún sector borrado.
+ */
+static bool blackbox_open_sector() {
+    if (bb_erased == bb_opened) {
+        return false;
+    }
+    __dmb();
+    BlackboxBuffer *buf = &bb_buf[bb_fill];
+    memset(buf->data, 0xFF, sizeof(buf->data));
+    buf->sector = (bb_start + bb_opened) % BB_SECTORS;
+    buf->pages_done = 0;
+    buf->closed = false;
+    bb_opened++;
+
+    BlackboxSectorHeader header = {
+        .magic = BLACKBOX_MAGIC,
+        .sequence = bb_sequence++,
+        .session = bb_session,
+        .fields = BLACKBOX_FIELDS,
+        .reserved = 0,
+    };
+    memcpy(buf->data, &header, sizeof(header));
+    buf->len = sizeof(header);
+    memset(bb_prev, 0, sizeof(bb_prev));
+
+    // El núcleo 1 solo mira el buffer cuando ya está entero
+    __dmb();
+    buf->in_use = true;
+    return true;
+}
+
+/**
+ * @brief Busca la cabeza del anillo y deja borrada la zona por delante.
+ *
+ * @return Falso si la zona del registro se solapa con el programa.
+ */
+bool blackbox_init() {
+    if ((uintptr_t)&__flash_binary_end - XIP_BASE > BB_REGION_OFFSET) {
+        bb_enabled = false;
+        return false;
+    }
+
+    // El sector con la mayor secuencia es el último escrito; se sigue por el siguiente
+    bool found = false;
+    uint32_t last = 0;
+    bb_start = 0;
+    for (uint32_t s = 0; s < BB_SECTORS; s++) {
+        BlackboxSectorHeader header;
+        memcpy(&header, blackbox_sector_ptr(s), sizeof(header));
+        if (header.magic != BLACKBOX_MAGIC) {
+            continue;
+        }
+        if (!found || (int32_t)(header.sequence - bb_sequence) > 0) {
+            bb_sequence = header.sequence;
+            last = s;
+        }
+        if (!found || (int32_t)(header.session - bb_session) > 0) {
+            bb_session = header.session;
+        }
+        found = true;
+    }
+    if (found) {
+        bb_start = (last + 1) % BB_SECTORS;
+        bb_sequence++;
+        bb_session++;
+    }
+
+    bb_opened = 0;
+    bb_erased = 0;
+    while (bb_erased < BB_ERASE_AHEAD) {
+        blackbox_erase_next();
+    }
+
+    bb_buf[0].in_use = false;
+    bb_buf[1].in_use = false;
+    bb_fill = 0;
+    bb_enabled = blackbox_open_sector();
+    return true;
+}
+
+/**
+ * @brief Codifica un registro en el buffer de RAM activo.
+ *
+ * @param fields Valor de cada campo (BlackboxField).
+ */
+void blackbox_record(const int32_t fields[BLACKBOX_FIELDS]) {
+    if (!bb_enabled) {
+        return;
+    }
+
+    BlackboxBuffer *buf = &bb_buf[bb_fill];
+    if (buf->closed || BLACKBOX_SECTOR_SIZE - buf->len < 1 + BLACKBOX_FIELDS * 5) {
+        // Sector lleno: se cierra y se pasa al otro buffer si ya terminó de programarse
+        __dmb();
+        buf->closed = true;
+        if (bb_buf[bb_fill ^ 1].in_use) {
+            bb_dropped++;
+            return;
+        }
+        bb_fill ^= 1;
+        if (!blackbox_open_sector()) {
+            bb_fill ^= 1;
+            bb_dropped++;
+            return;
+        }
+        buf = &bb_buf[bb_fill];
+    }
+
+    // Diferencias con el registro anterior, en zigzag y varint, tras el byte de longitud
+    uint8_t *out = &buf->data[buf->len];
+    uint32_t n = 1;
+    for (uint32_t i = 0; i < BLACKBOX_FIELDS; i++) {
+        n += blackbox_put_varint(&out[n], (int32_t)((uint32_t)fields[i] - (uint32_t)bb_prev[i]));
+        bb_prev[i] = fields[i];
+    }
+    out[0] = (uint8_t)(n - 1);
+
+    // Los datos antes que la longitud: el núcleo 1 programa hasta donde dice len
+    __dmb();
+    buf->len += n;
+}
+
+/**
+ * @brief Programa la siguiente página pendiente de un buffer, si la hay.
+ *
+ * @param buf Buffer a programar.
+ * @param pages Páginas del buffer que ya se pueden programar.
+ * @return Verdadero si programó una página.
+ */
+static bool blackbox_program_page(BlackboxBuffer *buf, uint32_t pages) {
+    if (buf->pages_done >= pages) {
+        return false;
+    }
+    uint32_t offset = buf->pages_done * BLACKBOX_PAGE_SIZE;
+    flash_range_program(BB_REGION_OFFSET + buf->sector * BLACKBOX_SECTOR_SIZE + offset, &buf->data[offset],
+                        BLACKBOX_PAGE_SIZE);
+    buf->pages_done++;
+    return true;
+}
+
+/**
+ * @brief Programa la siguiente página de un buffer en uso con el estado pedido.
+ *
+ * De un buffer cerrado se programa hasta la última página con datos y después se
+ * devuelve al lazo; del activo, solo las páginas ya completas.
+ *
+ * @param buf Buffer a revisar.
+ * @param closed Estado de cierre que debe tener el buffer.
+ * @return Verdadero si programó una página.
+ */
+static bool blackbox_flush(BlackboxBuffer *buf, bool closed) {
+    if (!buf->in_use || buf->closed != closed) {
+        return false;
+    }
+    // Con el buffer cerrado, len ya no cambia
+    __dmb();
+    uint32_t len = buf->len;
+    __dmb();
+    uint32_t pages = closed ? (len + BLACKBOX_PAGE_SIZE - 1) / BLACKBOX_PAGE_SIZE : len / BLACKBOX_PAGE_SIZE;
+    if (blackbox_program_page(buf, pages)) {
+        return true;
+    }
+    if (closed) {
+        __dmb();
+        buf->in_use = false;
+    }
+    return false;
+}
+
+/**
+ * @brief Trabajo de fondo: programa una página pendiente o, si no hay, borra un sector.
+ *
+ * @param may_erase Verdadero si ahora se puede bloquear el llamante unos 45 ms.
+ */
+void blackbox_service(bool may_erase) {
+    if (!bb_enabled) {
+        return;
+    }
+
+    // Primero los buffers cerrados y luego las páginas ya completas del activo
+    for (int i = 0; i < 2; i++) {
+        if (blackbox_flush(&bb_buf[i], true)) {
+            return;
+        }
+    }
+    for (int i = 0; i < 2; i++) {
+        if (blackbox_flush(&bb_buf[i], false)) {
+            return;
+        }
+    }
+
+    // Con la reserva a la mitad se borra sin permiso: el anillo nunca se detiene
+    uint32_t reserve = bb_erased - bb_opened;
+    if (reserve < BB_ERASE_AHEAD && (may_erase || reserve < BB_ERASE_LOW)) {
+        blackbox_erase_next();
+    }
+}
+
+/**
+ * @brief Hilo del núcleo 1: blackbox_service() sin fin; no retorna.
+ */
+void blackbox_run() {
+    while (1) {
+        blackbox_service(true);
+        // Espera activa: el núcleo 1 no tiene nada más que hacer y no pide interrupciones al 0
+        busy_wait_us(BB_RUN_IDLE_US);
+    }
+}
+
+/**
+ * @brief Registros descartados desde el arranque.
+ *
+ * @return Registros perdidos por buffer lleno o por falta de flash borrada.
+ */
+uint32_t blackbox_drops() {
+    return bb_dropped;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file blackbox.h
+ * @brief Registro de vuelo en la zona libre de la flash QSPI.
+ */
+
+#ifndef BLACKBOX_H
+#define BLACKBOX_H
+
+#include "pico/stdlib.h"
+#include "blackbox_format.h"
+
+#ifndef BLACKBOX
+#define BLACKBOX 0                  ///< 1 para guardar cada salida del control en la flash
+#endif
+
+#ifndef BLACKBOX_FLASH_KB
+#define BLACKBOX_FLASH_KB 1024      ///< Tamaño del anillo, al final de la flash
+#endif
+
+#ifndef BLACKBOX_ERASE_AHEAD_KB
+#define BLACKBOX_ERASE_AHEAD_KB 512 ///< Flash que se mantiene borrada por delante de la cabeza
+#endif
+
+/**
+ * @brief Busca la cabeza del anillo y deja borrada la zona por delante.
+ *
+ * Bloquea mientras borra (unos 45 ms por sector que no estuviera ya en blanco), así
+ * que se llama antes de arrancar los planificadores y el núcleo 1. Los sectores de
+ * detrás de la cabeza, con los vuelos anteriores, no se tocan hasta que el anillo
+ * da la vuelta.
+ *
+ * @return Falso si la zona del registro se solapa con el programa.
+ */
+bool blackbox_init();
+
+/**
+ * @brief Codifica un registro en el buffer de RAM activo.
+ *
+ * Solo copia y codifica; nunca toca la flash. Si el buffer se llena mientras el otro
+ * aún se está programando, el registro se descarta y se cuenta.
+ *
+ * @param fields Valor de cada campo (BlackboxField).
+ */
+void blackbox_record(const int32_t fields[BLACKBOX_FIELDS]);
+
+/**
+ * @brief Trabajo de fondo: programa una página pendiente o, si no hay, borra un sector.
+ *
+ * Debe llamarse siempre desde el núcleo 1, nunca desde el del lazo de control. Borra
+ * por delante de la cabeza si se permite o, aunque no se permita, si la reserva
+ * borrada ha bajado de la mitad, de modo que el anillo sigue sobrescribiendo el
+ * sector más antiguo durante todo el vuelo.
+ *
+ * @param may_erase Verdadero si ahora se puede bloquear el llamante unos 45 ms.
+ */
+void blackbox_service(bool may_erase);
+
+/**
+ * @brief Hilo del núcleo 1: blackbox_service() sin fin.
+ *
+ * El hilo del núcleo 1 no tiene otro trabajo (con FLIGHT_MULTICORE el receptor y los
+ * servos corren en la interrupción de su tic), así que se borra en cuanto hay sitio
+ * en la reserva.
+ */
+void blackbox_run();
+
+/**
+ * @brief Registros descartados desde el arranque.
+ *
+ * @return Registros perdidos por buffer lleno o por falta de flash borrada.
+ */
+uint32_t blackbox_drops();
+
+#endif // BLACKBOX_H
@@ -0,0 +1,108 @@
+/**
+ * @file blackbox_format.h
+ * @brief Formato del registro de vuelo en la flash, compartido con las herramientas del PC.
+ *
+ * La zona del registro es un anillo de sectores de 4 KB. Cada sector empieza con una
+ * BlackboxSectorHeader y sigue con registros:
+ *
+ *     longitud (1 byte, 1..254) | BLACKBOX_FIELDS varints
+ *
+ * Cada campo se guarda como la diferencia con el mismo campo del registro anterior,
+ * en zigzag y varint (7 bits por byte). El primer registro de cada sector se codifica
+ * contra ceros, de modo que cada sector se decodifica solo. Un byte de longitud 0xFF
+ * (flash borrada) marca el final de los datos del sector.
+ *
+ * El número de secuencia crece en cada sector escrito y nunca vuelve atrás: el mayor
+ * indica dónde quedó la cabeza del anillo y el orden de lectura.
+ *
+ * Solo depende de la biblioteca estándar de C.
+ */
+
+#ifndef BLACKBOX_FORMAT_H
+#define BLACKBOX_FORMAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BLACKBOX_SECTOR_SIZE 4096           ///< Unidad de borrado de la flash
+#define BLACKBOX_PAGE_SIZE 256              ///< Unidad de programación de la flash
+#define BLACKBOX_MAGIC 0x31584242u          ///< "BBX1" en little-endian
+#define BLACKBOX_END 0xFF                   ///< Longitud que marca el final del sector
+#define BLACKBOX_MAX_RECORD 254             ///< Mayor registro codificado
+
+/**
+ * @brief Campos de cada registro, en el orden en que se codifican.
+ */
+typedef enum {
+    BB_TIMESTAMP_US,    ///< Instante de la salida del controlador
+    BB_RC_CN1,          ///< Pulso del receptor, us
+    BB_RC_CN2,
+    BB_RC_CN4,
+    BB_RC_CN6,
+    BB_ACCEL_X,         ///< Última muestra del acelerómetro
+    BB_ACCEL_Y,
+    BB_ACCEL_Z,
+    BB_PITCH_CDEG,      ///< Pitch del acelerómetro, centésimas de grado
+    BB_FILTERED_CDEG,   ///< Pitch estimado, centésimas de grado
+    BB_P_TERM_MILLI,    ///< Término proporcional del eje de pitch, milésimas
+    BB_I_TERM_MILLI,    ///< Término integral del eje de pitch, milésimas
+    BB_D_TERM_MILLI,    ///< Término derivativo del eje de pitch, milésimas
+    BB_OUTPUT_PITCH_MILLI, ///< Salida del eje de pitch, milésimas
+    BB_OUTPUT_ROLL_MILLI,  ///< Salida del eje de alabeo, milésimas
+    BB_WING_RIGHT_US,   ///< Pulso del ala derecha
+    BB_WING_LEFT_US,    ///< Pulso del ala izquierda
+    BLACKBOX_FIELDS     ///< Número de campos
+} BlackboxField;
+
+/**
+ * @brief Cabecera de cada sector.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;     ///< BLACKBOX_MAGIC
+    uint32_t sequence;  ///< Orden de escritura del sector
+    uint32_t session;   ///< Arranque de la placa que escribió el sector
+    uint16_t fields;    ///< BLACKBOX_FIELDS al escribirlo
+    uint16_t reserved;  ///< A cero
+} BlackboxSectorHeader;
+
+_Static_assert(BLACKBOX_FIELDS * 5 + 1 <= BLACKBOX_MAX_RECORD, "Un registro no cabe en el byte de longitud");
+
+/**
+ * @brief Codifica un entero con signo en zigzag y varint.
+ *
+ * @param out Destino (hasta 5 bytes).
+ * @param value Valor a codificar.
+ * @return Bytes escritos.
+ */
+static inline uint32_t blackbox_put_varint(uint8_t *out, int32_t value) {
+    uint32_t zz = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    uint32_t n = 0;
+    while (zz >= 0x80) {
+        out[n++] = (uint8_t)(zz | 0x80);
+        zz >>= 7;
+    }
+    out[n++] = (uint8_t)zz;
+    return n;
+}
+
+/**
+ * @brief Decodifica un entero en zigzag y varint.
+ *
+ * @param in Bytes codificados.
+ * @param len Bytes disponibles.
+ * @param value Valor decodificado.
+ * @return Bytes leídos, o 0 si el varint está cortado o es demasiado largo.
+ */
+static inline uint32_t blackbox_get_varint(const uint8_t *in, uint32_t len, int32_t *value) {
+    uint32_t zz = 0;
+    for (uint32_t n = 0; n < len && n < 5; n++) {
+        zz |= (uint32_t)(in[n] & 0x7F) << (7 * n);
+        if (!(in[n] & 0x80)) {
+            *value = (int32_t)((zz >> 1) ^ (0u - (zz & 1)));
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+#endif // BLACKBOX_FORMAT_H
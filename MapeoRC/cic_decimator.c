@@ -0,0 +1,66 @@
+/**
+ * @file cic_decimator.c
+ * @brief Decimador CIC de orden 2 (sinc^2) en aritmética entera.
+ *
+ * Equivale a dos medias móviles de ratio muestras en cascada seguidas de un
+ * diezmado, pero con un coste por muestra de entrada de dos sumas por eje. El
+ * primer nulo de la respuesta cae en la frecuencia de salida, así que la
+ * vibración por encima de ella se atenúa antes de bajar la frecuencia. El retardo
+ * de grupo es (ratio - 1) muestras de entrada.
+ */
+
+#include "cic_decimator.h"
+
+/**
+ * @brief Inicializa el decimador.
+ *
+ * @param cic Puntero al decimador.
+ * @param ratio Factor de decimación (1 a CIC_MAX_RATIO; 1 deja pasar las muestras).
+ */
+void cic_init(CicDecimator *cic, uint32_t ratio) {
+    if (ratio < 1) {
+        ratio = 1;
+    }
+    if (ratio > CIC_MAX_RATIO) {
+        ratio = CIC_MAX_RATIO;
+    }
+    for (int i = 0; i < CIC_AXES; i++) {
+        cic->integ1[i] = 0;
+        cic->integ2[i] = 0;
+        cic->comb1[i] = 0;
+        cic->comb2[i] = 0;
+    }
+    cic->ratio = ratio;
+    cic->count = 0;
+}
+
+/**
+ * @brief Añade una muestra de entrada; cada ratio muestras produce una salida.
+ *
+ * @param cic Puntero al decimador.
+ * @param in Muestra de entrada en cuentas.
+ * @param out Salida filtrada en cuentas con CIC_OUTPUT_FRAC_BITS bits fraccionarios.
+ * @return Verdadero si se escribió una salida.
+ */
+bool cic_push(CicDecimator *cic, const int16_t in[CIC_AXES], int32_t out[CIC_AXES]) {
+    for (int i = 0; i < CIC_AXES; i++) {
+        cic->integ1[i] += (uint32_t)(int32_t)in[i];
+        cic->integ2[i] += cic->integ1[i];
+    }
+    if (++cic->count < cic->ratio) {
+        return false;
+    }
+    cic->count = 0;
+
+    int32_t gain = (int32_t)(cic->ratio * cic->ratio);
+    for (int i = 0; i < CIC_AXES; i++) {
+        uint32_t c1 = cic->integ2[i] - cic->comb1[i];
+        cic->comb1[i] = cic->integ2[i];
+        uint32_t c2 = c1 - cic->comb2[i];
+        cic->comb2[i] = c1;
+
+        // c2 es la suma ponderada de las últimas 2 * ratio - 1 entradas, con ganancia ratio^2
+        out[i] = (int32_t)c2 * (1 << CIC_OUTPUT_FRAC_BITS) / gain;
+    }
+    return true;
+}
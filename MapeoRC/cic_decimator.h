@@ -0,0 +1,53 @@
+/**
+ * @file cic_decimator.h
+ * @brief Decimador CIC de orden 2 en aritmética entera para las tres componentes del acelerómetro.
+ */
+
+#ifndef CIC_DECIMATOR_H
+#define CIC_DECIMATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CIC_AXES 3              ///< Componentes por muestra
+#define CIC_MAX_RATIO 32        ///< Mayor factor de decimación admitido
+#define CIC_OUTPUT_FRAC_BITS 4  ///< Bits fraccionarios de la salida (cuentas x 16)
+
+/**
+ * @brief Estado del decimador: dos integradores a la frecuencia de entrada y dos peines a la de salida.
+ *
+ * Los registros son uint32_t y desbordan a propósito: con aritmética modular la
+ * salida del peine es exacta siempre que quepa en 32 bits (16 bits de entrada más
+ * 2 * log2(ratio) de ganancia).
+ */
+typedef struct {
+    uint32_t integ1[CIC_AXES];  ///< Primer integrador
+    uint32_t integ2[CIC_AXES];  ///< Segundo integrador
+    uint32_t comb1[CIC_AXES];   ///< Entrada anterior del primer peine
+    uint32_t comb2[CIC_AXES];   ///< Entrada anterior del segundo peine
+    uint32_t ratio;             ///< Factor de decimación
+    uint32_t count;             ///< Muestras de entrada desde la última salida
+} CicDecimator;
+
+/**
+ * @brief Inicializa el decimador.
+ *
+ * @param cic Puntero al decimador.
+ * @param ratio Factor de decimación (1 a CIC_MAX_RATIO; 1 deja pasar las muestras).
+ */
+void cic_init(CicDecimator *cic, uint32_t ratio);
+
+/**
+ * @brief Añade una muestra de entrada; cada ratio muestras produce una salida.
+ *
+ * Por muestra de entrada solo hace dos sumas por componente; la división por la
+ * ganancia (ratio^2) se hace una vez por salida.
+ *
+ * @param cic Puntero al decimador.
+ * @param in Muestra de entrada en cuentas.
+ * @param out Salida filtrada en cuentas con CIC_OUTPUT_FRAC_BITS bits fraccionarios.
+ * @return Verdadero si se escribió una salida.
+ */
+bool cic_push(CicDecimator *cic, const int16_t in[CIC_AXES], int32_t out[CIC_AXES]);
+
+#endif // CIC_DECIMATOR_H
@@ -0,0 +1,368 @@
+/**
+ * @file control_fixed.c
+ * @brief Filtro de Kalman y controlador PID en punto fijo Q16.16.
+ *
+ * Sustituyen a las versiones en float de control_pid.c cuando CONTROL_FIXED_POINT
+ * vale 1, con la misma interfaz: las entradas y salidas siguen siendo float y solo
+ * se convierten en los bordes, mientras que la recursión usa aritmética entera con
+ * saturación.
+ *
+ * Tolerancia frente a las versiones en float, con pitch en [-90, 90] grados,
+ * q en [0.001, 0.1], r en [0.01, 1], kp <= 5, ki <= 1, kd <= 0.5 y dt de 1 ms a
+ * 100 ms: el estado del filtro difiere menos de 0.04 grados y la salida del PID
+ * menos de 0.05 + 0.1 % de su valor. La excepción son los términos que superan el
+ * rango de Q16.16 (+-32768) y saturan, como la patada derivativa del primer paso
+ * con dt de 1 ms. dt y las variancias, la covarianza y la ganancia del filtro usan
+ * más bits fraccionarios que Q16.16 para que esto se cumpla con pasos de 1 ms y con
+ * la ganancia estacionaria de q·dt pequeños. tools/fixed_check.c comprueba
+ * la tolerancia contra las versiones en float.
+ */
+
+#include "control_pid.h"
+
+#if CONTROL_FIXED_POINT
+
+#define DT_FRAC_BITS 30 ///< dt en Q2.30: 1 ms queda con un error relativo de 1e-6 en lugar del 0.7 %
+#define Q_PER_US_SHIFT 19 ///< Bits extra de q por microsegundo: q = 128 aún cabe en 32 bits
+/// q, r, covarianza y ganancia del filtro en Q8.24: q·dt de un paso de 1 ms no se redondea a cero
+#define P_FRAC_BITS 24
+#define P_ONE ((int32_t)1 << P_FRAC_BITS)
+/// Cambio de ganancia en Q8.24 por debajo del cual la recursión ha convergido (KALMAN_STEADY_TOLERANCE)
+#define K_STEADY_TOLERANCE 16
+
+/**
+ * @brief Corrige el estado con la ganancia vigente.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @param z Medida en Q16.16.
+ */
+static inline void kalman_apply_gain(KalmanFilter *filter, q16_t z) {
+    filter->x = q16_add(filter->x, q_mul_shift(filter->k, q16_sub(z, filter->x), P_FRAC_BITS));
+}
+
+/**
+ * @brief Ganancia y corrección con una medida, compartidas por kalman_update() y kalman_correct().
+ *
+ * La ganancia p / (p + r) queda en Q8.24 como p: con q·dt pequeño la ganancia
+ * estacionaria baja de 0.01 y en Q16.16 tendría un error relativo de casi el 0.2 %.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @param z Medida en Q16.16.
+ */
+static void kalman_fuse(KalmanFilter *filter, q16_t z) {
+    filter->k = q_ratio_shift((uint32_t)filter->p, (uint32_t)q16_add(filter->p, filter->r), P_FRAC_BITS);
+    kalman_apply_gain(filter, z);
+    filter->p = q_mul_shift(filter->p, P_ONE - filter->k, P_FRAC_BITS);
+}
+
+/**
+ * @brief Inicializa el filtro de Kalman.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @param q Variancia del proceso.
+ * @param r Variancia de la medida.
+ * @param initial_value Valor inicial estimado.
+ */
+void kalman_init(KalmanFilter *filter, float q, float r, float initial_value) {
+    filter->q = q_from_float_shift(q, P_FRAC_BITS);
+    // La única división por 1e6 de kalman_correct(), hecha aquí una vez
+    filter->q_per_us = (uint32_t)((((uint64_t)MAX(filter->q, 0) << Q_PER_US_SHIFT) + 500000) / 1000000);
+    filter->r = q_from_float_shift(r, P_FRAC_BITS);
+    filter->x = q16_from_float(initial_value);
+    filter->p = P_ONE;
+    filter->k = 0;
+    filter->steady_mode = false;
+    filter->steady = false;
+    filter->timestamped = false;
+    filter->nominal_dt_us = 0;
+}
+
+/**
+ * @brief Fija la ganancia estacionaria para los q y r actuales.
+ *
+ * La raíz se calcula en float: solo ocurre al iniciar o tras cambiar q o r.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ */
+static void kalman_enter_steady(KalmanFilter *filter) {
+    // Con periodo nominal q es por segundo: la variancia de un paso es q por ese periodo
+    float q = (float)filter->q / P_ONE;
+    if (filter->nominal_dt_us) {
+        q *= filter->nominal_dt_us * 1e-6f;
+    }
+    float r = (float)filter->r / P_ONE;
+    float k = KALMAN_STEADY_GAIN(q, r);
+    filter->k = q_from_float_shift(k, P_FRAC_BITS);
+    filter->p = q_from_float_shift(KALMAN_STEADY_PRIOR(q, r) * (1.0f - k), P_FRAC_BITS);
+    filter->ss_q = filter->q;
+    filter->ss_r = filter->r;
+    filter->steady = true;
+}
+
+/**
+ * @brief Inicializa el filtro de Kalman en modo de ganancia estacionaria.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @param q Variancia del proceso.
+ * @param r Variancia de la medida.
+ * @param initial_value Valor inicial estimado.
+ * @param nominal_dt_us Periodo nominal entre medidas de kalman_correct(), o 0.
+ */
+void kalman_init_steady(KalmanFilter *filter, float q, float r, float initial_value, uint32_t nominal_dt_us) {
+    kalman_init(filter, q, r, initial_value);
+    filter->nominal_dt_us = nominal_dt_us;
+    filter->steady_mode = true;
+    kalman_enter_steady(filter);
+}
+
+/**
+ * @brief Aplica el filtro de Kalman a un valor nuevo.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @param measurement Nueva medida.
+ * @return Valor estimado actualizado.
+ */
+float kalman_update(KalmanFilter *filter, float measurement) {
+    q16_t z = q16_from_float(measurement);
+
+    // Ganancia estacionaria vigente: una multiplicación y una suma
+    if (filter->steady && filter->q == filter->ss_q && filter->r == filter->ss_r) {
+        kalman_apply_gain(filter, z);
+        return q16_to_float(filter->x);
+    }
+    filter->steady = false;
+
+    // Predicción
+    filter->p = q16_add(filter->p, filter->q);
+
+    // Actualización
+    int32_t previous_k = filter->k;
+    kalman_fuse(filter, z);
+
+    // Tras cambiar q o r, vuelve a la ganancia estacionaria cuando la recursión converge
+    int32_t change = filter->k - previous_k;
+    if (filter->steady_mode && change <= K_STEADY_TOLERANCE && change >= -K_STEADY_TOLERANCE) {
+        kalman_enter_steady(filter);
+    }
+
+    return q16_to_float(filter->x);
+}
+
+/**
+ * @brief Predicción del filtro para un intervalo de tiempo arbitrario.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @param dt Tiempo desde la predicción anterior, en segundos.
+ */
+void kalman_predict(KalmanFilter *filter, float dt) {
+    filter->steady = false;
+    int32_t dt_q = q_from_float_shift(dt, DT_FRAC_BITS);
+    filter->p = q16_add(filter->p, q_mul_shift(filter->q, dt_q, DT_FRAC_BITS));
+}
+
+/**
+ * @brief Predicción hasta el instante de una medida y corrección con ella.
+ *
+ * q·dt se calcula con el intervalo en us directamente en la escala de la covarianza.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @param measurement Nueva medida.
+ * @param timestamp_us Instante de adquisición de la medida en us.
+ * @return Verdadero si la medida era nueva y se fusionó.
+ */
+bool kalman_correct(KalmanFilter *filter, float measurement, uint32_t timestamp_us) {
+    uint32_t dt_us = timestamp_us - filter->last_timestamp_us;
+    if (filter->timestamped && (int32_t)dt_us <= 0) {
+        return false;
+    }
+    bool first = !filter->timestamped;
+    filter->last_timestamp_us = timestamp_us;
+    filter->timestamped = true;
+    q16_t z = q16_from_float(measurement);
+
+    // Intervalo nominal con la ganancia estacionaria vigente: una multiplicación y una suma
+    bool nominal = first || KALMAN_PERIOD_IS_NOMINAL(dt_us, filter->nominal_dt_us);
+    if (filter->steady && nominal && filter->q == filter->ss_q && filter->r == filter->ss_r) {
+        kalman_apply_gain(filter, z);
+        return true;
+    }
+    filter->steady = false;
+
+    // Predicción hasta el instante de esta medida (con pausas de más de 10 s la covarianza ya satura)
+    if (!first) {
+        int64_t gap_us = MIN(dt_us, 10000000u);
+        filter->p = q16_add(filter->p, q16_sat(((uint64_t)filter->q_per_us * gap_us) >> Q_PER_US_SHIFT));
+    }
+    int32_t previous_k = filter->k;
+    kalman_fuse(filter, z);
+
+    // Vuelve a la ganancia estacionaria cuando la recursión converge al intervalo nominal
+    int32_t change = filter->k - previous_k;
+    if (filter->steady_mode && nominal && filter->nominal_dt_us && change <= K_STEADY_TOLERANCE &&
+        change >= -K_STEADY_TOLERANCE) {
+        kalman_enter_steady(filter);
+    }
+    return true;
+}
+
+/**
+ * @brief Valor estimado actual del filtro.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @return Valor estimado.
+ */
+float kalman_estimate(const KalmanFilter *filter) {
+    return q16_to_float(filter->x);
+}
+
+/**
+ * @brief Inicializa el controlador PID.
+ *
+ * @param controller Puntero a la estructura del controlador PID.
+ * @param kp Ganancia proporcional.
+ * @param ki Ganancia integral.
+ * @param kd Ganancia derivativa.
+ * @param setpoint Punto de referencia deseado.
+ */
+void pid_controller_init(PIDController *controller, float kp, float ki, float kd, float setpoint) {
+    controller->kp = q16_from_float(kp);
+    controller->ki = q16_from_float(ki);
+    controller->kd = q16_from_float(kd);
+    controller->integral = 0;
+    controller->previous_error = 0;
+    controller->setpoint = q16_from_float(setpoint);
+    controller->dt_bits = 0;
+    controller->dt_q = 0;
+    controller->inv_dt = 0;
+}
+
+/**
+ * @brief Calcula la salida del controlador PID.
+ *
+ * @param controller Puntero a la estructura del controlador PID.
+ * @param measured_value Valor medido.
+ * @param dt Intervalo de tiempo desde la última actualización.
+ * @return Señal de control calculada.
+ */
+float pid_controller_update(PIDController *controller, float measured_value, float dt) {
+    // dt y 1/dt solo se recalculan cuando cambia dt: a periodo fijo, ninguna división
+    uint32_t dt_bits;
+    memcpy(&dt_bits, &dt, sizeof(dt_bits));
+    if (dt_bits != controller->dt_bits) {
+        controller->dt_bits = dt_bits;
+        controller->dt_q = q_from_float_shift(dt, DT_FRAC_BITS);
+        controller->inv_dt = q_div_shift(Q16_ONE, controller->dt_q, DT_FRAC_BITS);
+    }
+
+    q16_t error = q16_sub(controller->setpoint, q16_from_float(measured_value));
+    controller->integral = q16_add(controller->integral, q_mul_shift(error, controller->dt_q, DT_FRAC_BITS));
+    q16_t derivative = q16_mul(q16_sub(error, controller->previous_error), controller->inv_dt);
+    q16_t control_output = q16_add(q16_add(q16_mul(controller->kp, error),
+                                           q16_mul(controller->ki, controller->integral)),
+                                   q16_mul(controller->kd, derivative));
+    controller->previous_error = error;
+    return q16_to_float(control_output);
+}
+
+/**
+ * @brief Recalcula los coeficientes a partir de las ganancias y la frecuencia.
+ *
+ * Se calculan en float y se convierten: solo ocurre al iniciar o al cambiar la sintonía.
+ *
+ * @param pid Puntero al controlador.
+ */
+static void pid_incremental_coefficients(PIDIncremental *pid) {
+    float period = 1.0f / pid->rate_hz;
+    float kd_t = pid->kd * pid->rate_hz;
+    pid->a0 = q16_from_float(pid->kp + pid->ki * period + kd_t);
+    pid->a1 = q16_from_float(-pid->kp - 2.0f * kd_t);
+    pid->a2 = q16_from_float(kd_t);
+}
+
+/**
+ * @brief Inicializa un PID incremental para una frecuencia de actualización fija.
+ *
+ * @param pid Puntero al controlador.
+ * @param kp Ganancia proporcional.
+ * @param ki Ganancia integral.
+ * @param kd Ganancia derivativa.
+ * @param rate_hz Frecuencia de actualización en Hz.
+ * @param out_min Límite inferior de la salida.
+ * @param out_max Límite superior de la salida.
+ */
+void pid_incremental_init(PIDIncremental *pid, float kp, float ki, float kd, float rate_hz,
+                          float out_min, float out_max) {
+    pid->kp = kp;
+    pid->ki = ki;
+    pid->kd = kd;
+    pid->rate_hz = rate_hz;
+    pid->out_min = q16_from_float(out_min);
+    pid->out_max = q16_from_float(out_max);
+    pid->setpoint = 0;
+    pid_incremental_coefficients(pid);
+    pid_incremental_reset(pid, 0.0f);
+}
+
+/**
+ * @brief Cambia las ganancias y recalcula los coeficientes.
+ *
+ * @param pid Puntero al controlador.
+ * @param kp Ganancia proporcional.
+ * @param ki Ganancia integral.
+ * @param kd Ganancia derivativa.
+ */
+void pid_incremental_set_gains(PIDIncremental *pid, float kp, float ki, float kd) {
+    pid->kp = kp;
+    pid->ki = ki;
+    pid->kd = kd;
+    pid_incremental_coefficients(pid);
+}
+
+/**
+ * @brief Cambia la frecuencia de actualización y recalcula los coeficientes.
+ *
+ * @param pid Puntero al controlador.
+ * @param rate_hz Frecuencia de actualización en Hz.
+ */
+void pid_incremental_set_rate(PIDIncremental *pid, float rate_hz) {
+    pid->rate_hz = rate_hz;
+    pid_incremental_coefficients(pid);
+}
+
+/**
+ * @brief Transferencia sin saltos: el controlador continúa desde una salida dada.
+ *
+ * @param pid Puntero al controlador.
+ * @param output Salida actual del actuador, en unidades del controlador.
+ */
+void pid_incremental_reset(PIDIncremental *pid, float output) {
+    q16_t out = q16_from_float(output);
+    pid->output = MIN(MAX(out, pid->out_min), pid->out_max);
+    pid->primed = false;
+}
+
+/**
+ * @brief Actualiza el controlador con un nuevo valor medido.
+ *
+ * @param pid Puntero al controlador.
+ * @param measured_value Valor medido.
+ * @return Señal de control calculada.
+ */
+float pid_incremental_update(PIDIncremental *pid, float measured_value) {
+    q16_t error = q16_sub(pid->setpoint, q16_from_float(measured_value));
+    if (!pid->primed) {
+        pid->error1 = error;
+        pid->error2 = error;
+        pid->primed = true;
+    }
+
+    q16_t output = q16_add(pid->output, q16_add(q16_mul(pid->a0, error),
+                                                q16_add(q16_mul(pid->a1, pid->error1),
+                                                        q16_mul(pid->a2, pid->error2))));
+    pid->output = MIN(MAX(output, pid->out_min), pid->out_max);
+    pid->error2 = pid->error1;
+    pid->error1 = error;
+    return q16_to_float(pid->output);
+}
+
+#endif // CONTROL_FIXED_POINT
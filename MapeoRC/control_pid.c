@@ -4,6 +4,10 @@
  */
 
 #include "control_pid.h"
+#include "fast_math.h"
+#if !CONTROL_PID_HOST
+#include "i2c_async.h"
+#endif
 
 #define GY85_ADDR 0x53 ///< Dirección del acelerómetro en la GY-85
 #define PI 3.14159265358979323846 ///< Valor de PI
@@ -30,6 +34,7 @@
 
 
 
+#if !CONTROL_FIXED_POINT
 /**
  * @brief Inicializa el filtro de Kalman.
  * 
@@ -44,6 +49,41 @@ void kalman_init(KalmanFilter *filter, float q, float r, float initial_value) {
     filter->x = initial_value;
     filter->p = 1.0;
     filter->k = 0.0;
+    filter->steady_mode = false;
+    filter->steady = false;
+    filter->timestamped = false;
+    filter->nominal_dt_us = 0;
+}
+
+/**
+ * @brief Fija la ganancia estacionaria para los q y r actuales.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ */
+static void kalman_enter_steady(KalmanFilter *filter) {
+    // Con periodo nominal q es por segundo: la variancia de un paso es q por ese periodo
+    float q_step = filter->nominal_dt_us ? filter->q * (filter->nominal_dt_us * 1e-6f) : filter->q;
+    filter->k = KALMAN_STEADY_GAIN(q_step, filter->r);
+    filter->p = KALMAN_STEADY_PRIOR(q_step, filter->r) * (1 - filter->k);
+    filter->ss_q = filter->q;
+    filter->ss_r = filter->r;
+    filter->steady = true;
+}
+
+/**
+ * @brief Inicializa el filtro de Kalman en modo de ganancia estacionaria.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @param q Variancia del proceso.
+ * @param r Variancia de la medida.
+ * @param initial_value Valor inicial estimado.
+ * @param nominal_dt_us Periodo nominal entre medidas de kalman_correct(), o 0.
+ */
+void kalman_init_steady(KalmanFilter *filter, float q, float r, float initial_value, uint32_t nominal_dt_us) {
+    kalman_init(filter, q, r, initial_value);
+    filter->nominal_dt_us = nominal_dt_us;
+    filter->steady_mode = true;
+    kalman_enter_steady(filter);
 }
 
 /**
@@ -54,14 +94,90 @@ void kalman_init(KalmanFilter *filter, float q, float r, float initial_value) {
  * @return Valor estimado actualizado.
  */
 float kalman_update(KalmanFilter *filter, float measurement) {
+    // Ganancia estacionaria vigente: una multiplicación y una suma
+    if (filter->steady && filter->q == filter->ss_q && filter->r == filter->ss_r) {
+        filter->x += filter->k * (measurement - filter->x);
+        return filter->x;
+    }
+    filter->steady = false;
+
     // Predicción
     filter->p += filter->q;
 
     // Actualización
+    float previous_k = filter->k;
     filter->k = filter->p / (filter->p + filter->r);
     filter->x += filter->k * (measurement - filter->x);
     filter->p *= (1 - filter->k);
 
+    // Tras cambiar q o r, vuelve a la ganancia estacionaria cuando la recursión converge
+    if (filter->steady_mode && fabsf(filter->k - previous_k) < KALMAN_STEADY_TOLERANCE) {
+        kalman_enter_steady(filter);
+    }
+
+    return filter->x;
+}
+
+/**
+ * @brief Predicción del filtro para un intervalo de tiempo arbitrario.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @param dt Tiempo desde la predicción anterior, en segundos.
+ */
+void kalman_predict(KalmanFilter *filter, float dt) {
+    filter->steady = false;
+    filter->p += filter->q * dt;
+}
+
+/**
+ * @brief Predicción hasta el instante de una medida y corrección con ella.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @param measurement Nueva medida.
+ * @param timestamp_us Instante de adquisición de la medida en us.
+ * @return Verdadero si la medida era nueva y se fusionó.
+ */
+bool kalman_correct(KalmanFilter *filter, float measurement, uint32_t timestamp_us) {
+    uint32_t dt_us = timestamp_us - filter->last_timestamp_us;
+    if (filter->timestamped && (int32_t)dt_us <= 0) {
+        return false;
+    }
+    bool first = !filter->timestamped;
+    filter->last_timestamp_us = timestamp_us;
+    filter->timestamped = true;
+
+    // Intervalo nominal con la ganancia estacionaria vigente: una multiplicación y una suma
+    bool nominal = first || KALMAN_PERIOD_IS_NOMINAL(dt_us, filter->nominal_dt_us);
+    if (filter->steady && nominal && filter->q == filter->ss_q && filter->r == filter->ss_r) {
+        filter->x += filter->k * (measurement - filter->x);
+        return true;
+    }
+    filter->steady = false;
+
+    // Predicción hasta el instante de esta medida y corrección
+    if (!first) {
+        filter->p += filter->q * (dt_us * 1e-6f);
+    }
+    float previous_k = filter->k;
+    filter->k = filter->p / (filter->p + filter->r);
+    filter->x += filter->k * (measurement - filter->x);
+    filter->p *= 1.0f - filter->k;
+
+    // Vuelve a la ganancia estacionaria cuando la recursión converge al intervalo nominal
+    if (filter->steady_mode && nominal && filter->nominal_dt_us &&
+        fabsf(filter->k - previous_k) < KALMAN_STEADY_TOLERANCE) {
+        kalman_enter_steady(filter);
+    }
+    return true;
+}
+
+/**
+ * @brief Valor estimado actual del filtro.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @return Valor estimado.
+ */
+float kalman_estimate(const KalmanFilter *filter) {
     return filter->x;
 }
 
@@ -100,11 +216,235 @@ float pid_controller_update(PIDController *controller, float measured_value, flo
     return control_output;
 }
 
+/**
+ * @brief Recalcula los coeficientes a partir de las ganancias y la frecuencia.
+ *
+ * @param pid Puntero al controlador.
+ */
+static void pid_incremental_coefficients(PIDIncremental *pid) {
+    float period = 1.0f / pid->rate_hz;
+    float kd_t = pid->kd * pid->rate_hz;
+    pid->a0 = pid->kp + pid->ki * period + kd_t;
+    pid->a1 = -pid->kp - 2.0f * kd_t;
+    pid->a2 = kd_t;
+}
+
+/**
+ * @brief Inicializa un PID incremental para una frecuencia de actualización fija.
+ *
+ * @param pid Puntero al controlador.
+ * @param kp Ganancia proporcional.
+ * @param ki Ganancia integral.
+ * @param kd Ganancia derivativa.
+ * @param rate_hz Frecuencia de actualización en Hz.
+ * @param out_min Límite inferior de la salida.
+ * @param out_max Límite superior de la salida.
+ */
+void pid_incremental_init(PIDIncremental *pid, float kp, float ki, float kd, float rate_hz,
+                          float out_min, float out_max) {
+    pid->kp = kp;
+    pid->ki = ki;
+    pid->kd = kd;
+    pid->rate_hz = rate_hz;
+    pid->out_min = out_min;
+    pid->out_max = out_max;
+    pid->setpoint = 0.0f;
+    pid_incremental_coefficients(pid);
+    pid_incremental_reset(pid, 0.0f);
+}
+
+/**
+ * @brief Cambia las ganancias y recalcula los coeficientes.
+ *
+ * @param pid Puntero al controlador.
+ * @param kp Ganancia proporcional.
+ * @param ki Ganancia integral.
+ * @param kd Ganancia derivativa.
+ */
+void pid_incremental_set_gains(PIDIncremental *pid, float kp, float ki, float kd) {
+    pid->kp = kp;
+    pid->ki = ki;
+    pid->kd = kd;
+    pid_incremental_coefficients(pid);
+}
+
+/**
+ * @brief Cambia la frecuencia de actualización y recalcula los coeficientes.
+ *
+ * @param pid Puntero al controlador.
+ * @param rate_hz Frecuencia de actualización en Hz.
+ */
+void pid_incremental_set_rate(PIDIncremental *pid, float rate_hz) {
+    pid->rate_hz = rate_hz;
+    pid_incremental_coefficients(pid);
+}
+
+/**
+ * @brief Transferencia sin saltos: el controlador continúa desde una salida dada.
+ *
+ * @param pid Puntero al controlador.
+ * @param output Salida actual del actuador, en unidades del controlador.
+ */
+void pid_incremental_reset(PIDIncremental *pid, float output) {
+    pid->output = MIN(MAX(output, pid->out_min), pid->out_max);
+    pid->primed = false;
+}
+
+/**
+ * @brief Actualiza el controlador con un nuevo valor medido.
+ *
+ * @param pid Puntero al controlador.
+ * @param measured_value Valor medido.
+ * @return Señal de control calculada.
+ */
+float pid_incremental_update(PIDIncremental *pid, float measured_value) {
+    float error = pid->setpoint - measured_value;
+    if (!pid->primed) {
+        pid->error1 = error;
+        pid->error2 = error;
+        pid->primed = true;
+    }
+
+    float output = pid->output + pid->a0 * error + pid->a1 * pid->error1 + pid->a2 * pid->error2;
+    pid->output = MIN(MAX(output, pid->out_min), pid->out_max);
+    pid->error2 = pid->error1;
+    pid->error1 = error;
+    return pid->output;
+}
+#endif
+
+/**
+ * @brief Vacía la banca de controladores.
+ *
+ * @param bank Puntero a la banca.
+ */
+void pid_bank_init(PIDBank *bank) {
+    bank->num_axes = 0;
+    bank->primed = false;
+}
+
+/**
+ * @brief Añade un eje a la banca.
+ *
+ * @param bank Puntero a la banca.
+ * @param kp Ganancia proporcional.
+ * @param ki Ganancia integral.
+ * @param kd Ganancia derivativa.
+ * @param out_min Límite inferior de la salida.
+ * @param out_max Límite superior de la salida.
+ * @return Índice del eje o -1 si la banca está llena.
+ */
+int pid_bank_add_axis(PIDBank *bank, float kp, float ki, float kd, float out_min, float out_max) {
+    if (bank->num_axes >= PID_BANK_MAX_AXES) {
+        return -1;
+    }
+    uint32_t i = bank->num_axes++;
+    bank->kp[i] = kp;
+    bank->ki[i] = ki;
+    bank->kd[i] = kd;
+    bank->out_min[i] = out_min;
+    bank->out_max[i] = out_max;
+    bank->setpoint[i] = 0.0f;
+    bank->d_tau[i] = 0.0f;
+    bank->d_on_measurement[i] = false;
+    bank->integral[i] = 0.0f;
+    bank->previous_error[i] = 0.0f;
+    bank->previous_measured[i] = 0.0f;
+    bank->derivative[i] = 0.0f;
+    bank->output[i] = 0.0f;
+    return (int)i;
+}
+
+/**
+ * @brief Borra el estado de todos los ejes de la banca sin tocar su configuración.
+ *
+ * @param bank Puntero a la banca.
+ */
+void pid_bank_reset(PIDBank *bank) {
+    for (uint32_t i = 0; i < bank->num_axes; i++) {
+        bank->integral[i] = 0.0f;
+        bank->previous_error[i] = 0.0f;
+        bank->previous_measured[i] = 0.0f;
+        bank->derivative[i] = 0.0f;
+        bank->output[i] = 0.0f;
+    }
+    bank->primed = false;
+}
+
+/**
+ * @brief Configura el término derivativo de un eje.
+ *
+ * @param bank Puntero a la banca.
+ * @param axis Índice del eje.
+ * @param cutoff_hz Frecuencia de corte del filtro en Hz (0 = sin filtro).
+ * @param on_measurement Verdadero para derivar la medida en lugar del error.
+ */
+void pid_bank_set_derivative(PIDBank *bank, int axis, float cutoff_hz, bool on_measurement) {
+    bank->d_tau[axis] = cutoff_hz > 0.0f ? 1.0f / (2.0f * (float)PI * cutoff_hz) : 0.0f;
+    bank->d_on_measurement[axis] = on_measurement;
+}
+
+/**
+ * @brief Actualiza todos los ejes de la banca en una pasada.
+ *
+ * @param bank Puntero a la banca.
+ * @param measured Valor medido de cada eje (num_axes valores).
+ * @param dt Intervalo de tiempo desde la última actualización; si no es positivo, no hace nada.
+ */
+void pid_bank_update(PIDBank *bank, const float *measured, float dt) {
+    // Con dt nulo, negativo o NaN no hay derivada ni integral válidas: se conserva la salida
+    if (!(dt > 0.0f)) {
+        return;
+    }
+    float inv_dt = 1.0f / dt;
+    for (uint32_t i = 0; i < bank->num_axes; i++) {
+        float error = bank->setpoint[i] - measured[i];
+
+        // Derivada del error o de la medida (con el signo del error), filtrada
+        float raw_derivative = 0.0f;
+        if (bank->primed) {
+            raw_derivative = bank->d_on_measurement[i] ? (bank->previous_measured[i] - measured[i]) * inv_dt
+                                                       : (error - bank->previous_error[i]) * inv_dt;
+        }
+        float alpha = dt / (dt + bank->d_tau[i]);
+        bank->derivative[i] += alpha * (raw_derivative - bank->derivative[i]);
+        bank->previous_error[i] = error;
+        bank->previous_measured[i] = measured[i];
+
+        // El término integral no puede pasar por sí solo de los límites de la salida
+        float integral = bank->integral[i] + error * dt;
+        float i_term = bank->ki[i] * integral;
+        if (i_term > bank->out_max[i] || i_term < bank->out_min[i]) {
+            integral = bank->integral[i];
+            i_term = bank->ki[i] * integral;
+        }
+
+        float out = bank->kp[i] * error + i_term + bank->kd[i] * bank->derivative[i];
+
+        // Saturada y con el error empujando hacia el mismo límite: se congela el integrador
+        if (out > bank->out_max[i]) {
+            out = bank->out_max[i];
+            if (error > 0.0f) {
+                integral = bank->integral[i];
+            }
+        } else if (out < bank->out_min[i]) {
+            out = bank->out_min[i];
+            if (error < 0.0f) {
+                integral = bank->integral[i];
+            }
+        }
+        bank->integral[i] = integral;
+        bank->output[i] = out;
+    }
+    bank->primed = true;
+}
+
+#if !CONTROL_PID_HOST
 /**
  * @brief Inicializa la interfaz I2C.
  */
 void i2c_init_gy() {
-    i2c_init(i2c0, 100 * 1000);
+    i2c_init(i2c0, GY85_I2C_BAUDRATE);
     gpio_set_function(12, GPIO_FUNC_I2C);
     gpio_set_function(13, GPIO_FUNC_I2C);
     gpio_pull_up(12);
@@ -118,8 +458,19 @@ void i2c_init_gy() {
  * @param value Valor a escribir en el registro.
  */
 void write_register(uint8_t reg, uint8_t value) {
+    write_device_register(GY85_ADDR, reg, value);
+}
+
+/**
+ * @brief Escribe en un registro de cualquier chip de la GY-85.
+ *
+ * @param addr Dirección I2C del chip.
+ * @param reg Dirección del registro.
+ * @param value Valor a escribir en el registro.
+ */
+void write_device_register(uint8_t addr, uint8_t reg, uint8_t value) {
     uint8_t buf[] = {reg, value};
-    i2c_write_blocking(i2c0, GY85_ADDR, buf, 2, false);
+    i2c_write_blocking(i2c0, addr, buf, 2, false);
 }
 
 /**
@@ -130,8 +481,20 @@ void write_register(uint8_t reg, uint8_t value) {
  * @param len Número de registros a leer.
  */
 void read_registers(uint8_t reg, uint8_t *buf, uint8_t len) {
-    i2c_write_blocking(i2c0, GY85_ADDR, &reg, 1, true);
-    i2c_read_blocking(i2c0, GY85_ADDR, buf, len, false);
+    read_device_registers(GY85_ADDR, reg, buf, len);
+}
+
+/**
+ * @brief Lee registros consecutivos de cualquier chip de la GY-85.
+ *
+ * @param addr Dirección I2C del chip.
+ * @param reg Dirección del primer registro a leer.
+ * @param buf Buffer donde se almacenarán los datos leídos.
+ * @param len Número de registros a leer.
+ */
+void read_device_registers(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len) {
+    i2c_write_blocking(i2c0, addr, &reg, 1, true);
+    i2c_read_blocking(i2c0, addr, buf, len, false);
 }
 
 /**
@@ -141,6 +504,31 @@ void gy85_init() {
     write_register(0x2D, 0x08); // Pone el acelerómetro en modo de medida
 }
 
+/**
+ * @brief Configura la frecuencia de muestreo, la resolución y el rango del acelerómetro.
+ *
+ * @param config Configuración deseada.
+ */
+void gy85_accel_configure(const Adxl345Config *config) {
+    // Código de BW_RATE: 0x0F = 3200 Hz y cada código menos divide la frecuencia entre 2
+    uint8_t rate = 0x0F;
+    uint32_t odr = 3200;
+    while (odr > config->odr_hz && rate > 0x06) {
+        odr /= 2;
+        rate--;
+    }
+
+    uint8_t range = 0;
+    while (range < 3 && (2u << range) < config->range_g) {
+        range++;
+    }
+
+    write_register(ADXL345_POWER_CTL, 0x00); // Reposo mientras se configura
+    write_register(ADXL345_BW_RATE, rate);
+    write_register(ADXL345_DATA_FORMAT, (config->full_res ? 0x08 : 0x00) | range);
+    write_register(ADXL345_POWER_CTL, 0x08); // Modo de medida
+}
+
 /**
  * @brief Lee los valores del acelerómetro.
  * 
@@ -156,6 +544,312 @@ void read_accelerometer(int16_t *accX, int16_t *accY, int16_t *accZ) {
     *accZ = (buf[5] << 8) | buf[4];
 }
 
+/// Buffer de la lectura asíncrona del acelerómetro, escrito por DMA
+static uint8_t accel_async_buf[6];
+static volatile bool accel_async_ready;
+static volatile bool accel_async_pending; ///< Lectura pedida que aún no terminó
+static volatile uint32_t accel_async_time_us;
+
+/**
+ * @brief Fin de la lectura asíncrona del acelerómetro (contexto de interrupción).
+ *
+ * @param ok Verdadero si la transacción terminó sin error.
+ * @param context No se usa.
+ */
+static void accel_async_done(bool ok, void *context) {
+    accel_async_time_us = time_us_32();
+    accel_async_ready = ok;
+    accel_async_pending = false;
+}
+
+/**
+ * @brief Inicia por DMA la lectura de los tres ejes del acelerómetro y retorna enseguida.
+ *
+ * Mientras la lectura anterior no termina, el DMA todavía escribe en el buffer, así
+ * que no se pide otra.
+ *
+ * @return Falso si la lectura anterior sigue en curso o la cola del bus está llena.
+ */
+bool read_accelerometer_start() {
+    if (accel_async_pending) {
+        return false;
+    }
+    accel_async_ready = false;
+    // Antes de pedirla: la interrupción de fin puede llegar antes de que retorne
+    accel_async_pending = true;
+    if (!i2c_async_read(GY85_ADDR, 0x32, accel_async_buf, 6, accel_async_done, NULL)) {
+        accel_async_pending = false;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Entrega la muestra de la última lectura asíncrona, si ya terminó.
+ *
+ * @param accX Puntero donde se almacenará el valor del eje X.
+ * @param accY Puntero donde se almacenará el valor del eje Y.
+ * @param accZ Puntero donde se almacenará el valor del eje Z.
+ * @return Verdadero si había una muestra nueva; cada muestra se entrega una sola vez.
+ */
+bool read_accelerometer_result(int16_t *accX, int16_t *accY, int16_t *accZ) {
+    if (!accel_async_ready) {
+        return false;
+    }
+    accel_async_ready = false;
+    *accX = (accel_async_buf[1] << 8) | accel_async_buf[0];
+    *accY = (accel_async_buf[3] << 8) | accel_async_buf[2];
+    *accZ = (accel_async_buf[5] << 8) | accel_async_buf[4];
+    return true;
+}
+
+/**
+ * @brief Instante en que terminó la última lectura asíncrona del acelerómetro.
+ *
+ * @return Instante en us de la muestra entregada por read_accelerometer_result().
+ */
+uint32_t read_accelerometer_timestamp_us() {
+    return accel_async_time_us;
+}
+
+/**
+ * @brief Configura el giróscopo ITG-3205 de la GY-85.
+ *
+ * @param rate_hz Frecuencia de muestreo deseada en Hz (el divisor se calcula sobre 1 kHz).
+ * @param dlpf_cfg Filtro paso bajo interno (ver ITG3205_DLPF_*).
+ */
+void gy85_gyro_init(uint32_t rate_hz, uint8_t dlpf_cfg) {
+    uint32_t div = rate_hz > 0 && rate_hz < 1000 ? 1000 / rate_hz - 1 : 0;
+    write_device_register(ITG3205_ADDR, ITG3205_PWR_MGM, 0x01);     // Reloj con el PLL del eje X
+    write_device_register(ITG3205_ADDR, ITG3205_SMPLRT_DIV, (uint8_t)MIN(div, 255u));
+    write_device_register(ITG3205_ADDR, ITG3205_DLPF_FS, 0x18 | (dlpf_cfg & 0x07)); // +-2000 grados/s
+}
+
+/**
+ * @brief Lee las velocidades angulares del giróscopo.
+ *
+ * @param gyroX Puntero donde se almacenará el valor del eje X.
+ * @param gyroY Puntero donde se almacenará el valor del eje Y.
+ * @param gyroZ Puntero donde se almacenará el valor del eje Z.
+ */
+void read_gyro(int16_t *gyroX, int16_t *gyroY, int16_t *gyroZ) {
+    uint8_t buf[6];
+    read_device_registers(ITG3205_ADDR, ITG3205_GYRO_XOUT_H, buf, 6);
+    *gyroX = (buf[0] << 8) | buf[1];
+    *gyroY = (buf[2] << 8) | buf[3];
+    *gyroZ = (buf[4] << 8) | buf[5];
+}
+
+/// Buffer de la lectura asíncrona del giróscopo, escrito por DMA
+static uint8_t gyro_async_buf[6];
+static volatile bool gyro_async_ready;
+static volatile bool gyro_async_pending; ///< Lectura pedida que aún no terminó
+
+/**
+ * @brief Fin de la lectura asíncrona del giróscopo (contexto de interrupción).
+ *
+ * @param ok Verdadero si la transacción terminó sin error.
+ * @param context No se usa.
+ */
+static void gyro_async_done(bool ok, void *context) {
+    gyro_async_ready = ok;
+    gyro_async_pending = false;
+}
+
+/**
+ * @brief Inicia por DMA la lectura de los tres ejes del giróscopo y retorna enseguida.
+ *
+ * Mientras la lectura anterior no termina, el DMA todavía escribe en el buffer, así
+ * que no se pide otra.
+ *
+ * @return Falso si la lectura anterior sigue en curso o la cola del bus está llena.
+ */
+bool read_gyro_start() {
+    if (gyro_async_pending) {
+        return false;
+    }
+    gyro_async_ready = false;
+    // Antes de pedirla: la interrupción de fin puede llegar antes de que retorne
+    gyro_async_pending = true;
+    if (!i2c_async_read(ITG3205_ADDR, ITG3205_GYRO_XOUT_H, gyro_async_buf, 6, gyro_async_done, NULL)) {
+        gyro_async_pending = false;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Entrega la muestra de la última lectura asíncrona del giróscopo, si ya terminó.
+ *
+ * @param gyroX Puntero donde se almacenará el valor del eje X.
+ * @param gyroY Puntero donde se almacenará el valor del eje Y.
+ * @param gyroZ Puntero donde se almacenará el valor del eje Z.
+ * @return Verdadero si había una muestra nueva; cada muestra se entrega una sola vez.
+ */
+bool read_gyro_result(int16_t *gyroX, int16_t *gyroY, int16_t *gyroZ) {
+    if (!gyro_async_ready) {
+        return false;
+    }
+    gyro_async_ready = false;
+    *gyroX = (gyro_async_buf[0] << 8) | gyro_async_buf[1];
+    *gyroY = (gyro_async_buf[2] << 8) | gyro_async_buf[3];
+    *gyroZ = (gyro_async_buf[4] << 8) | gyro_async_buf[5];
+    return true;
+}
+
+/**
+ * @brief Configura el magnetómetro HMC5883L en modo continuo a 75 Hz.
+ */
+void gy85_mag_init() {
+    write_device_register(HMC5883L_ADDR, HMC5883L_CONFIG_A, 0x18); // Sin promediado, 75 Hz
+    write_device_register(HMC5883L_ADDR, HMC5883L_CONFIG_B, 0x20); // +-1.3 Ga
+    write_device_register(HMC5883L_ADDR, HMC5883L_MODE, 0x00);     // Medida continua
+}
+
+/**
+ * @brief Lee el campo magnético.
+ *
+ * @param magX Puntero donde se almacenará el valor del eje X.
+ * @param magY Puntero donde se almacenará el valor del eje Y.
+ * @param magZ Puntero donde se almacenará el valor del eje Z.
+ */
+void read_magnetometer(int16_t *magX, int16_t *magY, int16_t *magZ) {
+    uint8_t buf[6];
+    read_device_registers(HMC5883L_ADDR, HMC5883L_DATA_X_MSB, buf, 6);
+    *magX = (buf[0] << 8) | buf[1];
+    *magZ = (buf[2] << 8) | buf[3];
+    *magY = (buf[4] << 8) | buf[5];
+}
+
+/// Buffer de la lectura asíncrona del magnetómetro, escrito por DMA
+static uint8_t mag_async_buf[6];
+static volatile bool mag_async_ready;
+static volatile bool mag_async_pending; ///< Lectura pedida que aún no terminó
+
+/**
+ * @brief Fin de la lectura asíncrona del magnetómetro (contexto de interrupción).
+ *
+ * @param ok Verdadero si la transacción terminó sin error.
+ * @param context No se usa.
+ */
+static void mag_async_done(bool ok, void *context) {
+    mag_async_ready = ok;
+    mag_async_pending = false;
+}
+
+/**
+ * @brief Inicia por DMA la lectura de los tres ejes del magnetómetro y retorna enseguida.
+ *
+ * Mientras la lectura anterior no termina, el DMA todavía escribe en el buffer, así
+ * que no se pide otra.
+ *
+ * @return Falso si la lectura anterior sigue en curso o la cola del bus está llena.
+ */
+bool read_magnetometer_start() {
+    if (mag_async_pending) {
+        return false;
+    }
+    mag_async_ready = false;
+    // Antes de pedirla: la interrupción de fin puede llegar antes de que retorne
+    mag_async_pending = true;
+    if (!i2c_async_read(HMC5883L_ADDR, HMC5883L_DATA_X_MSB, mag_async_buf, 6, mag_async_done, NULL)) {
+        mag_async_pending = false;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Entrega la muestra de la última lectura asíncrona del magnetómetro, si ya terminó.
+ *
+ * @param magX Puntero donde se almacenará el valor del eje X.
+ * @param magY Puntero donde se almacenará el valor del eje Y.
+ * @param magZ Puntero donde se almacenará el valor del eje Z.
+ * @return Verdadero si había una muestra nueva; cada muestra se entrega una sola vez.
+ */
+bool read_magnetometer_result(int16_t *magX, int16_t *magY, int16_t *magZ) {
+    if (!mag_async_ready) {
+        return false;
+    }
+    mag_async_ready = false;
+    *magX = (mag_async_buf[0] << 8) | mag_async_buf[1];
+    *magZ = (mag_async_buf[2] << 8) | mag_async_buf[3];
+    *magY = (mag_async_buf[4] << 8) | mag_async_buf[5];
+    return true;
+}
+#endif
+
+/**
+ * @brief Inicializa el filtro de ángulo y sesgo.
+ *
+ * @param filter Puntero al filtro.
+ * @param q_angle Variancia del proceso del ángulo (por segundo).
+ * @param q_bias Variancia del proceso del sesgo del giróscopo (por segundo).
+ * @param r_measure Variancia del ángulo medido con el acelerómetro.
+ * @param initial_angle Ángulo inicial en grados.
+ * @param initial_bias Sesgo inicial del giróscopo en grados/s.
+ */
+void angle_kalman_init(AngleKalman *filter, float q_angle, float q_bias, float r_measure,
+                       float initial_angle, float initial_bias) {
+    filter->q_angle = q_angle;
+    filter->q_bias = q_bias;
+    filter->r_measure = r_measure;
+    filter->angle = initial_angle;
+    filter->bias = initial_bias;
+    filter->rate = 0.0f;
+    filter->p[0][0] = 1.0f;
+    filter->p[0][1] = 0.0f;
+    filter->p[1][0] = 0.0f;
+    filter->p[1][1] = 1.0f;
+}
+
+/**
+ * @brief Predicción: integra la velocidad del giróscopo corregida por el sesgo estimado.
+ *
+ * @param filter Puntero al filtro.
+ * @param gyro_rate Velocidad angular medida en grados/s.
+ * @param dt Tiempo desde la predicción anterior, en segundos.
+ * @return Ángulo predicho en grados.
+ */
+float angle_kalman_predict(AngleKalman *filter, float gyro_rate, float dt) {
+    filter->rate = gyro_rate - filter->bias;
+    filter->angle += dt * filter->rate;
+
+    // P = F P F' + Q con F = [1 -dt; 0 1]
+    filter->p[0][0] += dt * (dt * filter->p[1][1] - filter->p[0][1] - filter->p[1][0] + filter->q_angle);
+    filter->p[0][1] -= dt * filter->p[1][1];
+    filter->p[1][0] -= dt * filter->p[1][1];
+    filter->p[1][1] += filter->q_bias * dt;
+
+    return filter->angle;
+}
+
+/**
+ * @brief Corrección con el ángulo medido por el acelerómetro; ajusta el ángulo y el sesgo.
+ *
+ * @param filter Puntero al filtro.
+ * @param measured_angle Ángulo medido en grados.
+ * @return Ángulo estimado en grados.
+ */
+float angle_kalman_correct(AngleKalman *filter, float measured_angle) {
+    float s = filter->p[0][0] + filter->r_measure;
+    float k0 = filter->p[0][0] / s;
+    float k1 = filter->p[1][0] / s;
+
+    float y = measured_angle - filter->angle;
+    filter->angle += k0 * y;
+    filter->bias += k1 * y;
+
+    float p00 = filter->p[0][0];
+    float p01 = filter->p[0][1];
+    filter->p[0][0] -= k0 * p00;
+    filter->p[0][1] -= k0 * p01;
+    filter->p[1][0] -= k1 * p00;
+    filter->p[1][1] -= k1 * p01;
+
+    return filter->angle;
+}
+
 /**
  * @brief Calcula los ángulos de inclinación.
  * 
@@ -164,6 +858,75 @@ void read_accelerometer(int16_t *accX, int16_t *accY, int16_t *accZ) {
  * @param accZ Valor del eje Z.
  * @param pitch Puntero donde se almacenará el ángulo de pitch calculado.
  */
-void calculate_pitch(int16_t accX, int16_t accY, int16_t accZ, float *pitch) {
-    *pitch = atan2(-accX, sqrt(accY * accY + accZ * accZ)) * 180 / PI;
+void calculate_pitch(int32_t accX, int32_t accY, int32_t accZ, float *pitch) {
+    // atan2 y raíz rápidas en float en lugar de las rutinas de double
+    float yz = (float)accY * accY + (float)accZ * accZ;
+    *pitch = fast_atan2f(-(float)accX, yz * fast_inv_sqrtf(yz)) * FAST_MATH_RAD_TO_DEG;
+}
+
+#if CONTROL_BENCHMARK
+#include <stdio.h>
+#include "cycle_counter.h"
+
+#define CONTROL_BENCHMARK_SAMPLES 256 ///< Llamadas por medida
+
+static volatile float control_benchmark_sink;
+
+/**
+ * @brief Mide los ciclos por llamada del filtro de Kalman y los PID de un eje.
+ */
+void control_benchmark() {
+    static float measurement[CONTROL_BENCHMARK_SAMPLES];
+    for (int i = 0; i < CONTROL_BENCHMARK_SAMPLES; i++) {
+        // Pitch sintético en [-45, 45] grados con algo de ruido
+        measurement[i] = (float)((i * 37) % 91 - 45) + (float)((i * 13) & 7) * 0.1f;
+    }
+    KalmanFilter filter;
+    PIDController controller;
+    PIDIncremental incremental;
+    cycle_counter_init();
+
+    kalman_init(&filter, 0.01f, 0.1f, 0.0f);
+    uint32_t start = cycle_counter_now();
+    for (int i = 0; i < CONTROL_BENCHMARK_SAMPLES; i++) {
+        control_benchmark_sink = kalman_update(&filter, measurement[i]);
+    }
+    uint32_t cycles_update = cycle_counter_elapsed(start, cycle_counter_now()) / CONTROL_BENCHMARK_SAMPLES;
+
+    // Intervalos alternos de 10 y 11 ms: la recursión completa en cada medida
+    kalman_init(&filter, 0.01f, 0.1f, 0.0f);
+    start = cycle_counter_now();
+    for (int i = 0; i < CONTROL_BENCHMARK_SAMPLES; i++) {
+        kalman_correct(&filter, measurement[i], (uint32_t)i * 10500 + (i & 1) * 500);
+    }
+    uint32_t cycles_correct = cycle_counter_elapsed(start, cycle_counter_now()) / CONTROL_BENCHMARK_SAMPLES;
+
+    kalman_init_steady(&filter, 0.01f, 0.1f, 0.0f, 10000);
+    start = cycle_counter_now();
+    for (int i = 0; i < CONTROL_BENCHMARK_SAMPLES; i++) {
+        kalman_correct(&filter, measurement[i], (uint32_t)i * 10000);
+    }
+    uint32_t cycles_steady = cycle_counter_elapsed(start, cycle_counter_now()) / CONTROL_BENCHMARK_SAMPLES;
+    control_benchmark_sink = kalman_estimate(&filter);
+
+    pid_controller_init(&controller, 1.0f, 0.1f, 0.05f, 0.0f);
+    start = cycle_counter_now();
+    for (int i = 0; i < CONTROL_BENCHMARK_SAMPLES; i++) {
+        control_benchmark_sink = pid_controller_update(&controller, measurement[i], 0.01f);
+    }
+    uint32_t cycles_pid = cycle_counter_elapsed(start, cycle_counter_now()) / CONTROL_BENCHMARK_SAMPLES;
+
+    pid_incremental_init(&incremental, 1.0f, 0.1f, 0.05f, 100.0f, -90.0f, 90.0f);
+    start = cycle_counter_now();
+    for (int i = 0; i < CONTROL_BENCHMARK_SAMPLES; i++) {
+        control_benchmark_sink = pid_incremental_update(&incremental, measurement[i]);
+    }
+    uint32_t cycles_incremental = cycle_counter_elapsed(start, cycle_counter_now()) / CONTROL_BENCHMARK_SAMPLES;
+
+    printf("Control (%s): kalman_update %lu ciclos, kalman_correct %lu, estacionario %lu, "
+           "pid_controller_update %lu, pid_incremental_update %lu\n",
+           CONTROL_FIXED_POINT ? "Q16.16" : "float", (unsigned long)cycles_update,
+           (unsigned long)cycles_correct, (unsigned long)cycles_steady, (unsigned long)cycles_pid,
+           (unsigned long)cycles_incremental);
 }
+#endif // CONTROL_BENCHMARK
@@ -6,15 +6,149 @@
 #ifndef CONTROL_PID_H
 #define CONTROL_PID_H
 
+#ifndef CONTROL_PID_HOST
+#define CONTROL_PID_HOST 0  ///< 1 para compilar solo los filtros y los PID en el PC (tools/replay.c)
+#endif
+
+#if CONTROL_PID_HOST
+#include <stdint.h>
+#include <stdbool.h>
+#define MIN(a, b) ((b) < (a) ? (b) : (a)) ///< Como en pico/platform.h
+#define MAX(a, b) ((a) < (b) ? (b) : (a)) ///< Como en pico/platform.h
+#else
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
 #include "hardware/pwm.h"
+#endif
 #include <stdio.h>
 #include <math.h>
 
 #define GY85_ADDR 0x53 ///< Dirección del acelerómetro en la GY-85
 #define PI 3.14159265358979323846 ///< Valor de PI
 
+// Registros de configuración del ADXL345
+#define ADXL345_BW_RATE 0x2C        ///< Frecuencia de muestreo
+#define ADXL345_POWER_CTL 0x2D      ///< Modo de medida / reposo
+#define ADXL345_DATA_FORMAT 0x31    ///< Resolución y rango
+
+// Giróscopo ITG-3205 de la GY-85
+#define ITG3205_ADDR 0x68           ///< Dirección del giróscopo en la GY-85
+#define ITG3205_SMPLRT_DIV 0x15     ///< Divisor de la frecuencia de muestreo
+#define ITG3205_DLPF_FS 0x16        ///< Escala y filtro paso bajo
+#define ITG3205_GYRO_XOUT_H 0x1D    ///< Primer registro de datos (big endian)
+#define ITG3205_PWR_MGM 0x3E        ///< Gestión de energía y reloj
+#define ITG3205_DLPF_98HZ 2         ///< Filtro paso bajo interno de 98 Hz
+#define ITG3205_DLPF_42HZ 3         ///< Filtro paso bajo interno de 42 Hz
+#define ITG3205_DLPF_20HZ 4         ///< Filtro paso bajo interno de 20 Hz
+#define ITG3205_LSB_PER_DPS 14.375f ///< Cuentas por grado/s
+
+// Magnetómetro HMC5883L de la GY-85
+#define HMC5883L_ADDR 0x1E          ///< Dirección del magnetómetro en la GY-85
+#define HMC5883L_CONFIG_A 0x00      ///< Promediado y frecuencia de salida
+#define HMC5883L_CONFIG_B 0x01      ///< Ganancia
+#define HMC5883L_MODE 0x02          ///< Modo de medida
+#define HMC5883L_DATA_X_MSB 0x03    ///< Primer registro de datos (X, Z, Y en big endian)
+#define HMC5883L_ODR_HZ 75          ///< Frecuencia de salida configurada (la máxima en modo continuo)
+
+#ifndef ACCEL_ODR_HZ
+#define ACCEL_ODR_HZ 100    ///< Frecuencia de muestreo del ADXL345 en Hz (25 a 3200, potencias de 2 por 100)
+#endif
+#ifndef ACCEL_RANGE_G
+#define ACCEL_RANGE_G 2     ///< Rango del ADXL345 en g (2, 4, 8 o 16)
+#endif
+#ifndef ACCEL_DECIMATION
+#define ACCEL_DECIMATION 1  ///< Muestras del sensor por cada muestra de pitch (decimador CIC)
+#endif
+
+#ifndef GY85_I2C_BAUDRATE
+#define GY85_I2C_BAUDRATE (400 * 1000) ///< Velocidad del bus I2C en Hz (modo rápido)
+#endif
+
+// Modos de lectura del acelerómetro
+#define ACCEL_MODE_POLL 0   ///< Una lectura por DMA en cada ejecución del lazo de control
+#define ACCEL_MODE_FIFO 1   ///< FIFO en modo stream vaciado por ráfagas con la interrupción de watermark
+#define ACCEL_MODE_DRDY 2   ///< Una lectura por muestra nueva, disparada por la interrupción DATA_READY
+
+#ifndef ACCEL_MODE
+#define ACCEL_MODE ACCEL_MODE_POLL ///< Modo de lectura del acelerómetro
+#endif
+
+#ifndef CONTROL_FIXED_POINT
+/// 1 para usar el filtro de Kalman de un estado, PIDController y PIDIncremental en punto fijo Q16.16;
+/// PIDBank, AngleKalman y el AHRS siguen en float
+#define CONTROL_FIXED_POINT 0
+#endif
+
+/// Covarianza predicha a la que converge el filtro de un estado: raíz de P^2 - qP - qr = 0
+#define KALMAN_STEADY_PRIOR(q, r) (((q) + sqrtf((q) * (q) + 4.0f * (q) * (r))) * 0.5f)
+
+/// Ganancia estacionaria del filtro de un estado; con q y r constantes se evalúa al compilar
+#define KALMAN_STEADY_GAIN(q, r) (KALMAN_STEADY_PRIOR(q, r) / (KALMAN_STEADY_PRIOR(q, r) + (r)))
+
+#define KALMAN_STEADY_TOLERANCE 1e-6f ///< Cambio de ganancia por debajo del cual la recursión ha convergido
+#define KALMAN_PERIOD_TOLERANCE_SHIFT 3 ///< Un intervalo a menos de 1/8 del nominal cuenta como nominal
+
+/// Intervalo entre medidas, en us, lo bastante cerca del nominal para usar la ganancia estacionaria
+#define KALMAN_PERIOD_IS_NOMINAL(dt_us, nominal_us)                                                  \
+    ((nominal_us) != 0 &&                                                                            \
+     ((dt_us) > (nominal_us) ? (dt_us) - (nominal_us) : (nominal_us) - (dt_us)) <=                   \
+         (nominal_us) >> KALMAN_PERIOD_TOLERANCE_SHIFT)
+
+#if CONTROL_FIXED_POINT
+#include "fixed_point.h"
+
+/**
+ * @brief Estructura para el filtro de Kalman en punto fijo Q16.16.
+ */
+typedef struct {
+    int32_t q; ///< Variancia del proceso en Q8.24
+    uint32_t q_per_us; ///< q por microsegundo para kalman_correct(), en Q8.24 << 19
+    int32_t r; ///< Variancia de la medida en Q8.24
+    q16_t x; ///< Valor estimado
+    int32_t p; ///< Estimación del error en Q8.24 (ver control_fixed.c)
+    int32_t k; ///< Ganancia de Kalman en Q8.24
+    bool steady_mode;   ///< Usar la ganancia estacionaria cuando q y r no cambian
+    bool steady;        ///< La ganancia estacionaria está vigente
+    int32_t ss_q;       ///< q con la que se calculó la ganancia estacionaria
+    int32_t ss_r;       ///< r con la que se calculó la ganancia estacionaria
+    uint32_t last_timestamp_us; ///< Instante de la última medida fusionada por kalman_correct()
+    bool timestamped;   ///< Ya se fusionó alguna medida con instante
+    uint32_t nominal_dt_us; ///< Periodo nominal de kalman_correct() para la ganancia estacionaria (0 = por paso)
+} KalmanFilter;
+
+/**
+ * @brief Estructura para el controlador PID en punto fijo Q16.16.
+ */
+typedef struct {
+    q16_t kp;  ///< Ganancia proporcional
+    q16_t ki;  ///< Ganancia integral
+    q16_t kd;  ///< Ganancia derivativa
+    q16_t integral; ///< Acumulador integral
+    q16_t previous_error; ///< Error anterior
+    q16_t setpoint; ///< Punto de referencia deseado
+    uint32_t dt_bits; ///< Bits del dt (float) con que se calcularon dt_q e inv_dt
+    int32_t dt_q;   ///< dt en Q2.30
+    q16_t inv_dt;   ///< 1 / dt en Q16.16
+} PIDController;
+
+/**
+ * @brief PID incremental (forma de velocidad) en punto fijo Q16.16.
+ */
+typedef struct {
+    float kp, ki, kd;   ///< Ganancias con las que se calcularon los coeficientes
+    float rate_hz;      ///< Frecuencia fija de actualización
+    q16_t a0;           ///< Coeficiente de e[k]
+    q16_t a1;           ///< Coeficiente de e[k-1]
+    q16_t a2;           ///< Coeficiente de e[k-2]
+    q16_t out_min;      ///< Límite inferior de la salida
+    q16_t out_max;      ///< Límite superior de la salida
+    q16_t setpoint;     ///< Punto de referencia deseado
+    q16_t output;       ///< Salida anterior u[k-1]
+    q16_t error1;       ///< Error e[k-1]
+    q16_t error2;       ///< Error e[k-2]
+    bool primed;        ///< Ya hay errores anteriores
+} PIDIncremental;
+#else
 /**
  * @brief Estructura para el filtro de Kalman.
  */
@@ -24,6 +158,13 @@ typedef struct {
     float x; ///< Valor estimado
     float p; ///< Estimación del error
     float k; ///< Ganancia de Kalman
+    bool steady_mode;   ///< Usar la ganancia estacionaria cuando q y r no cambian
+    bool steady;        ///< La ganancia estacionaria está vigente
+    float ss_q;         ///< q con la que se calculó la ganancia estacionaria
+    float ss_r;         ///< r con la que se calculó la ganancia estacionaria
+    uint32_t last_timestamp_us; ///< Instante de la última medida fusionada por kalman_correct()
+    bool timestamped;   ///< Ya se fusionó alguna medida con instante
+    uint32_t nominal_dt_us; ///< Periodo nominal de kalman_correct() para la ganancia estacionaria (0 = por paso)
 } KalmanFilter;
 
 /**
@@ -38,6 +179,67 @@ typedef struct {
     float setpoint; ///< Punto de referencia deseado
 } PIDController;
 
+/**
+ * @brief PID incremental (forma de velocidad) con coeficientes precalculados.
+ */
+typedef struct {
+    float kp, ki, kd;   ///< Ganancias con las que se calcularon los coeficientes
+    float rate_hz;      ///< Frecuencia fija de actualización
+    float a0;           ///< Coeficiente de e[k]
+    float a1;           ///< Coeficiente de e[k-1]
+    float a2;           ///< Coeficiente de e[k-2]
+    float out_min;      ///< Límite inferior de la salida
+    float out_max;      ///< Límite superior de la salida
+    float setpoint;     ///< Punto de referencia deseado
+    float output;       ///< Salida anterior u[k-1]
+    float error1;       ///< Error e[k-1]
+    float error2;       ///< Error e[k-2]
+    bool primed;        ///< Ya hay errores anteriores
+} PIDIncremental;
+#endif
+
+#define PID_BANK_MAX_AXES 6 ///< Ejes que caben en una banca de controladores
+
+/**
+ * @brief Banca de controladores PID para varios ejes, en estructura de arreglos.
+ *
+ * Cada campo es un arreglo indexado por eje, de modo que pid_bank_update()
+ * recorre memoria contigua en una sola pasada con un dt común. Siempre en float.
+ */
+typedef struct {
+    uint32_t num_axes;                      ///< Ejes en uso
+    float kp[PID_BANK_MAX_AXES];            ///< Ganancia proporcional
+    float ki[PID_BANK_MAX_AXES];            ///< Ganancia integral
+    float kd[PID_BANK_MAX_AXES];            ///< Ganancia derivativa
+    float out_min[PID_BANK_MAX_AXES];       ///< Límite inferior de la salida
+    float out_max[PID_BANK_MAX_AXES];       ///< Límite superior de la salida
+    float setpoint[PID_BANK_MAX_AXES];      ///< Punto de referencia deseado
+    float d_tau[PID_BANK_MAX_AXES];         ///< Constante de tiempo del filtro de la derivada (0 = sin filtro)
+    bool d_on_measurement[PID_BANK_MAX_AXES]; ///< Deriva la medida en lugar del error
+    float integral[PID_BANK_MAX_AXES];      ///< Acumulador integral
+    float previous_error[PID_BANK_MAX_AXES]; ///< Error anterior
+    float previous_measured[PID_BANK_MAX_AXES]; ///< Medida anterior
+    float derivative[PID_BANK_MAX_AXES];    ///< Derivada filtrada
+    float output[PID_BANK_MAX_AXES];        ///< Última salida calculada
+    bool primed;                            ///< Ya hubo una actualización (hay medida anterior)
+} PIDBank;
+
+/**
+ * @brief Filtro de Kalman de dos estados (ángulo y sesgo del giróscopo).
+ *
+ * Integra la velocidad del giróscopo en cada predicción y corrige el ángulo y el
+ * sesgo con el ángulo del acelerómetro. Siempre en float.
+ */
+typedef struct {
+    float q_angle;      ///< Variancia del proceso del ángulo
+    float q_bias;       ///< Variancia del proceso del sesgo
+    float r_measure;    ///< Variancia de la medida del acelerómetro
+    float angle;        ///< Ángulo estimado en grados
+    float bias;         ///< Sesgo estimado del giróscopo en grados/s
+    float rate;         ///< Última velocidad corregida en grados/s
+    float p[2][2];      ///< Covarianza del error
+} AngleKalman;
+
 /**
  * @brief Inicializa el filtro de Kalman.
  * 
@@ -48,6 +250,36 @@ typedef struct {
  */
 void kalman_init(KalmanFilter *filter, float q, float r, float initial_value);
 
+/**
+ * @brief Configuración del acelerómetro ADXL345.
+ */
+typedef struct {
+    uint32_t odr_hz;    ///< Frecuencia de muestreo en Hz (se redondea hacia abajo a 3200 / 2^n)
+    uint8_t range_g;    ///< Rango en g: 2, 4, 8 o 16
+    bool full_res;      ///< Resolución completa: 3.9 mg/LSB en cualquier rango (hasta 13 bits)
+} Adxl345Config;
+
+/**
+ * @brief Inicializa el filtro de Kalman en modo de ganancia estacionaria.
+ *
+ * La ganancia a la que converge la recursión se calcula una vez y cada
+ * actualización queda en una multiplicación y una suma. Si después se cambia q o
+ * r en la estructura, el filtro vuelve solo a la recursión completa y, cuando la
+ * ganancia converge otra vez, a la estacionaria con los valores nuevos.
+ *
+ * Con nominal_dt_us = 0 la ganancia es la de kalman_update(), con q por paso. Con
+ * un periodo nominal es la de kalman_correct(), con q por segundo: las medidas que
+ * llegan a ese intervalo usan la ganancia fija y las demás pasan por la recursión
+ * completa con su intervalo real.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @param q Variancia del proceso.
+ * @param r Variancia de la medida.
+ * @param initial_value Valor inicial estimado.
+ * @param nominal_dt_us Periodo nominal entre medidas de kalman_correct(), o 0.
+ */
+void kalman_init_steady(KalmanFilter *filter, float q, float r, float initial_value, uint32_t nominal_dt_us);
+
 /**
  * @brief Inicializa el controlador PID.
  * 
@@ -69,6 +301,16 @@ void i2c_init_gy();
  */
 void gy85_init();
 
+/**
+ * @brief Configura la frecuencia de muestreo, la resolución y el rango del acelerómetro.
+ *
+ * Con I2C a 400 kHz el fabricante recomienda no pasar de 800 Hz; 1600 y 3200 Hz
+ * solo se sostienen con lecturas por ráfagas y el bus libre.
+ *
+ * @param config Configuración deseada.
+ */
+void gy85_accel_configure(const Adxl345Config *config);
+
 /**
  * @brief Inicializa el PWM.
  */
@@ -83,6 +325,46 @@ void pwm_init_s();
  */
 float kalman_update(KalmanFilter *filter, float measurement);
 
+/**
+ * @brief Predicción del filtro para un intervalo de tiempo arbitrario.
+ *
+ * Con kalman_predict() y kalman_correct() q es la variancia del proceso por
+ * segundo. El modelo es de valor constante, así que solo crece la incertidumbre.
+ * kalman_correct() ya predice desde la medida anterior hasta la suya: esta función
+ * solo añade incertidumbre fuera de ese intervalo. Anula la ganancia estacionaria.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @param dt Tiempo desde la predicción anterior, en segundos.
+ */
+void kalman_predict(KalmanFilter *filter, float dt);
+
+/**
+ * @brief Predicción hasta el instante de una medida y corrección con ella.
+ *
+ * La incertidumbre crece con q por el tiempo entre los instantes de adquisición de
+ * esta medida y de la anterior fusionada, así que cada muestra de una ráfaga se
+ * predice con su propio intervalo. La primera medida no predice. Si el intervalo
+ * es el nominal de kalman_init_steady(), la corrección usa la ganancia fija.
+ *
+ * Una medida con el mismo instante que la última fusionada, o anterior, se
+ * descarta: repetir un dato viejo haría creer al filtro que tiene más
+ * información de la que tiene.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @param measurement Nueva medida.
+ * @param timestamp_us Instante de adquisición de la medida en us.
+ * @return Verdadero si la medida era nueva y se fusionó.
+ */
+bool kalman_correct(KalmanFilter *filter, float measurement, uint32_t timestamp_us);
+
+/**
+ * @brief Valor estimado actual del filtro.
+ *
+ * @param filter Puntero a la estructura del filtro de Kalman.
+ * @return Valor estimado.
+ */
+float kalman_estimate(const KalmanFilter *filter);
+
 /**
  * @brief Actualiza el controlador PID con un nuevo valor medido.
  * 
@@ -93,6 +375,68 @@ float kalman_update(KalmanFilter *filter, float measurement);
  */
 float pid_controller_update(PIDController *controller, float measured_value, float dt);
 
+/**
+ * @brief Inicializa un PID incremental para una frecuencia de actualización fija.
+ *
+ * La salida se calcula como u[k] = u[k-1] + a0·e[k] + a1·e[k-1] + a2·e[k-2], con
+ * a0 = kp + ki·T + kd/T, a1 = -kp - 2·kd/T y a2 = kd/T. El periodo T queda dentro
+ * de los coeficientes, así que la actualización no multiplica ni divide por dt.
+ *
+ * @param pid Puntero al controlador.
+ * @param kp Ganancia proporcional.
+ * @param ki Ganancia integral.
+ * @param kd Ganancia derivativa.
+ * @param rate_hz Frecuencia de actualización en Hz.
+ * @param out_min Límite inferior de la salida.
+ * @param out_max Límite superior de la salida.
+ */
+void pid_incremental_init(PIDIncremental *pid, float kp, float ki, float kd, float rate_hz,
+                          float out_min, float out_max);
+
+/**
+ * @brief Cambia las ganancias y recalcula los coeficientes.
+ *
+ * La salida acumulada se conserva, de modo que el cambio no produce saltos.
+ *
+ * @param pid Puntero al controlador.
+ * @param kp Ganancia proporcional.
+ * @param ki Ganancia integral.
+ * @param kd Ganancia derivativa.
+ */
+void pid_incremental_set_gains(PIDIncremental *pid, float kp, float ki, float kd);
+
+/**
+ * @brief Cambia la frecuencia de actualización y recalcula los coeficientes.
+ *
+ * @param pid Puntero al controlador.
+ * @param rate_hz Frecuencia de actualización en Hz.
+ */
+void pid_incremental_set_rate(PIDIncremental *pid, float rate_hz);
+
+/**
+ * @brief Transferencia sin saltos: el controlador continúa desde una salida dada.
+ *
+ * Se usa al pasar de mando manual a automático. La siguiente actualización toma
+ * su error como historia, así que solo actúa el término integral y la salida
+ * arranca desde el valor indicado.
+ *
+ * @param pid Puntero al controlador.
+ * @param output Salida actual del actuador, en unidades del controlador.
+ */
+void pid_incremental_reset(PIDIncremental *pid, float output);
+
+/**
+ * @brief Actualiza el controlador con un nuevo valor medido.
+ *
+ * La salida se limita a [out_min, out_max]; como cada paso parte de la salida ya
+ * limitada, el término integral no se acumula durante la saturación.
+ *
+ * @param pid Puntero al controlador.
+ * @param measured_value Valor medido.
+ * @return Señal de control calculada.
+ */
+float pid_incremental_update(PIDIncremental *pid, float measured_value);
+
 /**
  * @brief Escribe un valor en un registro del sensor.
  * 
@@ -110,6 +454,25 @@ void write_register(uint8_t reg, uint8_t value);
  */
 void read_registers(uint8_t reg, uint8_t *buf, uint8_t len);
 
+/**
+ * @brief Escribe un valor en un registro de cualquier chip de la GY-85.
+ *
+ * @param addr Dirección I2C del chip.
+ * @param reg Dirección del registro.
+ * @param value Valor a escribir en el registro.
+ */
+void write_device_register(uint8_t addr, uint8_t reg, uint8_t value);
+
+/**
+ * @brief Lee registros consecutivos de cualquier chip de la GY-85.
+ *
+ * @param addr Dirección I2C del chip.
+ * @param reg Dirección del primer registro a leer.
+ * @param buf Buffer donde se almacenarán los datos leídos.
+ * @param len Número de registros a leer.
+ */
+void read_device_registers(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len);
+
 /**
  * @brief Lee los valores del acelerómetro.
  * 
@@ -119,14 +482,210 @@ void read_registers(uint8_t reg, uint8_t *buf, uint8_t len);
  */
 void read_accelerometer(int16_t *accX, int16_t *accY, int16_t *accZ);
 
+/**
+ * @brief Inicia por DMA la lectura de los tres ejes del acelerómetro y retorna enseguida.
+ *
+ * Requiere i2c_async_init() sobre i2c0; desde entonces el bus ya no debe usarse con
+ * las funciones bloqueantes.
+ *
+ * @return Falso si la lectura anterior sigue en curso o la cola del bus está llena.
+ */
+bool read_accelerometer_start();
+
+/**
+ * @brief Entrega la muestra de la última lectura asíncrona, si ya terminó.
+ *
+ * @param accX Puntero donde se almacenará el valor del eje X.
+ * @param accY Puntero donde se almacenará el valor del eje Y.
+ * @param accZ Puntero donde se almacenará el valor del eje Z.
+ * @return Verdadero si había una muestra nueva; cada muestra se entrega una sola vez.
+ */
+bool read_accelerometer_result(int16_t *accX, int16_t *accY, int16_t *accZ);
+
+/**
+ * @brief Instante en que terminó la última lectura asíncrona del acelerómetro.
+ *
+ * @return Instante en us de la muestra entregada por read_accelerometer_result().
+ */
+uint32_t read_accelerometer_timestamp_us();
+
+/**
+ * @brief Configura el giróscopo ITG-3205 de la GY-85.
+ *
+ * @param rate_hz Frecuencia de muestreo deseada en Hz (el divisor se calcula sobre 1 kHz).
+ * @param dlpf_cfg Filtro paso bajo interno (ver ITG3205_DLPF_*).
+ */
+void gy85_gyro_init(uint32_t rate_hz, uint8_t dlpf_cfg);
+
+/**
+ * @brief Lee las velocidades angulares del giróscopo.
+ *
+ * @param gyroX Puntero donde se almacenará el valor del eje X.
+ * @param gyroY Puntero donde se almacenará el valor del eje Y.
+ * @param gyroZ Puntero donde se almacenará el valor del eje Z.
+ */
+void read_gyro(int16_t *gyroX, int16_t *gyroY, int16_t *gyroZ);
+
+/**
+ * @brief Inicia por DMA la lectura de los tres ejes del giróscopo y retorna enseguida.
+ *
+ * @return Falso si la lectura anterior sigue en curso o la cola del bus está llena.
+ */
+bool read_gyro_start();
+
+/**
+ * @brief Entrega la muestra de la última lectura asíncrona del giróscopo, si ya terminó.
+ *
+ * @param gyroX Puntero donde se almacenará el valor del eje X.
+ * @param gyroY Puntero donde se almacenará el valor del eje Y.
+ * @param gyroZ Puntero donde se almacenará el valor del eje Z.
+ * @return Verdadero si había una muestra nueva; cada muestra se entrega una sola vez.
+ */
+bool read_gyro_result(int16_t *gyroX, int16_t *gyroY, int16_t *gyroZ);
+
+/**
+ * @brief Configura el magnetómetro HMC5883L en modo continuo a 75 Hz.
+ */
+void gy85_mag_init();
+
+/**
+ * @brief Lee el campo magnético.
+ *
+ * @param magX Puntero donde se almacenará el valor del eje X.
+ * @param magY Puntero donde se almacenará el valor del eje Y.
+ * @param magZ Puntero donde se almacenará el valor del eje Z.
+ */
+void read_magnetometer(int16_t *magX, int16_t *magY, int16_t *magZ);
+
+/**
+ * @brief Inicia por DMA la lectura de los tres ejes del magnetómetro y retorna enseguida.
+ *
+ * @return Falso si la lectura anterior sigue en curso o la cola del bus está llena.
+ */
+bool read_magnetometer_start();
+
+/**
+ * @brief Entrega la muestra de la última lectura asíncrona del magnetómetro, si ya terminó.
+ *
+ * @param magX Puntero donde se almacenará el valor del eje X.
+ * @param magY Puntero donde se almacenará el valor del eje Y.
+ * @param magZ Puntero donde se almacenará el valor del eje Z.
+ * @return Verdadero si había una muestra nueva; cada muestra se entrega una sola vez.
+ */
+bool read_magnetometer_result(int16_t *magX, int16_t *magY, int16_t *magZ);
+
+/**
+ * @brief Vacía la banca de controladores.
+ *
+ * @param bank Puntero a la banca.
+ */
+void pid_bank_init(PIDBank *bank);
+
+/**
+ * @brief Añade un eje a la banca.
+ *
+ * @param bank Puntero a la banca.
+ * @param kp Ganancia proporcional.
+ * @param ki Ganancia integral.
+ * @param kd Ganancia derivativa.
+ * @param out_min Límite inferior de la salida.
+ * @param out_max Límite superior de la salida.
+ * @return Índice del eje o -1 si la banca está llena.
+ */
+int pid_bank_add_axis(PIDBank *bank, float kp, float ki, float kd, float out_min, float out_max);
+
+/**
+ * @brief Borra el estado de todos los ejes de la banca sin tocar su configuración.
+ *
+ * Integral, medida y error anteriores, derivada filtrada y salida vuelven a cero, y
+ * la siguiente actualización no deriva (como la primera tras iniciar la banca). Se
+ * llama al volver a cerrar el lazo, para que no continúe desde el estado de hace
+ * segundos ni derive contra una medida antigua. Ganancias, límites y setpoints se
+ * conservan.
+ *
+ * @param bank Puntero a la banca.
+ */
+void pid_bank_reset(PIDBank *bank);
+
+/**
+ * @brief Configura el término derivativo de un eje.
+ *
+ * Derivar la medida evita el salto de la salida cuando cambia el setpoint (por
+ * ejemplo, el que manda el lazo externo de una cascada); el filtro paso bajo de
+ * primer orden limita el ruido que el término derivativo amplifica.
+ *
+ * @param bank Puntero a la banca.
+ * @param axis Índice del eje.
+ * @param cutoff_hz Frecuencia de corte del filtro en Hz (0 = sin filtro).
+ * @param on_measurement Verdadero para derivar la medida en lugar del error.
+ */
+void pid_bank_set_derivative(PIDBank *bank, int axis, float cutoff_hz, bool on_measurement);
+
+/**
+ * @brief Actualiza todos los ejes de la banca en una pasada.
+ *
+ * La salida de cada eje se limita a [out_min, out_max]. Antienrollamiento: el
+ * integrador se congela mientras la salida está saturada y el error empuja hacia
+ * el mismo límite, y el término integral nunca pasa por sí solo de los límites.
+ *
+ * @param bank Puntero a la banca.
+ * @param measured Valor medido de cada eje (num_axes valores).
+ * @param dt Intervalo de tiempo desde la última actualización; si no es positivo, la
+ *           banca no cambia y conserva la salida anterior.
+ */
+void pid_bank_update(PIDBank *bank, const float *measured, float dt);
+
+/**
+ * @brief Inicializa el filtro de ángulo y sesgo.
+ *
+ * @param filter Puntero al filtro.
+ * @param q_angle Variancia del proceso del ángulo (por segundo).
+ * @param q_bias Variancia del proceso del sesgo del giróscopo (por segundo).
+ * @param r_measure Variancia del ángulo medido con el acelerómetro.
+ * @param initial_angle Ángulo inicial en grados.
+ * @param initial_bias Sesgo inicial del giróscopo en grados/s.
+ */
+void angle_kalman_init(AngleKalman *filter, float q_angle, float q_bias, float r_measure,
+                       float initial_angle, float initial_bias);
+
+/**
+ * @brief Predicción: integra la velocidad del giróscopo corregida por el sesgo estimado.
+ *
+ * @param filter Puntero al filtro.
+ * @param gyro_rate Velocidad angular medida en grados/s.
+ * @param dt Tiempo desde la predicción anterior, en segundos.
+ * @return Ángulo predicho en grados.
+ */
+float angle_kalman_predict(AngleKalman *filter, float gyro_rate, float dt);
+
+/**
+ * @brief Corrección con el ángulo medido por el acelerómetro; ajusta el ángulo y el sesgo.
+ *
+ * @param filter Puntero al filtro.
+ * @param measured_angle Ángulo medido en grados.
+ * @return Ángulo estimado en grados.
+ */
+float angle_kalman_correct(AngleKalman *filter, float measured_angle);
+
 /**
  * @brief Calcula el ángulo de pitch basado en los valores del acelerómetro.
+ *
+ * Solo depende de la proporción entre ejes, así que admite muestras en cualquier
+ * escala (cuentas crudas o la salida con bits fraccionarios del decimador).
  * 
  * @param accX Valor del eje X.
  * @param accY Valor del eje Y.
  * @param accZ Valor del eje Z.
  * @param pitch Puntero donde se almacenará el ángulo de pitch calculado.
  */
-void calculate_pitch(int16_t accX, int16_t accY, int16_t accZ, float *pitch);
+void calculate_pitch(int32_t accX, int32_t accY, int32_t accZ, float *pitch);
+
+/**
+ * @brief Mide los ciclos por llamada del filtro de Kalman y los PID de un eje.
+ *
+ * Mide la versión compilada (float o Q16.16 según CONTROL_FIXED_POINT) e imprime
+ * los resultados por stdio; solo existe si se compila con CONTROL_BENCHMARK.
+ */
+void control_benchmark();
 
 #endif // CONTROL_PID_H
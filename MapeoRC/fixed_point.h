@@ -0,0 +1,259 @@
+/**
+ * @file fixed_point.h
+ * @brief Aritmética de punto fijo Q16.16 con saturación.
+ *
+ * Un q16_t guarda un valor real multiplicado por 2^16 en un entero de 32 bits con
+ * signo: rango [-32768, 32768) con resolución de 1.5e-5. Todas las operaciones
+ * saturan en lugar de desbordar.
+ *
+ * Las funciones q_*_shift trabajan con otros formatos del mismo entero de 32 bits
+ * (por ejemplo Q2.30 para intervalos de milisegundos, que en Q16.16 pierden hasta un
+ * 0.7 %): el número de bits fraccionarios del resultado lo fija el desplazamiento.
+ *
+ * Las conversiones con float manipulan los bits IEEE 754 con enteros: en el M0+, sin
+ * FPU, no llaman a la biblioteca de float. Ninguna función divide en 64 bits salvo
+ * q16_div() y q_div_shift(), pensadas para la inicialización o para cuando cambia dt.
+ */
+
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+typedef int32_t q16_t; ///< Valor en formato Q16.16
+
+#define Q16_ONE ((q16_t)1 << 16)  ///< 1.0 en Q16.16
+#define Q16_MAX INT32_MAX         ///< Mayor valor representable
+#define Q16_MIN INT32_MIN         ///< Menor valor representable
+
+/**
+ * @brief Limita un resultado intermedio de 64 bits al rango de q16_t.
+ *
+ * @param v Valor a limitar.
+ * @return Valor saturado.
+ */
+static inline q16_t q16_sat(int64_t v) {
+    if (v > Q16_MAX) {
+        return Q16_MAX;
+    }
+    if (v < Q16_MIN) {
+        return Q16_MIN;
+    }
+    return (q16_t)v;
+}
+
+/**
+ * @brief Convierte un float a un formato con el número de bits fraccionarios dado.
+ *
+ * Solo con enteros: la mantisa se desplaza según el exponente. Redondea a la mitad
+ * alejándose de cero; los subnormales valen 0 y los infinitos y NaN saturan.
+ *
+ * @param f Valor real.
+ * @param frac_bits Bits fraccionarios del resultado (hasta 30).
+ * @return Valor en punto fijo, redondeado y saturado.
+ */
+static inline int32_t q_from_float_shift(float f, int frac_bits) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    bool negative = bits >> 31;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xFF);
+    if (exponent == 0) {
+        return 0;
+    }
+
+    // f = mantisa · 2^(exponente - 150); en punto fijo se desplaza además frac_bits
+    uint32_t mantissa = (bits & 0x7FFFFFu) | 0x800000u;
+    int32_t shift = exponent - 150 + frac_bits;
+    uint32_t magnitude;
+    if (shift >= 8) {
+        return negative ? INT32_MIN : INT32_MAX;
+    } else if (shift >= 0) {
+        magnitude = mantissa << shift;
+    } else if (shift > -25) {
+        magnitude = (mantissa + (1u << (-shift - 1))) >> -shift;
+    } else {
+        magnitude = 0;
+    }
+    return negative ? -(int32_t)magnitude : (int32_t)magnitude;
+}
+
+/**
+ * @brief Convierte un valor con el número de bits fraccionarios dado a float.
+ *
+ * Solo con enteros: normaliza la magnitud a 24 bits de mantisa, redondeando al par
+ * como la conversión de C.
+ *
+ * @param q Valor en punto fijo.
+ * @param frac_bits Bits fraccionarios de q.
+ * @return Valor real.
+ */
+static inline float q_to_float_shift(int32_t q, int frac_bits) {
+    if (q == 0) {
+        return 0.0f;
+    }
+    uint32_t sign = q < 0 ? 0x80000000u : 0;
+    uint32_t magnitude = q < 0 ? 0u - (uint32_t)q : (uint32_t)q;
+    int32_t msb = 31 - __builtin_clz(magnitude);
+    uint32_t mantissa;
+    if (msb > 23) {
+        int32_t drop = msb - 23;
+        uint32_t half = 1u << (drop - 1);
+        uint32_t rest = magnitude & ((half << 1) - 1);
+        mantissa = magnitude >> drop;
+        if (rest > half || (rest == half && (mantissa & 1))) {
+            mantissa++;
+        }
+        if (mantissa >> 24) {
+            mantissa >>= 1;
+            msb++;
+        }
+    } else {
+        mantissa = magnitude << (23 - msb);
+    }
+    uint32_t bits = sign | ((uint32_t)(msb - frac_bits + 127) << 23) | (mantissa & 0x7FFFFFu);
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+/**
+ * @brief Convierte un float a Q16.16 con redondeo y saturación.
+ *
+ * @param f Valor real.
+ * @return Valor en Q16.16.
+ */
+static inline q16_t q16_from_float(float f) {
+    return q_from_float_shift(f, 16);
+}
+
+/**
+ * @brief Convierte un valor Q16.16 a float.
+ *
+ * @param q Valor en Q16.16.
+ * @return Valor real.
+ */
+static inline float q16_to_float(q16_t q) {
+    return q_to_float_shift(q, 16);
+}
+
+/**
+ * @brief Suma con saturación.
+ *
+ * @param a Primer operando.
+ * @param b Segundo operando.
+ * @return Resultado en Q16.16.
+ */
+static inline q16_t q16_add(q16_t a, q16_t b) {
+    return q16_sat((int64_t)a + b);
+}
+
+/**
+ * @brief Resta con saturación.
+ *
+ * @param a Primer operando.
+ * @param b Segundo operando.
+ * @return Resultado en Q16.16.
+ */
+static inline q16_t q16_sub(q16_t a, q16_t b) {
+    return q16_sat((int64_t)a - b);
+}
+
+/**
+ * @brief Multiplicación con redondeo y saturación.
+ *
+ * @param a Primer operando.
+ * @param b Segundo operando.
+ * @return Resultado en Q16.16.
+ */
+static inline q16_t q16_mul(q16_t a, q16_t b) {
+    return q16_sat(((int64_t)a * b + (1 << 15)) >> 16);
+}
+
+/**
+ * @brief División con saturación; dividir por cero satura según el signo del dividendo.
+ *
+ * En el RP2040 la división usa el divisor por hardware del SIO a través de pico_divider.
+ *
+ * @param a Dividendo.
+ * @param b Divisor.
+ * @return Cociente en Q16.16.
+ */
+static inline q16_t q16_div(q16_t a, q16_t b) {
+    if (b == 0) {
+        return a >= 0 ? Q16_MAX : Q16_MIN;
+    }
+    return q16_sat((int64_t)a * Q16_ONE / b);
+}
+
+/**
+ * @brief Multiplicación con redondeo y saturación entre formatos distintos.
+ *
+ * El resultado tiene los bits fraccionarios de a más los de b menos shift.
+ *
+ * @param a Primer operando.
+ * @param b Segundo operando.
+ * @param shift Bits que se descartan del producto (al menos 1).
+ * @return Producto en punto fijo.
+ */
+static inline int32_t q_mul_shift(int32_t a, int32_t b, int shift) {
+    return q16_sat(((int64_t)a * b + ((int64_t)1 << (shift - 1))) >> shift);
+}
+
+/**
+ * @brief División con saturación entre formatos distintos; dividir por cero satura según el signo.
+ *
+ * El resultado tiene los bits fraccionarios de a más shift menos los de b.
+ *
+ * @param a Dividendo.
+ * @param b Divisor.
+ * @param shift Bits que se añaden al dividendo.
+ * @return Cociente en punto fijo.
+ */
+static inline int32_t q_div_shift(int32_t a, int32_t b, int shift) {
+    if (b == 0) {
+        return a >= 0 ? Q16_MAX : Q16_MIN;
+    }
+    return q16_sat(((int64_t)a << shift) / b);
+}
+
+/**
+ * @brief Cociente num / den, entre 0 y 1, con los bits fraccionarios dados.
+ *
+ * Solo usa divisiones de 32 bits, que el RP2040 hace con el divisor por hardware:
+ * el divisor se normaliza a 24 bits y el cociente sale en pasos de 8 bits, como
+ * una división larga. El error es de unas pocas unidades en el último bit.
+ *
+ * @param num Dividendo, no mayor que den.
+ * @param den Divisor.
+ * @param frac_bits Bits fraccionarios del resultado (hasta 30).
+ * @return Cociente en punto fijo; 1 si num >= den o den es 0.
+ */
+static inline int32_t q_ratio_shift(uint32_t num, uint32_t den, int frac_bits) {
+    if (num >= den) {
+        return (int32_t)1 << frac_bits;
+    }
+    int shift = __builtin_clz(den) - 8;
+    if (shift >= 0) {
+        num <<= shift;
+        den <<= shift;
+    } else {
+        num = (num + (1u << (-shift - 1))) >> -shift;
+        den >>= -shift;
+    }
+    uint32_t quotient = 0;
+    for (int bits = frac_bits; bits > 0; bits -= 8) {
+        int step = bits < 8 ? bits : 8;
+        num <<= step;
+        uint32_t digit = num / den;
+        num -= digit * den;
+        quotient = (quotient << step) + digit;
+    }
+    if (2 * num >= den) {
+        quotient++;
+    }
+    return (int32_t)quotient;
+}
+
+#endif // FIXED_POINT_H
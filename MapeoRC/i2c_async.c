@@ -0,0 +1,220 @@
+/**
+ * @file i2c_async.c
+ * @brief Motor de transacciones I2C asíncronas con DMA.
+ *
+ * Un canal DMA alimenta el FIFO de transmisión con las órdenes de la transacción
+ * (dirección de registro, lecturas con arranque repetido y parada) y otro vacía el
+ * FIFO de recepción en el buffer del usuario. La CPU solo interviene al iniciar y
+ * en la interrupción de fin (DMA) o de error (TX_ABRT del I2C).
+ *
+ * Las lecturas pedidas con el bus ocupado esperan en una cola y arrancan, en orden
+ * de llegada, desde la interrupción de fin de la anterior; así varios sensores
+ * comparten el bus sin que ninguno tenga que reintentar.
+ */
+
+#include "i2c_async.h"
+#include "dlog.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+static i2c_inst_t *async_i2c;
+static uint async_tx_chan;
+static uint async_rx_chan;
+
+/**
+ * @brief Lectura pedida al motor.
+ */
+typedef struct {
+    uint8_t addr;               ///< Dirección del dispositivo
+    uint8_t reg;                ///< Primer registro
+    uint8_t len;                ///< Bytes a leer
+    uint8_t *buf;               ///< Destino de los datos
+    I2cAsyncCallback callback;  ///< Función de fin
+    void *context;              ///< Puntero para la función de fin
+} I2cAsyncRequest;
+
+/// Órdenes de la transacción en curso: escritura del registro y una lectura por byte
+static uint32_t async_cmds[I2C_ASYNC_MAX_LEN + 1];
+
+static volatile bool async_busy;
+static I2cAsyncCallback async_callback;
+static void *async_context;
+
+/// Lecturas en espera (solo se tocan con las interrupciones deshabilitadas)
+static I2cAsyncRequest async_queue[I2C_ASYNC_QUEUE_SIZE];
+static uint32_t async_queue_head;
+static uint32_t async_queue_tail;
+
+static void i2c_async_start_next();
+
+/**
+ * @brief Cierra la transacción en curso y avisa al usuario.
+ *
+ * @param ok Verdadero si terminó sin error.
+ */
+static void i2c_async_finish(bool ok) {
+    I2cAsyncCallback callback = async_callback;
+    void *context = async_context;
+    async_busy = false;
+    if (callback) {
+        callback(ok, context);
+    }
+
+    // La función de fin pudo haber lanzado ya otra lectura
+    uint32_t status = save_and_disable_interrupts();
+    if (!async_busy) {
+        i2c_async_start_next();
+    }
+    restore_interrupts(status);
+}
+
+/**
+ * @brief Interrupción de DMA: la recepción del último byte cierra la transacción.
+ */
+static void i2c_async_dma_irq() {
+    if (!dma_channel_get_irq1_status(async_rx_chan)) {
+        return;
+    }
+    dma_channel_acknowledge_irq1(async_rx_chan);
+    i2c_async_finish(true);
+}
+
+/**
+ * @brief Interrupción del I2C: un NACK o una pérdida de arbitraje aborta la transacción.
+ */
+static void i2c_async_i2c_irq() {
+    i2c_hw_t *hw = i2c_get_hw(async_i2c);
+    if (!(hw->intr_stat & I2C_IC_INTR_STAT_R_TX_ABRT_BITS)) {
+        return;
+    }
+
+    dma_channel_abort(async_tx_chan);
+    dma_channel_abort(async_rx_chan);
+    dma_channel_acknowledge_irq1(async_rx_chan);
+    DLOG("I2C abortado: dispositivo 0x%02lx, causa 0x%08lx", (unsigned long)hw->tar, (unsigned long)hw->tx_abrt_source);
+
+    // Leer el registro limpia el aborto y libera el FIFO de transmisión
+    (void)hw->clr_tx_abrt;
+    if (async_busy) {
+        i2c_async_finish(false);
+    }
+}
+
+/**
+ * @brief Prepara los canales DMA y las interrupciones del motor sobre un bloque I2C ya inicializado.
+ *
+ * @param i2c Bloque I2C a usar.
+ */
+void i2c_async_init(i2c_inst_t *i2c) {
+    i2c_hw_t *hw = i2c_get_hw(i2c);
+    async_i2c = i2c;
+    async_tx_chan = dma_claim_unused_channel(true);
+    async_rx_chan = dma_claim_unused_channel(true);
+
+    // Peticiones de DMA: transmisión con el FIFO medio vacío, recepción con cada byte
+    hw->dma_tdlr = 8;
+    hw->dma_rdlr = 0;
+    hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+
+    dma_channel_set_irq1_enabled(async_rx_chan, true);
+    irq_add_shared_handler(DMA_IRQ_1, i2c_async_dma_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    hw->intr_mask = I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+    irq_set_exclusive_handler(I2C0_IRQ + i2c_hw_index(i2c), i2c_async_i2c_irq);
+    irq_set_enabled(I2C0_IRQ + i2c_hw_index(i2c), true);
+}
+
+/**
+ * @brief Arranca la lectura más antigua de la cola, si la hay.
+ *
+ * Debe llamarse con las interrupciones deshabilitadas y el motor libre.
+ */
+static void i2c_async_start_next() {
+    if (async_queue_head == async_queue_tail) {
+        return;
+    }
+    I2cAsyncRequest *req = &async_queue[async_queue_tail % I2C_ASYNC_QUEUE_SIZE];
+    async_queue_tail++;
+
+    async_busy = true;
+    async_callback = req->callback;
+    async_context = req->context;
+
+    // La dirección del dispositivo solo se puede cambiar con el bloque deshabilitado
+    i2c_hw_t *hw = i2c_get_hw(async_i2c);
+    if (hw->tar != req->addr) {
+        hw->enable = 0;
+        hw->tar = req->addr;
+        hw->enable = 1;
+    }
+
+    async_cmds[0] = req->reg;
+    for (uint i = 1; i <= req->len; i++) {
+        async_cmds[i] = I2C_IC_DATA_CMD_CMD_BITS;
+    }
+    async_cmds[1] |= I2C_IC_DATA_CMD_RESTART_BITS;
+    async_cmds[req->len] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    dma_channel_config rx = dma_channel_get_default_config(async_rx_chan);
+    channel_config_set_transfer_data_size(&rx, DMA_SIZE_8);
+    channel_config_set_read_increment(&rx, false);
+    channel_config_set_write_increment(&rx, true);
+    channel_config_set_dreq(&rx, i2c_get_dreq(async_i2c, false));
+    dma_channel_configure(async_rx_chan, &rx, req->buf, &hw->data_cmd, req->len, true);
+
+    dma_channel_config tx = dma_channel_get_default_config(async_tx_chan);
+    channel_config_set_transfer_data_size(&tx, DMA_SIZE_32);
+    channel_config_set_read_increment(&tx, true);
+    channel_config_set_write_increment(&tx, false);
+    channel_config_set_dreq(&tx, i2c_get_dreq(async_i2c, true));
+    dma_channel_configure(async_tx_chan, &tx, &hw->data_cmd, async_cmds, req->len + 1, true);
+}
+
+/**
+ * @brief Pide la lectura de registros consecutivos de un dispositivo y retorna enseguida.
+ *
+ * @param addr Dirección I2C de 7 bits del dispositivo.
+ * @param reg Dirección del primer registro a leer.
+ * @param buf Buffer donde se almacenarán los datos.
+ * @param len Número de registros a leer (1 a I2C_ASYNC_MAX_LEN).
+ * @param callback Función a llamar al terminar (puede ser NULL).
+ * @param context Puntero que se pasa a la función de fin.
+ * @return Falso si la cola está llena o los parámetros no son válidos.
+ */
+bool i2c_async_read(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len, I2cAsyncCallback callback, void *context) {
+    if (len == 0 || len > I2C_ASYNC_MAX_LEN) {
+        return false;
+    }
+
+    // Puede llamarse desde tareas e interrupciones: la cola se toca con las interrupciones deshabilitadas
+    uint32_t status = save_and_disable_interrupts();
+    if (async_queue_head - async_queue_tail >= I2C_ASYNC_QUEUE_SIZE) {
+        restore_interrupts(status);
+        return false;
+    }
+    I2cAsyncRequest *req = &async_queue[async_queue_head % I2C_ASYNC_QUEUE_SIZE];
+    req->addr = addr;
+    req->reg = reg;
+    req->len = len;
+    req->buf = buf;
+    req->callback = callback;
+    req->context = context;
+    async_queue_head++;
+
+    if (!async_busy) {
+        i2c_async_start_next();
+    }
+    restore_interrupts(status);
+    return true;
+}
+
+/**
+ * @brief Indica si hay una transacción en curso o en espera.
+ *
+ * @return Verdadero mientras quede alguna lectura sin terminar.
+ */
+bool i2c_async_busy() {
+    return async_busy || async_queue_head != async_queue_tail;
+}
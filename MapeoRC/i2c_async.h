@@ -0,0 +1,55 @@
+/**
+ * @file i2c_async.h
+ * @brief Declaraciones del motor de transacciones I2C asíncronas con DMA.
+ */
+
+#ifndef I2C_ASYNC_H
+#define I2C_ASYNC_H
+
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+
+#define I2C_ASYNC_MAX_LEN 32    ///< Máximo de bytes por lectura
+#define I2C_ASYNC_QUEUE_SIZE 4  ///< Lecturas que pueden esperar a que el bus quede libre
+
+/**
+ * @brief Función llamada al terminar una transacción, desde el contexto de interrupción.
+ *
+ * @param ok Verdadero si la transacción terminó sin error.
+ * @param context Puntero pasado al iniciar la transacción.
+ */
+typedef void (*I2cAsyncCallback)(bool ok, void *context);
+
+/**
+ * @brief Prepara los canales DMA y las interrupciones del motor sobre un bloque I2C ya inicializado.
+ *
+ * Las interrupciones quedan en el núcleo que llama a la función.
+ *
+ * @param i2c Bloque I2C a usar.
+ */
+void i2c_async_init(i2c_inst_t *i2c);
+
+/**
+ * @brief Pide la lectura de registros consecutivos de un dispositivo y retorna enseguida.
+ *
+ * Escribe la dirección del registro, repite el arranque y lee len bytes, todo por DMA.
+ * Si el bus está ocupado, la lectura espera en cola y arranca al terminar las anteriores.
+ *
+ * @param addr Dirección I2C de 7 bits del dispositivo.
+ * @param reg Dirección del primer registro a leer.
+ * @param buf Buffer donde se almacenarán los datos; debe seguir válido hasta la llamada de fin.
+ * @param len Número de registros a leer (1 a I2C_ASYNC_MAX_LEN).
+ * @param callback Función a llamar al terminar (puede ser NULL).
+ * @param context Puntero que se pasa a la función de fin.
+ * @return Falso si la cola está llena o los parámetros no son válidos.
+ */
+bool i2c_async_read(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len, I2cAsyncCallback callback, void *context);
+
+/**
+ * @brief Indica si hay una transacción en curso o en espera.
+ *
+ * @return Verdadero mientras quede alguna lectura sin terminar.
+ */
+bool i2c_async_busy();
+
+#endif // I2C_ASYNC_H
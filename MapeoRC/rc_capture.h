@@ -0,0 +1,73 @@
+/**
+ * @file rc_capture.h
+ * @brief Declaraciones para la captura de las señales PWM del receptor RC.
+ */
+
+#ifndef RC_CAPTURE_H
+#define RC_CAPTURE_H
+
+#include "pico/stdlib.h"
+
+// Pines al que se conecta la señal PWM
+#if RC_CAPTURE_BACKEND_PWM
+// Los slices PWM solo miden en su pin B (impar): los canales de GPIO 0 y 2 se cablean a pines B libres
+#define PWM_Cn1 11  ///< Dirección (slice 5 B)
+#define PWM_Cn2 1   ///< Elevación (slice 0 B)
+#define PWM_Cn4 15  ///< Alas (slice 7 B)
+#define PWM_Cn6 3   ///< Switch control (slice 1 B)
+#else
+#define PWM_Cn1 0   ///< Dirección
+#define PWM_Cn2 1   ///< Elevación
+#define PWM_Cn4 2   ///< Alas
+#define PWM_Cn6 3   ///< Switch control
+#endif
+
+#define RC_CAPTURE_CHANNELS 4 ///< Número de canales capturados
+#define RC_CAPTURE_TIMEOUT_US 100000 ///< Sin tramas durante este tiempo el canal se da por perdido
+
+/**
+ * @brief Inicializa la captura de los canales PWM_Cn1, PWM_Cn2, PWM_Cn4 y PWM_Cn6.
+ *
+ * Cada canal queda midiendo en segundo plano; las lecturas posteriores no bloquean.
+ */
+void rc_capture_init();
+
+/**
+ * @brief Devuelve el ancho del último pulso capturado en el pin especificado.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Ancho del pulso en microsegundos (0 si aún no hay trama).
+ */
+uint32_t rc_capture_pulse_us(uint gpio);
+
+/**
+ * @brief Devuelve el ciclo de trabajo de la última trama capturada en el pin especificado.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Ciclo de trabajo en porcentaje (0 si aún no hay trama).
+ */
+float rc_capture_duty_cycle(uint gpio);
+
+/**
+ * @brief Devuelve el tiempo transcurrido desde la última trama completa en el pin especificado.
+ *
+ * Pasado RC_CAPTURE_TIMEOUT_US sin tramas el canal queda marcado como perdido hasta
+ * la siguiente, de modo que la edad no vuelve a parecer reciente al dar la vuelta el
+ * contador de microsegundos.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Edad de la trama en microsegundos (UINT32_MAX si aún no hay trama o se perdió la señal).
+ */
+uint32_t rc_capture_frame_age_us(uint gpio);
+
+/**
+ * @brief Indica si el último pulso del canal es de una trama reciente.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Verdadero si la última trama tiene menos de RC_CAPTURE_TIMEOUT_US.
+ */
+static inline bool rc_capture_valid(uint gpio) {
+    return rc_capture_frame_age_us(gpio) < RC_CAPTURE_TIMEOUT_US;
+}
+
+#endif // RC_CAPTURE_H
@@ -0,0 +1,230 @@
+/**
+ * @file rc_capture_irq.c
+ * @brief Captura de los canales RC con interrupciones de flanco de GPIO.
+ *
+ * La interrupción solo marca el tiempo de cada flanco en un anillo por canal
+ * (un productor, un consumidor, sin bloqueos). Las lecturas del bucle principal
+ * vacían el anillo y reconstruyen el último pulso completo.
+ */
+
+#include "rc_capture.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+#define RC_EDGE_RING_SIZE 16 ///< Flancos almacenados por canal (potencia de 2)
+
+// Eventos del anillo
+#define RC_EDGE_FALL 0      ///< Flanco de bajada
+#define RC_EDGE_RISE 1      ///< Flanco de subida
+#define RC_EDGE_LOST 2      ///< Dos flancos en una sola interrupción: sus instantes no se conocen
+
+/**
+ * @brief Anillo de flancos de un canal, escrito por la interrupción y leído por el bucle.
+ */
+typedef struct {
+    uint32_t time_us[RC_EDGE_RING_SIZE]; ///< Instante de cada flanco
+    uint8_t kind[RC_EDGE_RING_SIZE];     ///< Tipo de cada evento (RC_EDGE_*)
+    volatile uint32_t head;              ///< Índice de escritura (solo la interrupción)
+    volatile uint32_t tail;              ///< Índice de lectura (solo el consumidor)
+    volatile uint32_t overflows;         ///< Flancos descartados por anillo lleno
+} RcEdgeRing;
+
+/**
+ * @brief Estado del consumidor de un canal.
+ */
+typedef struct {
+    uint32_t rise_us;   ///< Último flanco de subida
+    uint32_t fall_us;   ///< Último flanco de bajada
+    uint32_t high_us;   ///< Último tiempo en alto completo
+    uint32_t low_us;    ///< Último tiempo en bajo completo
+    uint32_t frame_us;  ///< Final del último pulso completo
+    bool have_frame;    ///< Hay un pulso completo reciente
+    bool have_rise;     ///< Se ha visto al menos un flanco de subida
+    bool have_fall;     ///< Se ha visto al menos un flanco de bajada
+} RcPulseState;
+
+static const uint rc_pins[RC_CAPTURE_CHANNELS] = {PWM_Cn1, PWM_Cn2, PWM_Cn4, PWM_Cn6};
+static RcEdgeRing rc_rings[RC_CAPTURE_CHANNELS];
+static RcPulseState rc_pulses[RC_CAPTURE_CHANNELS];
+
+/**
+ * @brief Busca el índice de canal asociado a un pin.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Índice del canal o -1 si el pin no se captura.
+ */
+static int rc_channel_index(uint gpio) {
+    for (int i = 0; i < RC_CAPTURE_CHANNELS; i++) {
+        if (rc_pins[i] == gpio) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Guarda un evento en el anillo del canal (lado productor).
+ *
+ * @param ring Anillo del canal.
+ * @param time_us Instante del flanco.
+ * @param kind Tipo de evento (RC_EDGE_*).
+ */
+static inline void rc_ring_push(RcEdgeRing *ring, uint32_t time_us, uint8_t kind) {
+    uint32_t head = ring->head;
+    if (head - ring->tail >= RC_EDGE_RING_SIZE) {
+        ring->overflows++;
+        return;
+    }
+    ring->time_us[head & (RC_EDGE_RING_SIZE - 1)] = time_us;
+    ring->kind[head & (RC_EDGE_RING_SIZE - 1)] = kind;
+    __dmb();
+    ring->head = head + 1;
+}
+
+/**
+ * @brief Interrupción de flanco de los pines RC: marca el tiempo y lo encola.
+ */
+static void rc_capture_gpio_irq() {
+    for (int i = 0; i < RC_CAPTURE_CHANNELS; i++) {
+        uint32_t events = gpio_get_irq_event_mask(rc_pins[i]);
+        if (!events) {
+            continue;
+        }
+        uint32_t now = time_us_32();
+        gpio_acknowledge_irq(rc_pins[i], events);
+
+        // Con ambos flancos pendientes no se sabe cuándo ocurrió cada uno: la trama se
+        // descarta y el canal espera al siguiente flanco limpio
+        if ((events & GPIO_IRQ_EDGE_RISE) && (events & GPIO_IRQ_EDGE_FALL)) {
+            rc_ring_push(&rc_rings[i], now, RC_EDGE_LOST);
+        } else {
+            rc_ring_push(&rc_rings[i], now, (events & GPIO_IRQ_EDGE_RISE) ? RC_EDGE_RISE : RC_EDGE_FALL);
+        }
+    }
+}
+
+/**
+ * @brief Vacía el anillo de un canal y actualiza su último pulso completo (lado consumidor).
+ *
+ * @param i Índice del canal.
+ */
+static void rc_drain(int i) {
+    RcEdgeRing *ring = &rc_rings[i];
+    RcPulseState *pulse = &rc_pulses[i];
+    uint32_t tail = ring->tail;
+    uint32_t head = ring->head;
+    __dmb();
+
+    while (tail != head) {
+        uint32_t t = ring->time_us[tail & (RC_EDGE_RING_SIZE - 1)];
+        uint8_t kind = ring->kind[tail & (RC_EDGE_RING_SIZE - 1)];
+        tail++;
+
+        if (kind == RC_EDGE_LOST) {
+            // Sin referencia: el canal no es válido hasta un pulso medido con dos flancos limpios
+            pulse->have_rise = false;
+            pulse->have_fall = false;
+            pulse->have_frame = false;
+        } else if (kind == RC_EDGE_RISE) {
+            if (pulse->have_fall) {
+                pulse->low_us = t - pulse->fall_us;
+            }
+            pulse->rise_us = t;
+            pulse->have_rise = true;
+        } else {
+            if (pulse->have_rise) {
+                pulse->high_us = t - pulse->rise_us;
+                pulse->frame_us = t;
+                pulse->have_frame = true;
+            }
+            pulse->fall_us = t;
+            pulse->have_fall = true;
+        }
+    }
+
+    __dmb();
+    ring->tail = tail;
+}
+
+/**
+ * @brief Configura las interrupciones de flanco de los canales RC.
+ */
+void rc_capture_init() {
+    uint32_t mask = 0;
+    for (int i = 0; i < RC_CAPTURE_CHANNELS; i++) {
+        gpio_init(rc_pins[i]);
+        gpio_set_dir(rc_pins[i], GPIO_IN);
+        mask |= 1u << rc_pins[i];
+    }
+
+    // Manejador propio para estos pines, compatible con otras interrupciones de GPIO
+    gpio_add_raw_irq_handler_masked(mask, rc_capture_gpio_irq);
+    for (int i = 0; i < RC_CAPTURE_CHANNELS; i++) {
+        gpio_set_irq_enabled(rc_pins[i], GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+    }
+    irq_set_enabled(IO_IRQ_BANK0, true);
+}
+
+/**
+ * @brief Devuelve el tiempo transcurrido desde la última trama completa en el pin especificado.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Edad de la trama en microsegundos (UINT32_MAX si aún no hay trama o se perdió la señal).
+ */
+uint32_t rc_capture_frame_age_us(uint gpio) {
+    int i = rc_channel_index(gpio);
+    if (i < 0) {
+        return UINT32_MAX;
+    }
+    rc_drain(i);
+
+    RcPulseState *pulse = &rc_pulses[i];
+    if (!pulse->have_frame) {
+        return UINT32_MAX;
+    }
+
+    uint32_t age = time_us_32() - pulse->frame_us;
+    if (age >= RC_CAPTURE_TIMEOUT_US) {
+        pulse->have_frame = false;
+        return UINT32_MAX;
+    }
+    return age;
+}
+
+/**
+ * @brief Devuelve el ancho del último pulso capturado en el pin especificado.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Ancho del pulso en microsegundos (0 si aún no hay trama).
+ */
+uint32_t rc_capture_pulse_us(uint gpio) {
+    int i = rc_channel_index(gpio);
+    if (i < 0) {
+        return 0;
+    }
+    rc_drain(i);
+    return rc_pulses[i].high_us;
+}
+
+/**
+ * @brief Devuelve el ciclo de trabajo de la última trama capturada en el pin especificado.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Ciclo de trabajo en porcentaje (0 si aún no hay trama).
+ */
+float rc_capture_duty_cycle(uint gpio) {
+    int i = rc_channel_index(gpio);
+    if (i < 0) {
+        return 0.0f;
+    }
+    rc_drain(i);
+
+    uint32_t high_time = rc_pulses[i].high_us;
+    uint32_t low_time = rc_pulses[i].low_us;
+    if (high_time + low_time == 0) {
+        return 0.0f;
+    }
+
+    return (float)high_time / (high_time + low_time) * 100.0f;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file rc_capture_pio.c
+ * @brief Captura de los canales RC con máquinas de estado PIO y DMA.
+ *
+ * Cada canal usa una máquina de estado de pio0 que mide los flancos de la señal
+ * y un canal DMA que copia cada trama del FIFO a memoria, de modo que el último
+ * valor de todos los canales está siempre disponible sin intervención de la CPU.
+ * La llegada de tramas se detecta en las lecturas por el avance del contador de
+ * transferencias del DMA, así que la edad de cada trama tiene la resolución del
+ * periodo con que se consulta.
+ */
+
+#include "rc_capture.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "rc_capture.pio.h"
+
+static const uint rc_pins[RC_CAPTURE_CHANNELS] = {PWM_Cn1, PWM_Cn2, PWM_Cn4, PWM_Cn6};
+
+/// Última trama de cada canal: tiempo en bajo (16 bits altos) y en alto (16 bits bajos) en us
+static volatile uint32_t rc_frames[RC_CAPTURE_CHANNELS];
+
+static uint rc_dma_chans[RC_CAPTURE_CHANNELS];      ///< Canal DMA de cada canal RC
+static uint32_t rc_last_count[RC_CAPTURE_CHANNELS]; ///< Contador de transferencias en la última consulta
+static uint32_t rc_frame_us[RC_CAPTURE_CHANNELS];   ///< Instante en que se vio la última trama
+static bool rc_have_frame[RC_CAPTURE_CHANNELS];     ///< Hay una trama reciente
+
+/**
+ * @brief Busca el índice de canal asociado a un pin.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Índice del canal o -1 si el pin no se captura.
+ */
+static int rc_channel_index(uint gpio) {
+    for (int i = 0; i < RC_CAPTURE_CHANNELS; i++) {
+        if (rc_pins[i] == gpio) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Inicializa las máquinas de estado y los canales DMA de captura.
+ */
+void rc_capture_init() {
+    PIO pio = pio0;
+    uint offset = pio_add_program(pio, &rc_capture_program);
+
+    for (int i = 0; i < RC_CAPTURE_CHANNELS; i++) {
+        uint sm = pio_claim_unused_sm(pio, true);
+        uint chan = dma_claim_unused_channel(true);
+        rc_dma_chans[i] = chan;
+        rc_last_count[i] = 0xFFFFFFFF;
+
+        // El DMA vacía el FIFO en una sola palabra: siempre queda la trama más reciente
+        dma_channel_config c = dma_channel_get_default_config(chan);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        channel_config_set_read_increment(&c, false);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_dreq(&c, pio_get_dreq(pio, sm, false));
+        dma_channel_configure(chan, &c, &rc_frames[i], &pio->rxf[sm], 0xFFFFFFFF, true);
+
+        rc_capture_program_init(pio, sm, offset, rc_pins[i]);
+    }
+}
+
+/**
+ * @brief Devuelve el tiempo transcurrido desde la última trama completa en el pin especificado.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Edad de la trama en microsegundos (UINT32_MAX si aún no hay trama o se perdió la señal).
+ */
+uint32_t rc_capture_frame_age_us(uint gpio) {
+    int i = rc_channel_index(gpio);
+    if (i < 0) {
+        return UINT32_MAX;
+    }
+
+    // Cada trama copiada por el DMA descuenta una transferencia
+    uint32_t now = time_us_32();
+    uint32_t count = dma_channel_hw_addr(rc_dma_chans[i])->transfer_count;
+    if (count != rc_last_count[i]) {
+        rc_last_count[i] = count;
+        rc_frame_us[i] = now;
+        rc_have_frame[i] = true;
+    }
+    if (!rc_have_frame[i]) {
+        return UINT32_MAX;
+    }
+
+    uint32_t age = now - rc_frame_us[i];
+    if (age >= RC_CAPTURE_TIMEOUT_US) {
+        rc_have_frame[i] = false;
+        return UINT32_MAX;
+    }
+    return age;
+}
+
+/**
+ * @brief Devuelve el ancho del último pulso capturado en el pin especificado.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Ancho del pulso en microsegundos (0 si aún no hay trama).
+ */
+uint32_t rc_capture_pulse_us(uint gpio) {
+    int i = rc_channel_index(gpio);
+    if (i < 0) {
+        return 0;
+    }
+    return rc_frames[i] & 0xFFFF;
+}
+
+/**
+ * @brief Devuelve el ciclo de trabajo de la última trama capturada en el pin especificado.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Ciclo de trabajo en porcentaje (0 si aún no hay trama).
+ */
+float rc_capture_duty_cycle(uint gpio) {
+    int i = rc_channel_index(gpio);
+    if (i < 0) {
+        return 0.0f;
+    }
+
+    uint32_t frame = rc_frames[i];
+    uint32_t high_time = frame & 0xFFFF;
+    uint32_t low_time = frame >> 16;
+    if (high_time + low_time == 0) {
+        return 0.0f;
+    }
+
+    return (float)high_time / (high_time + low_time) * 100.0f;
+}
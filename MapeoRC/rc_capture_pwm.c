@@ -0,0 +1,195 @@
+/**
+ * @file rc_capture_pwm.c
+ * @brief Captura de los canales RC con los contadores de los slices PWM.
+ *
+ * Cada canal usa un slice PWM en modo de entrada "B en alto": el contador solo
+ * avanza mientras la señal del pin B está en alto, a 1 MHz. Un temporizador lee
+ * los contadores cada RC_PWM_SAMPLE_US, mucho menos que el tiempo en bajo de una
+ * trama: mientras el contador avanza el pulso sigue abierto y la primera lectura
+ * sin avance lo cierra. Así cada valor es el tiempo en alto de un pulso entero,
+ * sea cual sea el periodo de la trama del receptor, sin atender flancos con la CPU.
+ */
+
+#include "rc_capture.h"
+#include "hardware/pwm.h"
+#include "hardware/clocks.h"
+
+#define RC_PWM_SAMPLE_US 2000       ///< Periodo de lectura de los contadores (menor que el tiempo en bajo)
+#define RC_PWM_PERIOD_SHIFT 3       ///< El periodo de la trama se promedia sobre unas 2^3 tramas
+
+static const uint rc_pins[RC_CAPTURE_CHANNELS] = {PWM_Cn1, PWM_Cn2, PWM_Cn4, PWM_Cn6};
+
+/// Última trama de cada canal: periodo medio en us (16 bits altos) y tiempo en alto en us (16 bits bajos)
+static volatile uint32_t rc_frames[RC_CAPTURE_CHANNELS];
+
+/// Instante en que se cerró el último pulso de cada canal
+static volatile uint32_t rc_frame_us[RC_CAPTURE_CHANNELS];
+static volatile bool rc_have_frame[RC_CAPTURE_CHANNELS];
+
+/**
+ * @brief Pulso en curso de un canal, solo usado por el temporizador.
+ */
+typedef struct {
+    uint16_t last_count;    ///< Contador en la lectura anterior
+    uint32_t high_us;       ///< Tiempo en alto acumulado del pulso abierto
+    bool in_pulse;          ///< El contador avanzó desde la última lectura sin avance
+    uint32_t end_us;        ///< Cierre del pulso anterior
+    bool have_end;          ///< Se ha cerrado al menos un pulso
+    uint32_t period_avg;    ///< Periodo medio de la trama en us << RC_PWM_PERIOD_SHIFT
+} RcPwmState;
+
+static RcPwmState rc_state[RC_CAPTURE_CHANNELS];
+static repeating_timer_t rc_timer;
+
+/**
+ * @brief Busca el índice de canal asociado a un pin.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Índice del canal o -1 si el pin no se captura.
+ */
+static int rc_channel_index(uint gpio) {
+    for (int i = 0; i < RC_CAPTURE_CHANNELS; i++) {
+        if (rc_pins[i] == gpio) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Lee los contadores de todos los slices y publica cada pulso al cerrarse.
+ *
+ * El cierre se detecta con un retraso de hasta RC_PWM_SAMPLE_US; el ancho del pulso
+ * es exacto porque se suma todo lo que avanzó el contador. El periodo entre cierres
+ * tiene ese mismo error, que no se acumula y se reparte al promediarlo.
+ *
+ * @param timer Temporizador que invoca la función.
+ * @return Siempre verdadero para seguir repitiendo.
+ */
+static bool rc_sample_counters(repeating_timer_t *timer) {
+    uint32_t now = time_us_32();
+
+    for (int i = 0; i < RC_CAPTURE_CHANNELS; i++) {
+        RcPwmState *st = &rc_state[i];
+        uint16_t count = pwm_get_counter(pwm_gpio_to_slice_num(rc_pins[i]));
+        uint16_t high = count - st->last_count;
+        st->last_count = count;
+
+        if (high) {
+            st->high_us += high;
+            st->in_pulse = true;
+            continue;
+        }
+        if (!st->in_pulse) {
+            continue;
+        }
+
+        // Primera lectura sin avance: el pulso se cerró dentro del último periodo de lectura.
+        // El primer pulso solo sincroniza: pudo empezar antes de arrancar los contadores.
+        // Tras perder la señal se vuelve a sincronizar y el periodo medio empieza de nuevo
+        if (st->have_end && now - st->end_us >= RC_CAPTURE_TIMEOUT_US) {
+            st->have_end = false;
+            st->period_avg = 0;
+        }
+        if (st->have_end) {
+            uint32_t period = MIN(now - st->end_us, 0xFFFF);
+            if (st->period_avg == 0) {
+                st->period_avg = period << RC_PWM_PERIOD_SHIFT;
+            } else {
+                st->period_avg += period - (st->period_avg >> RC_PWM_PERIOD_SHIFT);
+            }
+            rc_frames[i] = ((st->period_avg >> RC_PWM_PERIOD_SHIFT) << 16) | MIN(st->high_us, 0xFFFF);
+            rc_frame_us[i] = now;
+            rc_have_frame[i] = true;
+        }
+
+        st->end_us = now;
+        st->have_end = true;
+        st->high_us = 0;
+        st->in_pulse = false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Configura los slices PWM de entrada y el muestreo periódico de sus contadores.
+ */
+void rc_capture_init() {
+    pwm_config config = pwm_get_default_config();
+    pwm_config_set_clkdiv_mode(&config, PWM_DIV_B_HIGH);
+    pwm_config_set_clkdiv(&config, (float)clock_get_hz(clk_sys) / 1000000.0f);
+
+    uint32_t slice_mask = 0;
+    for (int i = 0; i < RC_CAPTURE_CHANNELS; i++) {
+        // Solo el pin B de cada slice puede usarse como entrada
+        assert(pwm_gpio_to_channel(rc_pins[i]) == PWM_CHAN_B);
+
+        uint slice_num = pwm_gpio_to_slice_num(rc_pins[i]);
+        pwm_init(slice_num, &config, false);
+        gpio_set_function(rc_pins[i], GPIO_FUNC_PWM);
+        slice_mask |= 1u << slice_num;
+    }
+
+    // Arranca todos los contadores a la vez
+    pwm_set_mask_enabled(pwm_hw->en | slice_mask);
+
+    add_repeating_timer_us(-RC_PWM_SAMPLE_US, rc_sample_counters, NULL, &rc_timer);
+}
+
+/**
+ * @brief Devuelve el tiempo transcurrido desde la última trama completa en el pin especificado.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Edad de la trama en microsegundos (UINT32_MAX si aún no hay trama o se perdió la señal).
+ */
+uint32_t rc_capture_frame_age_us(uint gpio) {
+    int i = rc_channel_index(gpio);
+    if (i < 0 || !rc_have_frame[i]) {
+        return UINT32_MAX;
+    }
+
+    uint32_t age = time_us_32() - rc_frame_us[i];
+    if (age >= RC_CAPTURE_TIMEOUT_US) {
+        rc_have_frame[i] = false;
+        return UINT32_MAX;
+    }
+    return age;
+}
+
+/**
+ * @brief Devuelve el ancho del último pulso capturado en el pin especificado.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Ancho del pulso en microsegundos (0 si aún no hay trama).
+ */
+uint32_t rc_capture_pulse_us(uint gpio) {
+    int i = rc_channel_index(gpio);
+    if (i < 0) {
+        return 0;
+    }
+    return rc_frames[i] & 0xFFFF;
+}
+
+/**
+ * @brief Devuelve el ciclo de trabajo de la última trama capturada en el pin especificado.
+ *
+ * El tiempo en alto del último pulso se divide por el periodo medio de la trama.
+ *
+ * @param gpio Pin GPIO del canal.
+ * @return Ciclo de trabajo en porcentaje (0 si aún no hay trama).
+ */
+float rc_capture_duty_cycle(uint gpio) {
+    int i = rc_channel_index(gpio);
+    if (i < 0) {
+        return 0.0f;
+    }
+
+    uint32_t frame = rc_frames[i];
+    uint32_t period = frame >> 16;
+    if (period == 0) {
+        return 0.0f;
+    }
+
+    return (float)(frame & 0xFFFF) / period * 100.0f;
+}
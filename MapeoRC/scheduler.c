@@ -0,0 +1,186 @@
+/**
+ * @file scheduler.c
+ * @brief Planificador de tareas por grupos de frecuencia con tic de alarma de hardware.
+ *
+ * La interrupción del tic solo libera las tareas cuyo periodo se cumple; las tareas
+ * corren fuera de la interrupción, por orden de prioridad, y miden su propio dt.
+ * Con scheduler_start_irq() corren dentro de la propia interrupción y el hilo del
+ * núcleo queda libre para trabajo que bloquea.
+ */
+
+#include "scheduler.h"
+#include "hardware/sync.h"
+
+/**
+ * @brief Inicializa un planificador vacío.
+ *
+ * @param scheduler Puntero al planificador.
+ */
+void scheduler_init(Scheduler *scheduler) {
+    scheduler->num_tasks = 0;
+    scheduler->tick = 0;
+}
+
+/**
+ * @brief Registra una tarea periódica.
+ *
+ * @param scheduler Puntero al planificador.
+ * @param name Nombre de la tarea.
+ * @param rate_hz Frecuencia de la tarea; debe dividir la frecuencia del tic base.
+ * @param run Función de la tarea.
+ * @return Puntero a la tarea registrada o NULL si no hay espacio o la frecuencia no
+ *         es un divisor del tic base (SCHEDULER_RATE_VALID).
+ */
+SchedulerTask *scheduler_add_task(Scheduler *scheduler, const char *name, uint32_t rate_hz, SchedulerTaskFn run) {
+    // Una frecuencia que no divide el tic se truncaría sin avisar a la de otro divisor
+    if (scheduler->num_tasks >= SCHEDULER_MAX_TASKS || !SCHEDULER_RATE_VALID(rate_hz)) {
+        return NULL;
+    }
+
+    SchedulerTask *task = &scheduler->tasks[scheduler->num_tasks++];
+    task->name = name;
+    task->run = run;
+    task->period_ticks = SCHEDULER_PERIOD_TICKS(rate_hz);
+    task->released = false;
+    task->running = false;
+    task->last_start_us = 0;
+    task->dt = (float)(task->period_ticks * SCHEDULER_TICK_US) / 1000000.0f;
+    task->runs = 0;
+    task->deadline_misses = 0;
+    task->max_exec_us = 0;
+    task->max_jitter_us = 0;
+    return task;
+}
+
+/**
+ * @brief Tic base: libera las tareas cuyo periodo se cumple y cuenta los plazos perdidos.
+ *
+ * @param timer Temporizador que invoca la función.
+ * @return Siempre verdadero para seguir repitiendo.
+ */
+static bool scheduler_tick(repeating_timer_t *timer) {
+    Scheduler *scheduler = (Scheduler *)timer->user_data;
+    uint32_t tick = ++scheduler->tick;
+
+    for (uint i = 0; i < scheduler->num_tasks; i++) {
+        SchedulerTask *task = &scheduler->tasks[i];
+        if (tick % task->period_ticks != 0) {
+            continue;
+        }
+        if (task->released || task->running) {
+            task->deadline_misses++;
+        }
+        task->released = true;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Ejecuta una tarea liberada y actualiza su dt y sus estadísticas.
+ *
+ * @param task Tarea a ejecutar.
+ */
+static void scheduler_execute(SchedulerTask *task) {
+    uint32_t start = time_us_32();
+    if (task->runs > 0) {
+        uint32_t interval_us = start - task->last_start_us;
+        uint32_t period_us = task->period_ticks * SCHEDULER_TICK_US;
+        uint32_t jitter_us = interval_us > period_us ? interval_us - period_us : period_us - interval_us;
+        if (jitter_us > task->max_jitter_us) {
+            task->max_jitter_us = jitter_us;
+        }
+        task->dt = interval_us / 1000000.0f;
+    }
+    task->last_start_us = start;
+
+    task->run(task->dt);
+
+    uint32_t exec_us = time_us_32() - start;
+    if (exec_us > task->max_exec_us) {
+        task->max_exec_us = exec_us;
+    }
+    task->runs++;
+    task->running = false;
+}
+
+/**
+ * @brief Tic base que además ejecuta en la interrupción las tareas que libera.
+ *
+ * @param timer Temporizador que invoca la función.
+ * @return Siempre verdadero para seguir repitiendo.
+ */
+static bool scheduler_tick_irq(repeating_timer_t *timer) {
+    Scheduler *scheduler = (Scheduler *)timer->user_data;
+    scheduler_tick(timer);
+
+    for (uint i = 0; i < scheduler->num_tasks; i++) {
+        SchedulerTask *task = &scheduler->tasks[i];
+        if (task->released) {
+            task->released = false;
+            task->running = true;
+            scheduler_execute(task);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Arranca el tic base con una alarma de hardware.
+ *
+ * @param scheduler Puntero al planificador.
+ * @param pool Grupo de alarmas a usar (NULL para el del núcleo 0).
+ */
+void scheduler_start(Scheduler *scheduler, alarm_pool_t *pool) {
+    if (!pool) {
+        pool = alarm_pool_get_default();
+    }
+    // Periodo negativo: cada tic se programa desde el inicio del anterior, sin deriva
+    alarm_pool_add_repeating_timer_us(pool, -SCHEDULER_TICK_US, scheduler_tick, scheduler, &scheduler->timer);
+}
+
+/**
+ * @brief Arranca el tic base y ejecuta las tareas dentro de su interrupción.
+ *
+ * @param scheduler Puntero al planificador.
+ * @param pool Grupo de alarmas a usar (NULL para el del núcleo 0).
+ */
+void scheduler_start_irq(Scheduler *scheduler, alarm_pool_t *pool) {
+    if (!pool) {
+        pool = alarm_pool_get_default();
+    }
+    alarm_pool_add_repeating_timer_us(pool, -SCHEDULER_TICK_US, scheduler_tick_irq, scheduler, &scheduler->timer);
+}
+
+/**
+ * @brief Ejecuta las tareas liberadas por orden de prioridad; no retorna.
+ *
+ * @param scheduler Puntero al planificador.
+ */
+void scheduler_run(Scheduler *scheduler) {
+    while (1) {
+        // Con las interrupciones enmascaradas un tic no se pierde entre la búsqueda y el __wfi()
+        uint32_t status = save_and_disable_interrupts();
+        SchedulerTask *task = NULL;
+        for (uint i = 0; i < scheduler->num_tasks; i++) {
+            if (scheduler->tasks[i].released) {
+                task = &scheduler->tasks[i];
+                break;
+            }
+        }
+
+        if (!task) {
+            // Nada pendiente: duerme hasta la siguiente interrupción
+            __wfi();
+            restore_interrupts(status);
+            continue;
+        }
+
+        task->running = true;
+        task->released = false;
+        restore_interrupts(status);
+
+        scheduler_execute(task);
+    }
+}
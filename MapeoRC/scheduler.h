@@ -0,0 +1,106 @@
+/**
+ * @file scheduler.h
+ * @brief Declaraciones del planificador de tareas por grupos de frecuencia.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "pico/stdlib.h"
+
+#define SCHEDULER_MAX_TASKS 8       ///< Número máximo de tareas por planificador
+#define SCHEDULER_TICK_US 1000      ///< Periodo del tic base (1 kHz)
+
+/// La tarea corre exactamente a rate_hz: su periodo es un número entero de tics base
+#define SCHEDULER_RATE_VALID(rate_hz) \
+    ((rate_hz) > 0 && (rate_hz) * SCHEDULER_TICK_US <= 1000000 && 1000000 % ((rate_hz) * SCHEDULER_TICK_US) == 0)
+
+/// Periodo en tics base de una tarea a rate_hz (exacto si SCHEDULER_RATE_VALID)
+#define SCHEDULER_PERIOD_TICKS(rate_hz) (1000000 / ((rate_hz) * SCHEDULER_TICK_US))
+
+/// Frecuencia de una tarea que corre cada period_ticks tics base
+#define SCHEDULER_RATE_FROM_TICKS(period_ticks) (1000000 / ((period_ticks) * SCHEDULER_TICK_US))
+
+/**
+ * @brief Función de una tarea periódica.
+ *
+ * @param dt Tiempo medido desde el inicio de la ejecución anterior, en segundos.
+ */
+typedef void (*SchedulerTaskFn)(float dt);
+
+/**
+ * @brief Estado y estadísticas de una tarea periódica.
+ */
+typedef struct {
+    const char *name;               ///< Nombre de la tarea
+    SchedulerTaskFn run;            ///< Función de la tarea
+    uint32_t period_ticks;          ///< Periodo en tics base
+    volatile bool released;         ///< Liberada por el tic y pendiente de ejecutar
+    volatile bool running;          ///< En ejecución
+    uint32_t last_start_us;         ///< Inicio de la ejecución anterior
+    float dt;                       ///< Último intervalo medido entre ejecuciones, en segundos
+    uint32_t runs;                  ///< Ejecuciones completadas
+    volatile uint32_t deadline_misses; ///< Liberaciones que encontraron la anterior sin terminar
+    uint32_t max_exec_us;           ///< Mayor tiempo de ejecución observado
+    uint32_t max_jitter_us;         ///< Mayor desviación del intervalo entre inicios respecto al periodo
+} SchedulerTask;
+
+/**
+ * @brief Planificador de tareas periódicas de un núcleo.
+ *
+ * Las tareas se atienden por orden de registro, de modo que deben añadirse de mayor a
+ * menor frecuencia.
+ */
+typedef struct {
+    SchedulerTask tasks[SCHEDULER_MAX_TASKS]; ///< Tareas registradas
+    uint num_tasks;                 ///< Número de tareas registradas
+    volatile uint32_t tick;         ///< Tics base transcurridos
+    repeating_timer_t timer;        ///< Temporizador que genera el tic base
+} Scheduler;
+
+/**
+ * @brief Inicializa un planificador vacío.
+ *
+ * @param scheduler Puntero al planificador.
+ */
+void scheduler_init(Scheduler *scheduler);
+
+/**
+ * @brief Registra una tarea periódica.
+ *
+ * @param scheduler Puntero al planificador.
+ * @param name Nombre de la tarea.
+ * @param rate_hz Frecuencia de la tarea; debe dividir la frecuencia del tic base.
+ * @param run Función de la tarea.
+ * @return Puntero a la tarea registrada o NULL si no hay espacio o la frecuencia no
+ *         es un divisor del tic base (SCHEDULER_RATE_VALID).
+ */
+SchedulerTask *scheduler_add_task(Scheduler *scheduler, const char *name, uint32_t rate_hz, SchedulerTaskFn run);
+
+/**
+ * @brief Arranca el tic base con una alarma de hardware.
+ *
+ * @param scheduler Puntero al planificador.
+ * @param pool Grupo de alarmas a usar (NULL para el del núcleo 0). La interrupción corre en el núcleo del grupo.
+ */
+void scheduler_start(Scheduler *scheduler, alarm_pool_t *pool);
+
+/**
+ * @brief Arranca el tic base y ejecuta las tareas dentro de su interrupción.
+ *
+ * Las tareas deben ser breves y no bloquear; a cambio, el hilo del núcleo puede quedarse
+ * esperando (por ejemplo a la flash) sin retrasarlas. No se usa con scheduler_run().
+ *
+ * @param scheduler Puntero al planificador.
+ * @param pool Grupo de alarmas a usar (NULL para el del núcleo 0). La interrupción corre en el núcleo del grupo.
+ */
+void scheduler_start_irq(Scheduler *scheduler, alarm_pool_t *pool);
+
+/**
+ * @brief Ejecuta las tareas liberadas; no retorna.
+ *
+ * @param scheduler Puntero al planificador.
+ */
+void scheduler_run(Scheduler *scheduler);
+
+#endif // SCHEDULER_H
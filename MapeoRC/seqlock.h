@@ -0,0 +1,71 @@
+/**
+ * @file seqlock.h
+ * @brief Cerrojo de secuencia para compartir instantáneas entre núcleos sin bloquear.
+ *
+ * Un único escritor incrementa el contador antes y después de modificar los datos;
+ * los lectores copian los datos y repiten si el contador era impar o cambió durante
+ * la copia. El escritor nunca espera y los lectores solo reintentan si coinciden con
+ * una escritura.
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+/**
+ * @brief Contador de secuencia de una instantánea compartida.
+ */
+typedef struct {
+    volatile uint32_t seq; ///< Impar mientras hay una escritura en curso
+} SeqLock;
+
+/**
+ * @brief Marca el inicio de una escritura (solo el escritor).
+ *
+ * @param lock Puntero al cerrojo.
+ */
+static inline void seqlock_write_begin(SeqLock *lock) {
+    lock->seq = lock->seq + 1;
+    __dmb();
+}
+
+/**
+ * @brief Marca el fin de una escritura (solo el escritor).
+ *
+ * @param lock Puntero al cerrojo.
+ */
+static inline void seqlock_write_end(SeqLock *lock) {
+    __dmb();
+    lock->seq = lock->seq + 1;
+}
+
+/**
+ * @brief Inicia una lectura; espera a que no haya una escritura en curso.
+ *
+ * @param lock Puntero al cerrojo.
+ * @return Secuencia a pasar a seqlock_read_retry().
+ */
+static inline uint32_t seqlock_read_begin(const SeqLock *lock) {
+    uint32_t seq;
+    while ((seq = lock->seq) & 1) {
+        tight_loop_contents();
+    }
+    __dmb();
+    return seq;
+}
+
+/**
+ * @brief Indica si la copia leída es inconsistente y debe repetirse.
+ *
+ * @param lock Puntero al cerrojo.
+ * @param seq Secuencia devuelta por seqlock_read_begin().
+ * @return Verdadero si hubo una escritura durante la lectura.
+ */
+static inline bool seqlock_read_retry(const SeqLock *lock, uint32_t seq) {
+    __dmb();
+    return lock->seq != seq;
+}
+
+#endif // SEQLOCK_H
@@ -0,0 +1,138 @@
+/**
+ * @file servo_out.c
+ * @brief Salidas PWM de los servomotores con slices configurados una sola vez.
+ *
+ * Los slices corren a 1 MHz con tope SERVO_PERIOD_US - 1, de modo que el nivel de
+ * comparación es directamente el ancho del pulso en microsegundos.
+ *
+ * Las salidas usan doble búfer: el bucle de control compone una trama con los
+ * registros CC de todos los slices y la publica; la interrupción de fin de periodo
+ * (wrap) la copia a los slices, que la aplican todos juntos en el siguiente periodo.
+ */
+
+#include "servo_out.h"
+#include "hardware/pwm.h"
+#include "hardware/irq.h"
+#include "hardware/clocks.h"
+
+/**
+ * @brief Salida de servo y sus límites de pulso.
+ */
+typedef struct {
+    uint gpio;        ///< Pin GPIO de la salida
+    uint16_t min_us;  ///< Pulso mínimo permitido
+    uint16_t max_us;  ///< Pulso máximo permitido
+} ServoOutput;
+
+static const ServoOutput servo_outputs[SERVO_OUTPUTS] = {
+    {PWM_OUT1, SERVO_MIN_US, SERVO_MAX_US},
+    {PWM_OUT2, SERVO_MIN_US, SERVO_MAX_US},
+    {PWM_OUT3, SERVO_MIN_US, SERVO_MAX_US},
+    {PWM_OUT4, 1400, 2100},  // 7.0 % - 10.5 %
+    {PWM_OUT5, 1200, 1900},  // 6.0 % - 9.5 %
+};
+
+/// Tramas de registros CC de cada slice (canal B en los 16 bits altos, A en los bajos)
+static uint32_t servo_frames[2][NUM_PWM_SLICES];
+static volatile uint8_t servo_front;    ///< Trama publicada
+static uint8_t servo_back = 1;          ///< Trama en composición
+static volatile bool servo_pending;     ///< Hay una trama publicada sin aplicar
+static uint32_t servo_slice_mask;       ///< Slices usados por las salidas
+static uint servo_sync_slice;           ///< Slice cuyo fin de periodo dispara la copia
+
+/**
+ * @brief Interrupción de fin de periodo: copia la trama publicada a todos los slices.
+ *
+ * Los registros CC quedan en el búfer del hardware y todos los slices los aplican en el
+ * mismo fin de periodo, así que las superficies se mueven en la misma trama.
+ */
+static void servo_out_wrap_irq() {
+    pwm_clear_irq(servo_sync_slice);
+    if (!servo_pending) {
+        return;
+    }
+
+    const uint32_t *frame = servo_frames[servo_front];
+    for (uint slice_num = 0; slice_num < NUM_PWM_SLICES; slice_num++) {
+        if (servo_slice_mask & (1u << slice_num)) {
+            pwm_hw->slice[slice_num].cc = frame[slice_num];
+        }
+    }
+    servo_pending = false;
+}
+
+/**
+ * @brief Configura una sola vez los slices PWM de las salidas con resolución de 1 us.
+ */
+void servo_out_init() {
+    pwm_config config = pwm_get_default_config();
+    pwm_config_set_clkdiv(&config, (float)clock_get_hz(clk_sys) / 1000000.0f);
+    pwm_config_set_wrap(&config, SERVO_PERIOD_US - 1);
+
+    uint32_t slice_mask = 0;
+    for (int i = 0; i < SERVO_OUTPUTS; i++) {
+        uint slice_num = pwm_gpio_to_slice_num(servo_outputs[i].gpio);
+        if (!(slice_mask & (1u << slice_num))) {
+            pwm_init(slice_num, &config, false);
+            slice_mask |= 1u << slice_num;
+        }
+        gpio_set_function(servo_outputs[i].gpio, GPIO_FUNC_PWM);
+    }
+    servo_slice_mask = slice_mask;
+
+    // La interrupción queda en el núcleo que llama a esta función, que debe ser el que publica
+    servo_sync_slice = pwm_gpio_to_slice_num(servo_outputs[0].gpio);
+    pwm_clear_irq(servo_sync_slice);
+    pwm_set_irq_enabled(servo_sync_slice, true);
+    irq_set_exclusive_handler(PWM_IRQ_WRAP, servo_out_wrap_irq);
+    irq_set_enabled(PWM_IRQ_WRAP, true);
+
+    // Todos los slices arrancan a la vez para que sus tramas queden en fase
+    pwm_set_mask_enabled(pwm_hw->en | slice_mask);
+}
+
+/**
+ * @brief Fija el ancho de pulso de una salida en la trama en composición.
+ *
+ * @param gpio Pin GPIO de la salida.
+ * @param pulse_us Ancho del pulso en microsegundos.
+ */
+void servo_out_set_us(uint gpio, int32_t pulse_us) {
+    for (int i = 0; i < SERVO_OUTPUTS; i++) {
+        const ServoOutput *out = &servo_outputs[i];
+        if (out->gpio != gpio) {
+            continue;
+        }
+
+        if (pulse_us < out->min_us) {
+            pulse_us = out->min_us;
+        } else if (pulse_us > out->max_us) {
+            pulse_us = out->max_us;
+        }
+
+        uint32_t *cc = &servo_frames[servo_back][pwm_gpio_to_slice_num(gpio)];
+        if (pwm_gpio_to_channel(gpio) == PWM_CHAN_B) {
+            *cc = (*cc & 0x0000FFFF) | ((uint32_t)pulse_us << 16);
+        } else {
+            *cc = (*cc & 0xFFFF0000) | (uint32_t)pulse_us;
+        }
+        return;
+    }
+}
+
+/**
+ * @brief Publica la trama en composición para que se aplique en el siguiente fin de periodo.
+ */
+void servo_out_publish() {
+    uint8_t published = servo_back;
+
+    // La interrupción corre en este mismo núcleo, así que el cambio de trama es atómico
+    servo_front = published;
+    servo_pending = true;
+
+    // La nueva trama en composición parte de la recién publicada
+    servo_back = published ^ 1;
+    for (uint slice_num = 0; slice_num < NUM_PWM_SLICES; slice_num++) {
+        servo_frames[servo_back][slice_num] = servo_frames[published][slice_num];
+    }
+}
@@ -0,0 +1,50 @@
+/**
+ * @file servo_out.h
+ * @brief Declaraciones para las salidas PWM de los servomotores.
+ */
+
+#ifndef SERVO_OUT_H
+#define SERVO_OUT_H
+
+#include "pico/stdlib.h"
+
+// Pines al que se conecta la señal PWM saliente
+#define PWM_OUT1 4  ///< Dirección d
+#define PWM_OUT2 5  ///< Dirección t
+#define PWM_OUT3 6  ///< Elevación
+#define PWM_OUT4 7  ///< Ala derecha
+#define PWM_OUT5 8  ///< Ala izquierda
+
+#define SERVO_OUTPUTS 5         ///< Número de salidas de servo
+#define SERVO_PERIOD_US 20000   ///< Periodo de la señal de servo (50 Hz)
+#define SERVO_MIN_US 500        ///< Pulso mínimo permitido por defecto
+#define SERVO_MAX_US 2500       ///< Pulso máximo permitido por defecto
+
+/**
+ * @brief Configura una sola vez los slices PWM de las salidas con resolución de 1 us.
+ *
+ * También habilita la interrupción de fin de periodo que aplica las tramas publicadas,
+ * en el núcleo que llama a la función. Las salidas arrancan sin pulso hasta la primera
+ * trama publicada.
+ */
+void servo_out_init();
+
+/**
+ * @brief Fija el ancho de pulso de una salida en la trama en composición.
+ *
+ * El valor se limita al rango de la salida. No llega a los servos hasta servo_out_publish().
+ *
+ * @param gpio Pin GPIO de la salida.
+ * @param pulse_us Ancho del pulso en microsegundos.
+ */
+void servo_out_set_us(uint gpio, int32_t pulse_us);
+
+/**
+ * @brief Publica la trama en composición sin bloquear.
+ *
+ * Todas las salidas la aplican juntas en el siguiente periodo; si se publica otra trama
+ * antes, solo se aplica la más reciente.
+ */
+void servo_out_publish();
+
+#endif // SERVO_OUT_H
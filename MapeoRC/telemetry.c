@@ -0,0 +1,69 @@
+/**
+ * @file telemetry.c
+ * @brief Envío de tramas binarias de telemetría por el USB CDC sin bloquear.
+ *
+ * Escribe directamente en el FIFO de TinyUSB que también usa stdio_usb. La escritura
+ * se hace con las interrupciones deshabilitadas para que la tarea de fondo del USB
+ * (una interrupción del mismo núcleo) no la encuentre a medias; es una copia de unas
+ * decenas de bytes, sin esperas.
+ */
+
+#include <string.h>
+#include "telemetry.h"
+#include "hardware/sync.h"
+#include "tusb.h"
+
+static uint16_t telemetry_seq;
+static uint32_t telemetry_dropped;
+
+/**
+ * @brief Arma una trama y la deja en el buffer del USB CDC si cabe entera.
+ *
+ * @param type Tipo de trama (TELEMETRY_TYPE_*).
+ * @param payload Carga de la trama.
+ * @param len Bytes de la carga (hasta TELEMETRY_MAX_PAYLOAD).
+ * @return Verdadero si la trama quedó en el buffer.
+ */
+bool telemetry_send(uint8_t type, const void *payload, uint8_t len) {
+    if (len > TELEMETRY_MAX_PAYLOAD) {
+        return false;
+    }
+
+    uint8_t frame[TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_PAYLOAD + TELEMETRY_CRC_SIZE];
+    uint32_t size = TELEMETRY_HEADER_SIZE + len + TELEMETRY_CRC_SIZE;
+    frame[0] = TELEMETRY_SYNC0;
+    frame[1] = TELEMETRY_SYNC1;
+    frame[2] = type;
+    frame[3] = len;
+    frame[4] = telemetry_seq & 0xFF;
+    frame[5] = telemetry_seq >> 8;
+    memcpy(&frame[TELEMETRY_HEADER_SIZE], payload, len);
+    uint16_t crc = telemetry_crc16(0xFFFF, &frame[2], TELEMETRY_HEADER_SIZE - 2 + len);
+    frame[TELEMETRY_HEADER_SIZE + len] = crc & 0xFF;
+    frame[TELEMETRY_HEADER_SIZE + len + 1] = crc >> 8;
+
+    // La secuencia avanza también con las descartadas: el receptor ve el hueco
+    telemetry_seq++;
+
+    uint32_t status = save_and_disable_interrupts();
+    bool sent = tud_cdc_connected() && tud_cdc_write_available() >= size;
+    if (sent) {
+        tud_cdc_write(frame, size);
+        tud_cdc_write_flush();
+    }
+    restore_interrupts(status);
+
+    if (!sent) {
+        telemetry_dropped++;
+    }
+    return sent;
+}
+
+/**
+ * @brief Tramas descartadas desde el arranque.
+ *
+ * @return Número de tramas que no cupieron en el buffer del USB.
+ */
+uint32_t telemetry_drops() {
+    return telemetry_dropped;
+}
@@ -0,0 +1,36 @@
+/**
+ * @file telemetry.h
+ * @brief Envío de tramas binarias de telemetría por el USB CDC sin bloquear.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "pico/stdlib.h"
+#include "telemetry_format.h"
+
+#ifndef TELEMETRY_BINARY
+#define TELEMETRY_BINARY 0  ///< 1 para enviar la telemetría en tramas binarias en lugar de texto
+#endif
+
+/**
+ * @brief Arma una trama y la deja en el buffer del USB CDC si cabe entera.
+ *
+ * Nunca espera al PC: si no hay sitio, o no hay ningún terminal abierto, la trama se
+ * descarta y se cuenta. Debe llamarse desde el núcleo que atiende el USB.
+ *
+ * @param type Tipo de trama (TELEMETRY_TYPE_*).
+ * @param payload Carga de la trama.
+ * @param len Bytes de la carga (hasta TELEMETRY_MAX_PAYLOAD).
+ * @return Verdadero si la trama quedó en el buffer.
+ */
+bool telemetry_send(uint8_t type, const void *payload, uint8_t len);
+
+/**
+ * @brief Tramas descartadas desde el arranque.
+ *
+ * @return Número de tramas que no cupieron en el buffer del USB.
+ */
+uint32_t telemetry_drops();
+
+#endif // TELEMETRY_H
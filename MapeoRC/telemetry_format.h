@@ -0,0 +1,119 @@
+/**
+ * @file telemetry_format.h
+ * @brief Formato de las tramas binarias de telemetría, compartido con las herramientas del PC.
+ *
+ * Cada trama es:
+ *
+ *     A5 5A | tipo | longitud | secuencia (2) | carga (longitud) | CRC-16 (2)
+ *
+ * Los campos de varios bytes van en little-endian, como los guardan el RP2040 y un
+ * PC x86 o ARM. La secuencia crece en cada trama que la placa intenta enviar, de modo
+ * que un salto en el receptor cuenta las tramas perdidas. El CRC es CRC-16/CCITT-FALSE
+ * (polinomio 0x1021, valor inicial 0xFFFF) sobre todo lo que va entre la sincronía y
+ * el propio CRC. Entre tramas puede haber texto de printf: el receptor lo salta
+ * buscando la sincronía y comprobando el CRC.
+ *
+ * Solo depende de la biblioteca estándar de C.
+ */
+
+#ifndef TELEMETRY_FORMAT_H
+#define TELEMETRY_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TELEMETRY_SYNC0 0xA5        ///< Primer byte de sincronía
+#define TELEMETRY_SYNC1 0x5A        ///< Segundo byte de sincronía
+#define TELEMETRY_HEADER_SIZE 6     ///< Sincronía, tipo, longitud y secuencia
+#define TELEMETRY_CRC_SIZE 2        ///< CRC al final de la trama
+#define TELEMETRY_MAX_PAYLOAD 96    ///< Carga máxima de una trama
+
+#define TELEMETRY_TYPE_CONTROL 1    ///< Una actualización del controlador (TelemetryControl)
+#define TELEMETRY_TYPE_STATUS 2     ///< Estado periódico del sistema (TelemetryStatus)
+#define TELEMETRY_TYPE_LOG 3        ///< Mensaje de depuración con formato diferido (TelemetryLog)
+
+#define TELEMETRY_LOG_MAX_ARGS 6    ///< Argumentos de un mensaje de depuración
+
+#define TELEMETRY_FLAG_STABILIZE 0x01 ///< Modo de estabilización activo
+#define TELEMETRY_FLAG_CASCADE 0x02   ///< Salida del lazo de velocidad de la cascada
+
+/**
+ * @brief Carga de una trama TELEMETRY_TYPE_CONTROL, enviada en cada salida del controlador.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp_us;  ///< Instante de la salida
+    int32_t accel[3];       ///< Última muestra del acelerómetro (con accel_frac_bits fraccionarios)
+    float pitch;            ///< Pitch medido con el acelerómetro, grados
+    float filtered_pitch;   ///< Pitch estimado, grados
+    float output_pitch;     ///< Salida del controlador del eje de pitch
+    float output_roll;      ///< Salida del controlador del eje de alabeo (0 sin AHRS)
+    int16_t rc_pulse[4];    ///< Pulsos del receptor en us (Cn1, Cn2, Cn4, Cn6)
+    int16_t wing_right_us;  ///< Pulso publicado para el ala derecha
+    int16_t wing_left_us;   ///< Pulso publicado para el ala izquierda
+    uint8_t flags;          ///< TELEMETRY_FLAG_*
+} TelemetryControl;
+
+/**
+ * @brief Carga de una trama TELEMETRY_TYPE_STATUS, enviada a la frecuencia de telemetría.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp_us;      ///< Instante del envío
+    int16_t rc_pulse[4];        ///< Pulsos del receptor en us (también fuera de estabilización)
+    float control_dt;           ///< Último intervalo medido del lazo de control, s
+    uint32_t control_max_us;    ///< Mayor tiempo de ejecución del lazo de control
+    uint32_t control_misses;    ///< Plazos perdidos del lazo de control
+    uint32_t control_jitter_us; ///< Mayor desviación del inicio del lazo de control respecto a su periodo
+    uint32_t sensor_latency_us; ///< Edad de la última muestra del acelerómetro al filtrarla
+    uint32_t sensor_overruns;   ///< Muestras del acelerómetro perdidas
+    uint32_t telemetry_drops;   ///< Tramas descartadas por falta de sitio en el USB
+    float roll;                 ///< Alabeo estimado, grados (0 sin AHRS)
+    float pitch;                ///< Pitch estimado, grados
+    float yaw;                  ///< Guiñada estimada, grados (0 sin AHRS)
+    float rate_setpoint;        ///< Velocidad de pitch pedida al lazo de velocidad, grados/s (0 sin cascada)
+    float rate_measured;        ///< Velocidad de pitch medida sin sesgo, grados/s (0 sin giróscopo)
+    uint32_t rate_max_us;       ///< Mayor tiempo de ejecución del lazo de velocidad (0 sin cascada)
+    uint32_t rate_misses;       ///< Plazos perdidos del lazo de velocidad (0 sin cascada)
+    uint32_t ahrs_cycles;       ///< Ciclos de la última actualización del AHRS (0 sin AHRS)
+    uint32_t ahrs_cycles_max;   ///< Máximo de ciclos por actualización del AHRS (0 sin AHRS)
+    uint8_t accel_frac_bits;    ///< Bits fraccionarios de TelemetryControl::accel
+    uint8_t flags;              ///< TELEMETRY_FLAG_*
+} TelemetryStatus;
+
+/**
+ * @brief Carga de una trama TELEMETRY_TYPE_LOG: un mensaje sin formatear.
+ *
+ * El formato no viaja: format_id es su dirección dentro de la sección .dlog_fmt
+ * del ELF, que no se carga en la flash. Cada argumento ocupa 32 bits (los float,
+ * con sus bits IEEE 754) y la longitud de la trama dice cuántos hay.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t format_id;                     ///< Dirección del formato en .dlog_fmt
+    uint32_t timestamp_us;                  ///< Instante del mensaje
+    uint32_t args[TELEMETRY_LOG_MAX_ARGS];  ///< Argumentos (solo los usados se envían)
+} TelemetryLog;
+
+#define TELEMETRY_LOG_HEADER_SIZE 8 ///< Bytes de TelemetryLog antes de los argumentos
+
+_Static_assert(sizeof(TelemetryControl) <= TELEMETRY_MAX_PAYLOAD, "TelemetryControl no cabe en una trama");
+_Static_assert(sizeof(TelemetryStatus) <= TELEMETRY_MAX_PAYLOAD, "TelemetryStatus no cabe en una trama");
+_Static_assert(sizeof(TelemetryLog) <= TELEMETRY_MAX_PAYLOAD, "TelemetryLog no cabe en una trama");
+
+/**
+ * @brief Acumula bytes en un CRC-16/CCITT-FALSE.
+ *
+ * @param crc Valor anterior (0xFFFF al empezar).
+ * @param data Bytes a acumular.
+ * @param len Número de bytes.
+ * @return CRC actualizado.
+ */
+static inline uint16_t telemetry_crc16(uint16_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 0x8000 ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+#endif // TELEMETRY_FORMAT_H
@@ -0,0 +1,242 @@
+/**
+ * @file blackbox_decode.c
+ * @brief Decodificador en el PC del registro de vuelo guardado en la flash.
+ *
+ * Lee una copia de la zona del registro, ordena los sectores por su secuencia y
+ * escribe una fila CSV por registro. Con la zona por defecto (el último MB de los
+ * 2 MB de la Pico W):
+ *
+ *     picotool save -r 0x10100000 0x10200000 blackbox.bin
+ *     cc -O2 -o blackbox_decode blackbox_decode.c blackbox_log.c
+ *     ./blackbox_decode blackbox.bin > vuelos.csv
+ *
+ * Con -o escribe en su lugar el contenedor indexado de blackbox_log.h, para
+ * analizarlo con blackbox_stats:
+ *
+ *     ./blackbox_decode -o vuelos.bbl blackbox.bin
+ *
+ * La columna session distingue los arranques de la placa; -S escribe solo uno. Al
+ * terminar resume en stderr los sectores leídos, los cortados por un apagado con la
+ * última página sin programar, los dañados y los huecos de secuencia (sectores ya
+ * reescritos por el anillo).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "blackbox_log.h"
+
+/**
+ * @brief Un sector con cabecera válida dentro de la copia.
+ */
+typedef struct {
+    const uint8_t *data;            ///< Contenido del sector
+    BlackboxSectorHeader header;    ///< Cabecera del sector
+} SectorRef;
+
+/**
+ * @brief Ordena los sectores por secuencia, teniendo en cuenta el desbordamiento.
+ */
+static int sector_compare(const void *a, const void *b) {
+    int32_t diff = (int32_t)(((const SectorRef *)a)->header.sequence - ((const SectorRef *)b)->header.sequence);
+    return (diff > 0) - (diff < 0);
+}
+
+/**
+ * @brief Escribe la cabecera de columnas.
+ *
+ * @param out Fichero de salida.
+ */
+static void record_header(FILE *out) {
+    fprintf(out, "session,sequence,timestamp_us,rc_cn1,rc_cn2,rc_cn4,rc_cn6,accel_x,accel_y,accel_z,pitch,"
+                 "filtered_pitch,p_term,i_term,d_term,output_pitch,output_roll,wing_right_us,wing_left_us\n");
+}
+
+/**
+ * @brief Escribe una fila con un registro, deshaciendo las escalas enteras.
+ *
+ * @param out Fichero de salida.
+ * @param header Cabecera del sector del registro.
+ * @param v Campos del registro.
+ */
+static void record_row(FILE *out, const BlackboxSectorHeader *header, const int32_t *v) {
+    fprintf(out, "%lu,%lu,%lu,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%.2f,%.2f,%.3f,%.3f,%.3f,%.3f,%.3f,%ld,%ld\n",
+            (unsigned long)header->session, (unsigned long)header->sequence, (unsigned long)(uint32_t)v[BB_TIMESTAMP_US],
+            (long)v[BB_RC_CN1], (long)v[BB_RC_CN2], (long)v[BB_RC_CN4], (long)v[BB_RC_CN6], (long)v[BB_ACCEL_X],
+            (long)v[BB_ACCEL_Y], (long)v[BB_ACCEL_Z], v[BB_PITCH_CDEG] / 100.0, v[BB_FILTERED_CDEG] / 100.0,
+            v[BB_P_TERM_MILLI] / 1000.0, v[BB_I_TERM_MILLI] / 1000.0, v[BB_D_TERM_MILLI] / 1000.0,
+            v[BB_OUTPUT_PITCH_MILLI] / 1000.0, v[BB_OUTPUT_ROLL_MILLI] / 1000.0, (long)v[BB_WING_RIGHT_US],
+            (long)v[BB_WING_LEFT_US]);
+}
+
+/**
+ * @brief Resultado de decodificar un sector.
+ */
+typedef enum {
+    SECTOR_OK,          ///< Termina en la marca de fin o justo al final del sector
+    SECTOR_TRUNCATED,   ///< El último registro se corta en flash borrada (página aún no programada)
+    SECTOR_DAMAGED,     ///< Un registro no se puede decodificar
+} SectorStatus;
+
+/**
+ * @brief Comprueba si todos los bytes desde una posición siguen borrados.
+ *
+ * @param data Contenido del sector.
+ * @param pos Primer byte a comprobar.
+ * @return Verdadero si del byte pos al final del sector todo vale 0xFF.
+ */
+static bool sector_blank_from(const uint8_t *data, uint32_t pos) {
+    for (; pos < BLACKBOX_SECTOR_SIZE; pos++) {
+        if (data[pos] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Decodifica los registros de un sector.
+ *
+ * @param out Fichero de salida del CSV.
+ * @param writer Contenedor en el que escribir en lugar del CSV, o NULL.
+ * @param sector Sector a decodificar.
+ * @param records Registros escritos, sumados al valor anterior.
+ * @return Cómo terminó el sector.
+ */
+static SectorStatus decode_sector(FILE *out, BblWriter *writer, const SectorRef *sector, unsigned long *records) {
+    int32_t values[BLACKBOX_FIELDS] = {0};
+    uint32_t fields = sector->header.fields;
+    uint32_t pos = sizeof(BlackboxSectorHeader);
+    while (pos < BLACKBOX_SECTOR_SIZE && sector->data[pos] != BLACKBOX_END) {
+        uint32_t start = pos;
+        uint32_t len = sector->data[pos++];
+        bool ok = len > 0 && pos + len <= BLACKBOX_SECTOR_SIZE;
+        const uint8_t *in = &sector->data[pos];
+        uint32_t used = 0;
+        int32_t next[BLACKBOX_FIELDS];
+        memcpy(next, values, sizeof(next));
+        for (uint32_t i = 0; ok && i < fields; i++) {
+            int32_t delta;
+            uint32_t n = blackbox_get_varint(&in[used], len - used, &delta);
+            ok = n > 0;
+            used += n;
+            // Los campos que este decodificador no conoce se saltan
+            if (ok && i < BLACKBOX_FIELDS) {
+                next[i] = (int32_t)((uint32_t)values[i] + (uint32_t)delta);
+            }
+        }
+        if (!ok || used != len) {
+            // Un corte de alimentación deja el último registro a medias sobre flash borrada
+            uint32_t last = BLACKBOX_SECTOR_SIZE;
+            while (last > start && sector->data[last - 1] == 0xFF) {
+                last--;
+            }
+            return start + 1 + len > last && sector_blank_from(sector->data, last) ? SECTOR_TRUNCATED
+                                                                                    : SECTOR_DAMAGED;
+        }
+        memcpy(values, next, sizeof(values));
+        if (writer) {
+            bbl_writer_add(writer, sector->header.session, values);
+        } else {
+            record_row(out, &sector->header, values);
+        }
+        (*records)++;
+        pos += len;
+    }
+    return SECTOR_OK;
+}
+
+int main(int argc, char **argv) {
+    const char *input = NULL;
+    long session = -1;
+    const char *container = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            session = strtol(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            container = argv[++i];
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            fprintf(stderr, "uso: %s [-S sesión] [-o vuelos.bbl] blackbox.bin\n", argv[0]);
+            return 1;
+        } else {
+            input = argv[i];
+        }
+    }
+    if (!input) {
+        fprintf(stderr, "uso: %s [-S sesión] [-o vuelos.bbl] blackbox.bin\n", argv[0]);
+        return 1;
+    }
+
+    FILE *f = fopen(input, "rb");
+    if (!f) {
+        perror(input);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *image = malloc(file_size > 0 ? (size_t)file_size : 1);
+    if (!image || fread(image, 1, (size_t)file_size, f) != (size_t)file_size) {
+        fprintf(stderr, "%s: no se pudo leer\n", input);
+        fclose(f);
+        free(image);
+        return 1;
+    }
+    fclose(f);
+    if (file_size % BLACKBOX_SECTOR_SIZE != 0) {
+        fprintf(stderr, "%s: el tamaño no es múltiplo de %d; se ignora el final\n", input, BLACKBOX_SECTOR_SIZE);
+    }
+
+    // Sectores con cabecera válida, en orden de escritura
+    size_t num_sectors = (size_t)file_size / BLACKBOX_SECTOR_SIZE;
+    SectorRef *sectors = malloc((num_sectors ? num_sectors : 1) * sizeof(SectorRef));
+    size_t count = 0;
+    for (size_t s = 0; s < num_sectors; s++) {
+        const uint8_t *data = &image[s * BLACKBOX_SECTOR_SIZE];
+        BlackboxSectorHeader header;
+        memcpy(&header, data, sizeof(header));
+        if (header.magic == BLACKBOX_MAGIC) {
+            sectors[count].data = data;
+            sectors[count].header = header;
+            count++;
+        }
+    }
+    qsort(sectors, count, sizeof(SectorRef), sector_compare);
+
+    BblWriter writer;
+    if (container) {
+        if (!bbl_writer_open(&writer, container)) {
+            free(sectors);
+            free(image);
+            return 1;
+        }
+    } else {
+        record_header(stdout);
+    }
+    unsigned long records = 0, damaged = 0, truncated = 0, gaps = 0;
+    for (size_t s = 0; s < count; s++) {
+        if (s > 0 && sectors[s].header.sequence != sectors[s - 1].header.sequence + 1) {
+            gaps++;
+        }
+        if (session >= 0 && sectors[s].header.session != (uint32_t)session) {
+            continue;
+        }
+        SectorStatus status = decode_sector(stdout, container ? &writer : NULL, &sectors[s], &records);
+        damaged += status == SECTOR_DAMAGED;
+        truncated += status == SECTOR_TRUNCATED;
+    }
+
+    if (container && !bbl_writer_close(&writer)) {
+        perror(container);
+        free(sectors);
+        free(image);
+        return 1;
+    }
+
+    fprintf(stderr, "sectores: %zu de %zu, registros: %lu, sectores cortados: %lu, dañados: %lu, huecos de secuencia: %lu\n",
+            count, num_sectors, records, truncated, damaged, gaps);
+    free(sectors);
+    free(image);
+    return 0;
+}
@@ -0,0 +1,271 @@
+/**
+ * @file blackbox_log.c
+ * @brief Escritura y lectura del contenedor indexado de registros de vuelo.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "blackbox_log.h"
+
+#define BBL_BLOCK_MAX (BBL_BLOCK_RECORDS * (BLACKBOX_FIELDS * 5 + 1)) ///< Mayor bloque posible
+
+/**
+ * @brief Empieza un bloque vacío para una sesión.
+ *
+ * @param writer Escritor.
+ * @param session Sesión del bloque.
+ */
+static void bbl_block_start(BblWriter *writer, uint32_t session) {
+    writer->block_len = 0;
+    memset(writer->prev, 0, sizeof(writer->prev));
+    memset(&writer->current, 0, sizeof(writer->current));
+    writer->current.session = session;
+}
+
+/**
+ * @brief Escribe el bloque en curso, si tiene registros, y apunta su entrada del índice.
+ *
+ * @param writer Escritor.
+ * @return Falso si falló la escritura.
+ */
+static bool bbl_block_flush(BblWriter *writer) {
+    if (writer->current.records == 0) {
+        return true;
+    }
+    if (fwrite(writer->block, 1, writer->block_len, writer->file) != writer->block_len) {
+        return false;
+    }
+    if (writer->block_count == writer->index_capacity) {
+        uint32_t capacity = writer->index_capacity ? 2 * writer->index_capacity : 64;
+        BblIndexEntry *index = realloc(writer->index, capacity * sizeof(BblIndexEntry));
+        if (!index) {
+            return false;
+        }
+        writer->index = index;
+        writer->index_capacity = capacity;
+    }
+    writer->current.offset = writer->offset;
+    writer->current.size = (uint32_t)writer->block_len;
+    writer->index[writer->block_count++] = writer->current;
+    writer->offset += writer->block_len;
+    bbl_block_start(writer, writer->current.session);
+    return true;
+}
+
+/**
+ * @brief Crea un contenedor vacío.
+ *
+ * @param writer Escritor a preparar.
+ * @param path Ruta del fichero.
+ * @return Falso si no se pudo crear.
+ */
+bool bbl_writer_open(BblWriter *writer, const char *path) {
+    memset(writer, 0, sizeof(*writer));
+    writer->file = fopen(path, "wb");
+    writer->block = malloc(BBL_BLOCK_MAX);
+    if (!writer->file || !writer->block) {
+        perror(path);
+        if (writer->file) {
+            fclose(writer->file);
+        }
+        free(writer->block);
+        return false;
+    }
+
+    // La cabecera queda sin índice hasta cerrar
+    BblFileHeader header = {
+        .magic = BBL_MAGIC,
+        .version = BBL_VERSION,
+        .fields = BLACKBOX_FIELDS,
+    };
+    if (fwrite(&header, sizeof(header), 1, writer->file) != 1) {
+        perror(path);
+        fclose(writer->file);
+        free(writer->block);
+        writer->file = NULL;
+        writer->block = NULL;
+        return false;
+    }
+    writer->offset = sizeof(header);
+    bbl_block_start(writer, 0);
+    return true;
+}
+
+/**
+ * @brief Añade un registro; cierra el bloque si está lleno o cambia la sesión.
+ *
+ * @param writer Escritor.
+ * @param session Sesión del registro.
+ * @param values Valor de cada campo (BlackboxField).
+ * @return Falso si falló la escritura.
+ */
+bool bbl_writer_add(BblWriter *writer, uint32_t session, const int32_t values[BLACKBOX_FIELDS]) {
+    BblIndexEntry *entry = &writer->current;
+    if (entry->records > 0 && (entry->records == BBL_BLOCK_RECORDS || entry->session != session)) {
+        if (!bbl_block_flush(writer)) {
+            return false;
+        }
+    }
+    if (entry->records == 0) {
+        entry->session = session;
+        entry->first_timestamp_us = (uint32_t)values[BB_TIMESTAMP_US];
+        memcpy(entry->min, values, sizeof(entry->min));
+        memcpy(entry->max, values, sizeof(entry->max));
+    }
+
+    uint8_t *out = &writer->block[writer->block_len];
+    uint32_t n = 1;
+    for (uint32_t i = 0; i < BLACKBOX_FIELDS; i++) {
+        n += blackbox_put_varint(&out[n], (int32_t)((uint32_t)values[i] - (uint32_t)writer->prev[i]));
+        writer->prev[i] = values[i];
+        entry->min[i] = values[i] < entry->min[i] ? values[i] : entry->min[i];
+        entry->max[i] = values[i] > entry->max[i] ? values[i] : entry->max[i];
+    }
+    out[0] = (uint8_t)(n - 1);
+    writer->block_len += n;
+    entry->last_timestamp_us = (uint32_t)values[BB_TIMESTAMP_US];
+    entry->records++;
+    return true;
+}
+
+/**
+ * @brief Escribe el último bloque y el índice y cierra el fichero.
+ *
+ * @param writer Escritor.
+ * @return Falso si falló la escritura.
+ */
+bool bbl_writer_close(BblWriter *writer) {
+    bool ok = bbl_block_flush(writer);
+    ok = ok && fwrite(writer->index, sizeof(BblIndexEntry), writer->block_count, writer->file) == writer->block_count;
+
+    // Con el índice ya en su sitio, la cabecera lo señala
+    BblFileHeader header = {
+        .magic = BBL_MAGIC,
+        .version = BBL_VERSION,
+        .fields = BLACKBOX_FIELDS,
+        .block_count = writer->block_count,
+        .index_offset = writer->offset,
+    };
+    ok = ok && fseek(writer->file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, writer->file) == 1;
+    ok = (fclose(writer->file) == 0) && ok;
+    free(writer->block);
+    free(writer->index);
+    return ok;
+}
+
+/**
+ * @brief Proyecta un contenedor en memoria y comprueba su índice.
+ *
+ * @param reader Lector a preparar.
+ * @param path Ruta del fichero.
+ * @return Falso si el fichero no es un contenedor completo y válido.
+ */
+bool bbl_reader_open(BblReader *reader, const char *path) {
+    memset(reader, 0, sizeof(*reader));
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    if ((size_t)st.st_size < sizeof(BblFileHeader)) {
+        fprintf(stderr, "%s: no es un contenedor de registros\n", path);
+        close(fd);
+        return false;
+    }
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror(path);
+        return false;
+    }
+    reader->data = data;
+    reader->size = (size_t)st.st_size;
+
+    BblFileHeader header;
+    memcpy(&header, reader->data, sizeof(header));
+    if (header.magic != BBL_MAGIC || header.version != BBL_VERSION || header.fields != BLACKBOX_FIELDS) {
+        fprintf(stderr, "%s: no es un contenedor de registros de esta versión\n", path);
+        bbl_reader_close(reader);
+        return false;
+    }
+    if (header.index_offset == 0 || header.index_offset > reader->size ||
+        (reader->size - header.index_offset) / sizeof(BblIndexEntry) < header.block_count) {
+        fprintf(stderr, "%s: el índice falta o está cortado (¿no se cerró el fichero?)\n", path);
+        bbl_reader_close(reader);
+        return false;
+    }
+    reader->index = (const BblIndexEntry *)(reader->data + header.index_offset);
+    reader->block_count = header.block_count;
+    for (uint32_t b = 0; b < reader->block_count; b++) {
+        const BblIndexEntry *entry = &reader->index[b];
+        if (entry->offset > header.index_offset || entry->size > header.index_offset - entry->offset ||
+            entry->records > BBL_BLOCK_RECORDS) {
+            fprintf(stderr, "%s: la entrada %lu del índice no es válida\n", path, (unsigned long)b);
+            bbl_reader_close(reader);
+            return false;
+        }
+    }
+    madvise((void *)reader->data, reader->size, MADV_SEQUENTIAL);
+    return true;
+}
+
+/**
+ * @brief Libera la proyección del contenedor.
+ *
+ * @param reader Lector.
+ */
+void bbl_reader_close(BblReader *reader) {
+    if (reader->data) {
+        munmap((void *)reader->data, reader->size);
+    }
+    memset(reader, 0, sizeof(*reader));
+}
+
+/**
+ * @brief Decodifica todos los registros de un bloque.
+ *
+ * @param reader Lector.
+ * @param block Índice del bloque.
+ * @param values Destino, con sitio para los registros del bloque por BLACKBOX_FIELDS.
+ * @return Registros decodificados; menos que los del índice si el bloque está dañado.
+ */
+uint32_t bbl_decode_block(const BblReader *reader, uint32_t block, int32_t *values) {
+    const BblIndexEntry *entry = &reader->index[block];
+    const uint8_t *in = reader->data + entry->offset;
+    uint32_t size = entry->size;
+    int32_t prev[BLACKBOX_FIELDS] = {0};
+    uint32_t pos = 0;
+    uint32_t records = 0;
+    while (records < entry->records && pos < size) {
+        uint32_t len = in[pos++];
+        if (len == 0 || len > size - pos) {
+            break;
+        }
+        uint32_t used = 0;
+        int32_t *v = &values[(size_t)records * BLACKBOX_FIELDS];
+        for (uint32_t i = 0; i < BLACKBOX_FIELDS; i++) {
+            int32_t delta;
+            uint32_t n = blackbox_get_varint(&in[pos + used], len - used, &delta);
+            if (n == 0) {
+                return records;
+            }
+            used += n;
+            prev[i] = (int32_t)((uint32_t)prev[i] + (uint32_t)delta);
+            v[i] = prev[i];
+        }
+        if (used != len) {
+            break;
+        }
+        pos += len;
+        records++;
+    }
+    return records;
+}
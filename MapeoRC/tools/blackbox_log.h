@@ -0,0 +1,139 @@
+/**
+ * @file blackbox_log.h
+ * @brief Contenedor indexado de registros de vuelo para analizar en el PC.
+ *
+ * Guarda los mismos campos que el registro de la flash (BlackboxField), venga de la
+ * flash o de la telemetría, en bloques que se decodifican cada uno por su cuenta y
+ * con un índice al final que permite saltar o repartir bloques sin leerlos:
+ *
+ *     BblFileHeader | bloque 0 | bloque 1 | ... | BblIndexEntry[block_count]
+ *
+ * Cada bloque tiene hasta BBL_BLOCK_RECORDS registros de una sola sesión, codificados
+ * como en la flash (byte de longitud y diferencias en zigzag y varint) y empezando
+ * desde ceros. Su entrada del índice da dónde está, la sesión, los instantes del
+ * primer y el último registro y el mínimo y el máximo de cada campo. Todo va en
+ * little-endian, y el índice se escribe al cerrar el fichero: un contenedor sin
+ * index_offset no se terminó de escribir.
+ *
+ * Las herramientas lo crean con la opción -o (blackbox_decode y telemetry_decode) y
+ * lo analizan con blackbox_stats.
+ */
+
+#ifndef BLACKBOX_LOG_H
+#define BLACKBOX_LOG_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "../blackbox_format.h"
+
+#define BBL_MAGIC 0x474C4242u       ///< "BBLG" en little-endian
+#define BBL_VERSION 1               ///< Versión del contenedor
+#define BBL_BLOCK_RECORDS 8192      ///< Registros por bloque como máximo
+
+/**
+ * @brief Cabecera del fichero.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;         ///< BBL_MAGIC
+    uint16_t version;       ///< BBL_VERSION
+    uint16_t fields;        ///< BLACKBOX_FIELDS al escribirlo
+    uint32_t block_count;   ///< Entradas del índice
+    uint32_t reserved;      ///< A cero
+    uint64_t index_offset;  ///< Posición del índice (0 mientras se escribe)
+} BblFileHeader;
+
+/**
+ * @brief Entrada del índice: dónde está un bloque y el resumen de sus registros.
+ */
+typedef struct __attribute__((packed)) {
+    uint64_t offset;                ///< Posición del bloque en el fichero
+    uint32_t size;                  ///< Bytes del bloque
+    uint32_t records;               ///< Registros del bloque
+    uint32_t session;               ///< Sesión (arranque o vuelo) de todos sus registros
+    uint32_t first_timestamp_us;    ///< Instante del primer registro
+    uint32_t last_timestamp_us;     ///< Instante del último registro
+    int32_t min[BLACKBOX_FIELDS];   ///< Mínimo de cada campo
+    int32_t max[BLACKBOX_FIELDS];   ///< Máximo de cada campo
+} BblIndexEntry;
+
+/**
+ * @brief Escritor de un contenedor.
+ */
+typedef struct {
+    FILE *file;                     ///< Fichero de salida
+    uint64_t offset;                ///< Posición del siguiente bloque
+    uint8_t *block;                 ///< Bloque en curso
+    size_t block_len;               ///< Bytes del bloque en curso
+    int32_t prev[BLACKBOX_FIELDS];  ///< Registro anterior del bloque en curso
+    BblIndexEntry current;          ///< Resumen del bloque en curso
+    BblIndexEntry *index;           ///< Índice de los bloques ya escritos
+    uint32_t block_count;           ///< Bloques ya escritos
+    uint32_t index_capacity;        ///< Entradas reservadas en index
+} BblWriter;
+
+/**
+ * @brief Contenedor abierto para leer, proyectado en memoria.
+ */
+typedef struct {
+    const uint8_t *data;            ///< Fichero completo
+    size_t size;                    ///< Bytes del fichero
+    const BblIndexEntry *index;     ///< Índice (dentro de data)
+    uint32_t block_count;           ///< Entradas del índice
+} BblReader;
+
+/**
+ * @brief Crea un contenedor vacío.
+ *
+ * @param writer Escritor a preparar.
+ * @param path Ruta del fichero.
+ * @return Falso si no se pudo crear.
+ */
+bool bbl_writer_open(BblWriter *writer, const char *path);
+
+/**
+ * @brief Añade un registro; cierra el bloque si está lleno o cambia la sesión.
+ *
+ * @param writer Escritor.
+ * @param session Sesión del registro.
+ * @param values Valor de cada campo (BlackboxField).
+ * @return Falso si falló la escritura.
+ */
+bool bbl_writer_add(BblWriter *writer, uint32_t session, const int32_t values[BLACKBOX_FIELDS]);
+
+/**
+ * @brief Escribe el último bloque y el índice y cierra el fichero.
+ *
+ * @param writer Escritor.
+ * @return Falso si falló la escritura.
+ */
+bool bbl_writer_close(BblWriter *writer);
+
+/**
+ * @brief Proyecta un contenedor en memoria y comprueba su índice.
+ *
+ * @param reader Lector a preparar.
+ * @param path Ruta del fichero.
+ * @return Falso si el fichero no es un contenedor completo y válido.
+ */
+bool bbl_reader_open(BblReader *reader, const char *path);
+
+/**
+ * @brief Libera la proyección del contenedor.
+ *
+ * @param reader Lector.
+ */
+void bbl_reader_close(BblReader *reader);
+
+/**
+ * @brief Decodifica todos los registros de un bloque.
+ *
+ * Se puede llamar a la vez desde varios hilos con bloques distintos o iguales.
+ *
+ * @param reader Lector.
+ * @param block Índice del bloque.
+ * @param values Destino, con sitio para los registros del bloque por BLACKBOX_FIELDS.
+ * @return Registros decodificados; menos que los del índice si el bloque está dañado.
+ */
+uint32_t bbl_decode_block(const BblReader *reader, uint32_t block, int32_t *values);
+
+#endif // BLACKBOX_LOG_H
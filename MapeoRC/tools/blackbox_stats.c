@@ -0,0 +1,489 @@
+/**
+ * @file blackbox_stats.c
+ * @brief Estadísticas por vuelo de un contenedor de registros (blackbox_log.h).
+ *
+ * Proyecta el contenedor en memoria y reparte sus bloques entre hilos, que los
+ * decodifican y resumen cada uno por su cuenta; los resúmenes se juntan después por
+ * sesión y en el orden del fichero. Para cada sesión da:
+ *
+ * - el periodo del lazo (media, desviación, mínimo y máximo entre registros
+ *   consecutivos); las pausas de más de PAUSE_US, fuera de estabilización, se cuentan
+ *   aparte,
+ * - la saturación: registros con la salida de pitch o de alabeo en el límite,
+ * - el error RMS del pitch estimado frente al nivelado (setpoint 0),
+ * - la vibración del acelerómetro: RMS sin la media y pico del espectro (Welch con
+ *   ventanas de Hann de SPECTRUM_SIZE registros seguidos, sin pausas, dentro de
+ *   cada bloque).
+ *
+ *     cc -O2 -pthread -o blackbox_stats blackbox_stats.c blackbox_log.c -lm
+ *     ./blackbox_stats -s espectro.csv vuelos.bbl
+ *
+ * Con -i solo resume el índice, sin decodificar ningún bloque; -S limita el análisis
+ * a una sesión, -L fija el límite de la salida del PID (PID_OUTPUT_LIMIT) y -j el
+ * número de hilos (por defecto, uno por núcleo).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "blackbox_log.h"
+
+#define SPECTRUM_SIZE 256           ///< Registros por ventana del espectro (potencia de 2)
+#define SPECTRUM_BINS (SPECTRUM_SIZE / 2 + 1) ///< Frecuencias de 0 a Nyquist
+#define PAUSE_US 1000000u           ///< Hueco entre registros que no cuenta como periodo del lazo
+#define DEFAULT_OUTPUT_LIMIT 15.0   ///< PID_OUTPUT_LIMIT del firmware
+
+/**
+ * @brief Resumen de un bloque o de una sesión; se suman campo a campo.
+ */
+typedef struct {
+    uint32_t session;               ///< Sesión resumida
+    uint64_t records;               ///< Registros decodificados
+    uint64_t damaged;               ///< Registros que el índice anuncia y no se pudieron decodificar
+    uint64_t periods;               ///< Periodos del lazo medidos
+    double period_sum;              ///< Suma de los periodos, us
+    double period_sq;               ///< Suma de sus cuadrados
+    uint32_t period_min;            ///< Menor periodo, us
+    uint32_t period_max;            ///< Mayor periodo, us
+    uint64_t pauses;                ///< Huecos de más de PAUSE_US
+    double duration_us;             ///< Tiempo cubierto por los periodos
+    uint64_t saturated;             ///< Registros con alguna salida en el límite
+    double pitch_sq;                ///< Suma del cuadrado del pitch estimado, grados²
+    uint64_t vib_samples;           ///< Muestras usadas en la vibración
+    double vib_sq[3];               ///< Suma del cuadrado del acelerómetro sin la media de su ventana
+    uint64_t windows;               ///< Ventanas del espectro
+    double power[3][SPECTRUM_BINS]; ///< Suma de la potencia de cada ventana por eje
+} FlightStats;
+
+/**
+ * @brief Trabajo compartido por los hilos.
+ */
+typedef struct {
+    const BblReader *reader;        ///< Contenedor
+    const bool *selected;           ///< Bloques a analizar
+    FlightStats *blocks;            ///< Resumen de cada bloque
+    int32_t output_limit_milli;     ///< Salida del PID en el límite, milésimas
+    atomic_uint next;               ///< Siguiente bloque sin repartir
+    atomic_bool failed;             ///< Algún hilo no pudo reservar memoria
+} StatsJob;
+
+/**
+ * @brief FFT compleja radix-2 en el sitio.
+ *
+ * @param re Parte real.
+ * @param im Parte imaginaria.
+ * @param n Puntos (potencia de 2).
+ */
+static void fft(double *re, double *im, uint32_t n) {
+    for (uint32_t i = 1, j = 0; i < n; i++) {
+        uint32_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            double t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    for (uint32_t len = 2; len <= n; len <<= 1) {
+        double angle = -2.0 * M_PI / len;
+        double wr = cos(angle), wi = sin(angle);
+        for (uint32_t i = 0; i < n; i += len) {
+            double cr = 1.0, ci = 0.0;
+            for (uint32_t k = 0; k < len / 2; k++) {
+                uint32_t a = i + k, b = i + k + len / 2;
+                double xr = re[b] * cr - im[b] * ci;
+                double xi = re[b] * ci + im[b] * cr;
+                re[b] = re[a] - xr; im[b] = im[a] - xi;
+                re[a] += xr; im[a] += xi;
+                double t = cr * wr - ci * wi;
+                ci = cr * wi + ci * wr;
+                cr = t;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Añade al resumen el espectro y la vibración de una ventana del acelerómetro.
+ *
+ * @param stats Resumen del bloque.
+ * @param values Primer registro de la ventana.
+ */
+static void add_window(FlightStats *stats, const int32_t *values) {
+    static _Thread_local double window[SPECTRUM_SIZE];
+    static _Thread_local bool window_ready;
+    if (!window_ready) {
+        for (uint32_t i = 0; i < SPECTRUM_SIZE; i++) {
+            window[i] = 0.5 - 0.5 * cos(2.0 * M_PI * i / SPECTRUM_SIZE);
+        }
+        window_ready = true;
+    }
+
+    for (int axis = 0; axis < 3; axis++) {
+        double mean = 0.0;
+        for (uint32_t i = 0; i < SPECTRUM_SIZE; i++) {
+            mean += values[i * BLACKBOX_FIELDS + BB_ACCEL_X + axis];
+        }
+        mean /= SPECTRUM_SIZE;
+
+        double re[SPECTRUM_SIZE], im[SPECTRUM_SIZE];
+        for (uint32_t i = 0; i < SPECTRUM_SIZE; i++) {
+            double x = values[i * BLACKBOX_FIELDS + BB_ACCEL_X + axis] - mean;
+            stats->vib_sq[axis] += x * x;
+            re[i] = x * window[i];
+            im[i] = 0.0;
+        }
+        fft(re, im, SPECTRUM_SIZE);
+        for (uint32_t k = 0; k < SPECTRUM_BINS; k++) {
+            stats->power[axis][k] += re[k] * re[k] + im[k] * im[k];
+        }
+    }
+    stats->vib_samples += SPECTRUM_SIZE;
+    stats->windows++;
+}
+
+/**
+ * @brief Decodifica y resume un bloque.
+ *
+ * @param job Trabajo compartido.
+ * @param block Índice del bloque.
+ * @param values Buffer del hilo para los registros decodificados.
+ */
+static void analyze_block(StatsJob *job, uint32_t block, int32_t *values) {
+    const BblIndexEntry *entry = &job->reader->index[block];
+    FlightStats *stats = &job->blocks[block];
+    memset(stats, 0, sizeof(*stats));
+    stats->session = entry->session;
+    stats->period_min = UINT32_MAX;
+
+    uint32_t n = bbl_decode_block(job->reader, block, values);
+    stats->records = n;
+    stats->damaged = entry->records - n;
+
+    // El primer periodo empieza en el último registro del bloque anterior de la misma sesión
+    uint32_t prev = 0;
+    bool have_prev = false;
+    if (block > 0 && job->reader->index[block - 1].session == entry->session) {
+        prev = job->reader->index[block - 1].last_timestamp_us;
+        have_prev = true;
+    }
+    // Cada ventana del espectro sale de un tramo sin pausas: una pausa empieza otro tramo
+    uint32_t run_start = 0;
+    for (uint32_t r = 0; r < n; r++) {
+        const int32_t *v = &values[(size_t)r * BLACKBOX_FIELDS];
+        uint32_t now = (uint32_t)v[BB_TIMESTAMP_US];
+        if (have_prev) {
+            uint32_t period = now - prev;
+            if (period > PAUSE_US) {
+                stats->pauses++;
+                run_start = r;
+            } else {
+                stats->periods++;
+                stats->period_sum += period;
+                stats->period_sq += (double)period * period;
+                stats->period_min = period < stats->period_min ? period : stats->period_min;
+                stats->period_max = period > stats->period_max ? period : stats->period_max;
+            }
+        }
+        prev = now;
+        have_prev = true;
+
+        if (abs(v[BB_OUTPUT_PITCH_MILLI]) >= job->output_limit_milli ||
+            abs(v[BB_OUTPUT_ROLL_MILLI]) >= job->output_limit_milli) {
+            stats->saturated++;
+        }
+        double pitch = v[BB_FILTERED_CDEG] / 100.0;
+        stats->pitch_sq += pitch * pitch;
+
+        if (r + 1 - run_start == SPECTRUM_SIZE) {
+            add_window(stats, &values[(size_t)run_start * BLACKBOX_FIELDS]);
+            run_start = r + 1;
+        }
+    }
+    stats->duration_us = stats->period_sum;
+}
+
+/**
+ * @brief Hilo de análisis: toma bloques sin repartir hasta que no queda ninguno.
+ *
+ * @param arg Trabajo compartido (StatsJob).
+ * @return NULL.
+ */
+static void *stats_worker(void *arg) {
+    StatsJob *job = arg;
+    int32_t *values = malloc((size_t)BBL_BLOCK_RECORDS * BLACKBOX_FIELDS * sizeof(int32_t));
+    if (!values) {
+        atomic_store(&job->failed, true);
+        return NULL;
+    }
+    for (;;) {
+        uint32_t block = atomic_fetch_add(&job->next, 1);
+        if (block >= job->reader->block_count) {
+            break;
+        }
+        if (job->selected[block]) {
+            analyze_block(job, block, values);
+        }
+    }
+    free(values);
+    return NULL;
+}
+
+/**
+ * @brief Suma el resumen de un bloque al de su sesión.
+ *
+ * @param total Resumen de la sesión.
+ * @param part Resumen del bloque.
+ */
+static void merge_stats(FlightStats *total, const FlightStats *part) {
+    total->records += part->records;
+    total->damaged += part->damaged;
+    total->periods += part->periods;
+    total->period_sum += part->period_sum;
+    total->period_sq += part->period_sq;
+    total->period_min = part->period_min < total->period_min ? part->period_min : total->period_min;
+    total->period_max = part->period_max > total->period_max ? part->period_max : total->period_max;
+    total->pauses += part->pauses;
+    total->duration_us += part->duration_us;
+    total->saturated += part->saturated;
+    total->pitch_sq += part->pitch_sq;
+    total->vib_samples += part->vib_samples;
+    total->windows += part->windows;
+    for (int axis = 0; axis < 3; axis++) {
+        total->vib_sq[axis] += part->vib_sq[axis];
+        for (uint32_t k = 0; k < SPECTRUM_BINS; k++) {
+            total->power[axis][k] += part->power[axis][k];
+        }
+    }
+}
+
+/**
+ * @brief Escribe el resumen de una sesión y, si se pide, su espectro.
+ *
+ * @param stats Resumen de la sesión.
+ * @param spectrum Fichero CSV del espectro (puede ser NULL).
+ */
+static void print_session(const FlightStats *stats, FILE *spectrum) {
+    printf("sesión %lu: %llu registros, %.1f s", (unsigned long)stats->session, (unsigned long long)stats->records,
+           stats->duration_us / 1e6);
+    if (stats->damaged) {
+        printf(", %llu registros dañados", (unsigned long long)stats->damaged);
+    }
+    printf("\n");
+    if (stats->records == 0) {
+        return;
+    }
+
+    double rate_hz = 0.0;
+    if (stats->periods > 0) {
+        double mean = stats->period_sum / stats->periods;
+        double var = stats->period_sq / stats->periods - mean * mean;
+        rate_hz = 1e6 / mean;
+        printf("  periodo del lazo: media %.1f us (%.1f Hz), desviación %.1f us, mínimo %lu us, máximo %lu us, "
+               "pausas %llu\n", mean, rate_hz, sqrt(var > 0.0 ? var : 0.0), (unsigned long)stats->period_min,
+               (unsigned long)stats->period_max, (unsigned long long)stats->pauses);
+    }
+    printf("  saturación: %.2f %% de los registros\n", 100.0 * stats->saturated / stats->records);
+    printf("  error de pitch RMS: %.3f grados\n", sqrt(stats->pitch_sq / stats->records));
+
+    if (stats->windows == 0) {
+        printf("  vibración: menos de %d registros seguidos, sin espectro\n", SPECTRUM_SIZE);
+        return;
+    }
+
+    // Pico del espectro sumado de los tres ejes, sin la componente continua
+    uint32_t peak = 1;
+    double peak_power = 0.0;
+    for (uint32_t k = 1; k < SPECTRUM_BINS; k++) {
+        double p = stats->power[0][k] + stats->power[1][k] + stats->power[2][k];
+        if (p > peak_power) {
+            peak_power = p;
+            peak = k;
+        }
+    }
+    double bin_hz = rate_hz / SPECTRUM_SIZE;
+    printf("  vibración RMS (cuentas): x %.2f, y %.2f, z %.2f; pico del espectro en %.2f Hz\n",
+           sqrt(stats->vib_sq[0] / stats->vib_samples), sqrt(stats->vib_sq[1] / stats->vib_samples),
+           sqrt(stats->vib_sq[2] / stats->vib_samples), peak * bin_hz);
+
+    if (spectrum) {
+        // Densidad espectral de un lado con la normalización de la ventana de Hann (suma de w² = 3N/8)
+        double scale = 2.0 / (stats->windows * (3.0 * SPECTRUM_SIZE / 8.0) * (rate_hz > 0.0 ? rate_hz : 1.0));
+        for (uint32_t k = 0; k < SPECTRUM_BINS; k++) {
+            fprintf(spectrum, "%lu,%.4f,%.6g,%.6g,%.6g\n", (unsigned long)stats->session, k * bin_hz,
+                    stats->power[0][k] * scale, stats->power[1][k] * scale, stats->power[2][k] * scale);
+        }
+    }
+}
+
+/**
+ * @brief Resume el contenedor solo con el índice, sin decodificar bloques.
+ *
+ * @param reader Contenedor.
+ * @param selected Bloques a incluir.
+ */
+static void print_index(const BblReader *reader, const bool *selected) {
+    printf("session,blocks,records,first_timestamp_us,last_timestamp_us,pitch_min,pitch_max,"
+           "output_pitch_min,output_pitch_max,wing_right_min,wing_right_max,wing_left_min,wing_left_max\n");
+    uint32_t b = 0;
+    while (b < reader->block_count) {
+        if (!selected[b]) {
+            b++;
+            continue;
+        }
+        BblIndexEntry total = reader->index[b];
+        uint32_t blocks = 1;
+        for (b++; b < reader->block_count && reader->index[b].session == total.session; b++, blocks++) {
+            const BblIndexEntry *e = &reader->index[b];
+            total.records += e->records;
+            total.last_timestamp_us = e->last_timestamp_us;
+            for (uint32_t i = 0; i < BLACKBOX_FIELDS; i++) {
+                total.min[i] = e->min[i] < total.min[i] ? e->min[i] : total.min[i];
+                total.max[i] = e->max[i] > total.max[i] ? e->max[i] : total.max[i];
+            }
+        }
+        printf("%lu,%lu,%lu,%lu,%lu,%.2f,%.2f,%.3f,%.3f,%ld,%ld,%ld,%ld\n", (unsigned long)total.session,
+               (unsigned long)blocks, (unsigned long)total.records, (unsigned long)total.first_timestamp_us,
+               (unsigned long)total.last_timestamp_us, total.min[BB_FILTERED_CDEG] / 100.0,
+               total.max[BB_FILTERED_CDEG] / 100.0, total.min[BB_OUTPUT_PITCH_MILLI] / 1000.0,
+               total.max[BB_OUTPUT_PITCH_MILLI] / 1000.0, (long)total.min[BB_WING_RIGHT_US],
+               (long)total.max[BB_WING_RIGHT_US], (long)total.min[BB_WING_LEFT_US], (long)total.max[BB_WING_LEFT_US]);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *input = NULL;
+    const char *spectrum_path = NULL;
+    long session = -1;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    double output_limit = DEFAULT_OUTPUT_LIMIT;
+    bool index_only = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            session = strtol(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = strtol(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-L") == 0 && i + 1 < argc) {
+            output_limit = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            spectrum_path = argv[++i];
+        } else if (strcmp(argv[i], "-i") == 0) {
+            index_only = true;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            input = NULL;
+            break;
+        } else {
+            input = argv[i];
+        }
+    }
+    if (!input) {
+        fprintf(stderr, "uso: %s [-i] [-S sesión] [-L límite] [-j hilos] [-s espectro.csv] vuelos.bbl\n", argv[0]);
+        return 1;
+    }
+    threads = threads < 1 ? 1 : threads;
+
+    BblReader reader;
+    if (!bbl_reader_open(&reader, input)) {
+        return 1;
+    }
+
+    // El índice basta para descartar los bloques de otras sesiones
+    bool *selected = malloc((reader.block_count ? reader.block_count : 1) * sizeof(bool));
+    if (!selected) {
+        perror("malloc");
+        bbl_reader_close(&reader);
+        return 1;
+    }
+    for (uint32_t b = 0; b < reader.block_count; b++) {
+        selected[b] = session < 0 || reader.index[b].session == (uint32_t)session;
+    }
+    if (index_only) {
+        print_index(&reader, selected);
+        free(selected);
+        bbl_reader_close(&reader);
+        return 0;
+    }
+
+    StatsJob job = {
+        .reader = &reader,
+        .selected = selected,
+        .blocks = calloc(reader.block_count ? reader.block_count : 1, sizeof(FlightStats)),
+        .output_limit_milli = (int32_t)(output_limit * 1000.0) - 1,
+    };
+    atomic_init(&job.next, 0);
+    atomic_init(&job.failed, false);
+    pthread_t *workers = malloc((size_t)threads * sizeof(pthread_t));
+    if (!job.blocks || !workers) {
+        perror("malloc");
+        free(workers);
+        free(job.blocks);
+        free(selected);
+        bbl_reader_close(&reader);
+        return 1;
+    }
+    long started = 0;
+    for (; started < threads; started++) {
+        int err = pthread_create(&workers[started], NULL, stats_worker, &job);
+        if (err) {
+            fprintf(stderr, "pthread_create: %s\n", strerror(err));
+            atomic_store(&job.failed, true);
+            break;
+        }
+    }
+    // Los hilos ya lanzados terminan antes de liberar el trabajo que comparten
+    for (long t = 0; t < started; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    if (atomic_load(&job.failed)) {
+        if (started == threads) {
+            fprintf(stderr, "%s: sin memoria para analizar los bloques\n", input);
+        }
+        free(workers);
+        free(job.blocks);
+        free(selected);
+        bbl_reader_close(&reader);
+        return 1;
+    }
+
+    FILE *spectrum = NULL;
+    if (spectrum_path) {
+        spectrum = fopen(spectrum_path, "w");
+        if (!spectrum) {
+            perror(spectrum_path);
+            return 1;
+        }
+        fprintf(spectrum, "session,freq_hz,psd_x,psd_y,psd_z\n");
+    }
+
+    // Los bloques de una sesión van seguidos en el fichero
+    uint32_t b = 0;
+    while (b < reader.block_count) {
+        if (!selected[b]) {
+            b++;
+            continue;
+        }
+        static FlightStats total;
+        memset(&total, 0, sizeof(total));
+        total.session = reader.index[b].session;
+        total.period_min = UINT32_MAX;
+        for (; b < reader.block_count && selected[b] && reader.index[b].session == total.session; b++) {
+            merge_stats(&total, &job.blocks[b]);
+        }
+        print_session(&total, spectrum);
+    }
+
+    if (spectrum) {
+        fclose(spectrum);
+    }
+    free(workers);
+    free(job.blocks);
+    free(selected);
+    bbl_reader_close(&reader);
+    return 0;
+}
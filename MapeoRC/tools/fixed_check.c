@@ -0,0 +1,224 @@
+/**
+ * @file fixed_check.c
+ * @brief Comprobación en el PC de la tolerancia del filtro y el PID en punto fijo.
+ *
+ * Repite un mismo conjunto de casos aleatorios (semilla fija) con el filtro de
+ * Kalman y los PID de control_pid.c. Compilado en float guarda las salidas de cada
+ * paso como referencia; compilado con CONTROL_FIXED_POINT las compara con las de
+ * control_fixed.c y termina con 1 si alguna pasa de la tolerancia documentada en
+ * control_fixed.c:
+ *
+ *     cc -O2 -DCONTROL_PID_HOST=1 -o fixed_check_float fixed_check.c ../control_pid.c ../fast_math.c -lm
+ *     cc -O2 -DCONTROL_PID_HOST=1 -DCONTROL_FIXED_POINT=1 -o fixed_check_q16 fixed_check.c \
+ *         ../control_pid.c ../control_fixed.c ../fast_math.c -lm
+ *     ./fixed_check_float -w float.ref && ./fixed_check_q16 -c float.ref
+ *
+ * Cada caso sortea q, r, las ganancias, dt y una trayectoria del pitch dentro de los
+ * rangos de la tolerancia y pasa cada medida por kalman_update() (con y sin
+ * ganancia estacionaria), por kalman_correct() (con y sin ganancia estacionaria al
+ * periodo nominal, con algún intervalo triple) y por pid_controller_update(). Los
+ * pasos en que algún término del PID en float sale del rango de Q16.16 quedan
+ * marcados en la referencia y no cuentan para la salida del PID, como admite la
+ * tolerancia.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../control_pid.h"
+
+#define CHECK_CASES 2000        ///< Casos por ejecución
+#define CHECK_STEPS 200         ///< Pasos por caso
+#define CHECK_SEED 0x2545F491u  ///< Semilla de los casos: la misma en las dos compilaciones
+#define Q16_RANGE 32768.0f      ///< Mayor magnitud representable en Q16.16
+#define FILTER_TOLERANCE 0.04f  ///< Diferencia máxima del estado del filtro, grados
+#define OUTPUT_TOLERANCE 0.05f  ///< Diferencia máxima absoluta de la salida del PID
+#define OUTPUT_RELATIVE 0.001f  ///< Diferencia máxima relativa de la salida del PID
+
+// Salidas de cada paso
+enum { OUT_UPDATE, OUT_TIMED, OUT_STEADY, OUT_TIMED_STEADY, OUT_PID, OUT_SATURATED, OUT_COUNT };
+
+static const char *const out_name[OUT_SATURATED] = {
+    "kalman_update", "kalman_correct", "ganancia estacionaria", "correct estacionario", "pid_controller_update",
+};
+
+/**
+ * @brief Parámetros de un caso.
+ */
+typedef struct {
+    float q, r;                 ///< Variancias del filtro de Kalman
+    float kp, ki, kd;           ///< Ganancias del PID
+    float dt;                   ///< Periodo de cada paso, segundos
+} CheckCase;
+
+/**
+ * @brief Generador xorshift32: la misma secuencia en cualquier compilación.
+ *
+ * @param state Estado del generador.
+ * @return Valor uniforme en [0, 1).
+ */
+static float check_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (x >> 8) * (1.0f / 16777216.0f);
+}
+
+/**
+ * @brief Valor uniforme en un intervalo.
+ *
+ * @param state Estado del generador.
+ * @param lo Límite inferior.
+ * @param hi Límite superior.
+ * @return Valor en [lo, hi).
+ */
+static float check_uniform(uint32_t *state, float lo, float hi) {
+    return lo + (hi - lo) * check_random(state);
+}
+
+/**
+ * @brief Indica si un término del PID en float no cabe en Q16.16.
+ *
+ * @param v Valor del término.
+ * @return Verdadero si satura en punto fijo.
+ */
+static bool check_saturates(float v) {
+    return v >= Q16_RANGE || v <= -Q16_RANGE;
+}
+
+/**
+ * @brief Repite un caso y guarda las salidas de cada paso.
+ *
+ * @param c Parámetros del caso.
+ * @param rng Estado del generador para la trayectoria del pitch.
+ * @param out Salidas, CHECK_STEPS filas de OUT_COUNT valores.
+ */
+static void check_run(const CheckCase *c, uint32_t *rng, float *out) {
+    KalmanFilter update, timed, steady, timed_steady;
+    PIDController pid;
+    uint32_t dt_us = (uint32_t)(c->dt * 1e6f);
+    kalman_init(&update, c->q, c->r, 0.0f);
+    kalman_init(&timed, c->q, c->r, 0.0f);
+    kalman_init_steady(&steady, c->q, c->r, 0.0f, 0);
+    kalman_init_steady(&timed_steady, c->q, c->r, 0.0f, dt_us);
+    pid_controller_init(&pid, c->kp, c->ki, c->kd, 0.0f);
+
+    float pitch = check_uniform(rng, -90.0f, 90.0f);
+    uint32_t timestamp_us = 0;
+    float previous_error = 0.0f, integral = 0.0f;
+    for (int step = 0; step < CHECK_STEPS; step++) {
+        // Pitch que deriva dentro de [-90, 90] con ruido de medida del acelerómetro
+        pitch += check_uniform(rng, -2.0f, 2.0f);
+        pitch = MIN(MAX(pitch, -90.0f), 90.0f);
+        float measurement = MIN(MAX(pitch + check_uniform(rng, -1.0f, 1.0f), -90.0f), 90.0f);
+        // Una de cada diez medidas llega tras un intervalo triple del nominal
+        timestamp_us += check_random(rng) < 0.1f ? 3 * dt_us : dt_us;
+
+        float *row = &out[step * OUT_COUNT];
+        row[OUT_UPDATE] = kalman_update(&update, measurement);
+        kalman_correct(&timed, measurement, timestamp_us);
+        row[OUT_TIMED] = kalman_estimate(&timed);
+        row[OUT_STEADY] = kalman_update(&steady, measurement);
+        kalman_correct(&timed_steady, measurement, timestamp_us);
+        row[OUT_TIMED_STEADY] = kalman_estimate(&timed_steady);
+
+        // Términos del PID tal como los calcula la versión en float
+        float error = -row[OUT_UPDATE];
+        integral += error * c->dt;
+        float derivative = (error - previous_error) / c->dt;
+        previous_error = error;
+        row[OUT_SATURATED] = check_saturates(integral) || check_saturates(derivative) ||
+                             check_saturates(c->kp * error) || check_saturates(c->ki * integral) ||
+                             check_saturates(c->kd * derivative);
+        row[OUT_PID] = pid_controller_update(&pid, row[OUT_UPDATE], c->dt);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *write_path = NULL;
+    const char *check_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            write_path = argv[++i];
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            check_path = argv[++i];
+        } else {
+            write_path = check_path = NULL;
+            break;
+        }
+    }
+    if (CONTROL_FIXED_POINT ? !check_path || write_path : !write_path || check_path) {
+        fprintf(stderr, "uso: %s %s\n", argv[0], CONTROL_FIXED_POINT ? "-c referencia" : "-w referencia");
+        return 2;
+    }
+
+    FILE *file = fopen(CONTROL_FIXED_POINT ? check_path : write_path, CONTROL_FIXED_POINT ? "rb" : "wb");
+    if (!file) {
+        perror(CONTROL_FIXED_POINT ? check_path : write_path);
+        return 2;
+    }
+
+    static float out[CHECK_STEPS * OUT_COUNT], reference[CHECK_STEPS * OUT_COUNT];
+    float max_diff[OUT_SATURATED] = {0};
+    unsigned long over[OUT_SATURATED] = {0};
+    unsigned long saturated = 0;
+    uint32_t rng = CHECK_SEED;
+    for (int n = 0; n < CHECK_CASES; n++) {
+        CheckCase c;
+        c.q = check_uniform(&rng, 0.001f, 0.1f);
+        c.r = check_uniform(&rng, 0.01f, 1.0f);
+        c.kp = check_uniform(&rng, 0.0f, 5.0f);
+        c.ki = check_uniform(&rng, 0.0f, 1.0f);
+        c.kd = check_uniform(&rng, 0.0f, 0.5f);
+        c.dt = check_uniform(&rng, 0.001f, 0.1f);
+        check_run(&c, &rng, out);
+
+        if (!CONTROL_FIXED_POINT) {
+            if (fwrite(out, sizeof(out), 1, file) != 1) {
+                perror(write_path);
+                return 2;
+            }
+            continue;
+        }
+        if (fread(reference, sizeof(reference), 1, file) != 1) {
+            fprintf(stderr, "%s: faltan casos\n", check_path);
+            return 2;
+        }
+        for (int step = 0; step < CHECK_STEPS; step++) {
+            const float *row = &out[step * OUT_COUNT];
+            const float *ref = &reference[step * OUT_COUNT];
+            for (int k = 0; k < OUT_SATURATED; k++) {
+                if (k == OUT_PID && ref[OUT_SATURATED] != 0.0f) {
+                    saturated++;
+                    continue;
+                }
+                float diff = fabsf(row[k] - ref[k]);
+                float tolerance = k == OUT_PID ? OUTPUT_TOLERANCE + OUTPUT_RELATIVE * fabsf(ref[k]) : FILTER_TOLERANCE;
+                max_diff[k] = MAX(max_diff[k], diff);
+                if (diff > tolerance) {
+                    if (!over[k]) {
+                        fprintf(stderr, "%s: caso %d, paso %d: %.5f frente a %.5f\n", out_name[k], n, step,
+                                row[k], ref[k]);
+                    }
+                    over[k]++;
+                }
+            }
+        }
+    }
+    fclose(file);
+    if (!CONTROL_FIXED_POINT) {
+        printf("%d casos de %d pasos guardados en %s\n", CHECK_CASES, CHECK_STEPS, write_path);
+        return 0;
+    }
+
+    bool failed = false;
+    printf("%d casos de %d pasos; pasos del PID con términos fuera de Q16.16: %lu\n", CHECK_CASES, CHECK_STEPS,
+           saturated);
+    for (int k = 0; k < OUT_SATURATED; k++) {
+        printf("  %-23s máx. %.5f, por encima de la tolerancia: %lu\n", out_name[k], max_diff[k], over[k]);
+        failed |= over[k] > 0;
+    }
+    return failed ? 1 : 0;
+}
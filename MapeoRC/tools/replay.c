@@ -0,0 +1,349 @@
+/**
+ * @file replay.c
+ * @brief Repetición en el PC de vuelos grabados con el filtro y el PID del firmware.
+ *
+ * Compila control_pid.c para el PC (CONTROL_PID_HOST, sin el código del sensor) y
+ * pasa cada registro de un contenedor (blackbox_log.h) por el mismo camino que el
+ * lazo de control con ATTITUDE_ESTIMATOR ACCEL: calculate_pitch(), kalman_correct()
+ * con la ganancia estacionaria al periodo del lazo y pid_bank_update(). Compara el
+ * pitch, el pitch filtrado y la salida de cada registro con los grabados, o con otro
+ * contenedor de referencia, y termina con 1 si alguno se aparta más de la tolerancia:
+ *
+ *     cc -O2 -DCONTROL_PID_HOST=1 -o replay replay.c blackbox_log.c ../control_pid.c ../fast_math.c -lm
+ *     ./replay -q 0.5 -r 0.2 -w nuevo.bbl vuelos.bbl      # ajuste nuevo, guardado como referencia
+ *     ./replay -q 0.5 -r 0.2 -g nuevo.bbl vuelos.bbl      # regresión contra esa referencia
+ *
+ * Con -DCONTROL_FIXED_POINT=1 y ../control_fixed.c se repite con el filtro en punto
+ * fijo. -p legacy usa en su lugar kalman_update() y pid_controller_update(), sin
+ * límite de salida.
+ *
+ * Cada sesión empieza con el filtro y el PID recién iniciados, como al arrancar. En
+ * una pausa de más de PAUSE_US (fuera de estabilización el lazo no corre) el paso
+ * siguiente usa el periodo anterior; el primero de la sesión, el de -f. Las ganancias
+ * y la frecuencia por defecto son las de RCmapeo.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "blackbox_log.h"
+#include "../control_pid.h"
+
+#define PAUSE_US 1000000u       ///< Hueco entre registros que no cuenta como paso del lazo
+#define PITCH_OFFSET 3.0f       ///< Corrección que el lazo suma al pitch del acelerómetro
+#define DEFAULT_KALMAN_Q 1.0f   ///< PITCH_KALMAN_Q
+#define DEFAULT_KALMAN_R 0.1f   ///< PITCH_KALMAN_R
+#define DEFAULT_KP 1.0f         ///< PID_KP
+#define DEFAULT_KI 0.1f         ///< PID_KI
+#define DEFAULT_KD 0.05f        ///< PID_KD
+#define DEFAULT_LIMIT 15.0f     ///< PID_OUTPUT_LIMIT
+#define DEFAULT_RATE_HZ 100.0f  ///< RATE_CONTROL_HZ
+
+// Campos comparados
+enum { CMP_PITCH, CMP_FILTERED, CMP_OUTPUT, CMP_COUNT };
+
+/**
+ * @brief Parámetros de la repetición.
+ */
+typedef struct {
+    float q, r;                 ///< Variancias del filtro de Kalman
+    float kp, ki, kd;           ///< Ganancias del PID
+    float limit;                ///< Límite de la salida del PID
+    float rate_hz;              ///< Frecuencia del lazo: da el periodo del primer paso de cada sesión
+    bool legacy;                ///< kalman_update() y pid_controller_update() en lugar del lazo actual
+} ReplayConfig;
+
+/**
+ * @brief Estado del lazo repetido en la sesión en curso.
+ */
+typedef struct {
+    KalmanFilter kalman;        ///< Filtro del pitch
+    PIDBank bank;               ///< PID del lazo actual
+    PIDController legacy;       ///< PID original
+    int axis;                   ///< Eje de pitch en la banca
+    bool have_time;             ///< Ya hubo un registro en la sesión
+    uint32_t last_timestamp_us; ///< Instante del registro anterior
+    float dt;                   ///< Último periodo del lazo
+    float filtered;             ///< Último pitch filtrado
+} ReplayState;
+
+/**
+ * @brief Recorrido secuencial de los registros de un contenedor.
+ */
+typedef struct {
+    const BblReader *reader;    ///< Contenedor
+    uint32_t block;             ///< Siguiente bloque a decodificar
+    uint32_t count;             ///< Registros del bloque decodificado
+    uint32_t pos;               ///< Siguiente registro del bloque
+    int32_t *values;            ///< Registros del bloque decodificado
+} RecordCursor;
+
+/**
+ * @brief Diferencias acumuladas de un campo comparado.
+ */
+typedef struct {
+    double max_diff;            ///< Mayor diferencia absoluta
+    double sum_sq;              ///< Suma de los cuadrados
+    uint64_t over;              ///< Registros por encima de la tolerancia
+} DiffStats;
+
+/**
+ * @brief Prepara el recorrido de un contenedor.
+ *
+ * @param cursor Recorrido.
+ * @param reader Contenedor.
+ * @return Falso si no hay memoria.
+ */
+static bool cursor_init(RecordCursor *cursor, const BblReader *reader) {
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->reader = reader;
+    cursor->values = malloc((size_t)BBL_BLOCK_RECORDS * BLACKBOX_FIELDS * sizeof(int32_t));
+    return cursor->values != NULL;
+}
+
+/**
+ * @brief Siguiente registro del contenedor.
+ *
+ * @param cursor Recorrido.
+ * @param session Sesión del registro.
+ * @return Campos del registro, o NULL al terminar.
+ */
+static const int32_t *cursor_next(RecordCursor *cursor, uint32_t *session) {
+    while (cursor->pos == cursor->count) {
+        if (cursor->block == cursor->reader->block_count) {
+            return NULL;
+        }
+        cursor->count = bbl_decode_block(cursor->reader, cursor->block, cursor->values);
+        cursor->pos = 0;
+        cursor->block++;
+    }
+    *session = cursor->reader->index[cursor->block - 1].session;
+    return &cursor->values[(size_t)cursor->pos++ * BLACKBOX_FIELDS];
+}
+
+/**
+ * @brief Inicia el filtro y el PID como al arrancar el firmware.
+ *
+ * @param state Estado del lazo.
+ * @param config Parámetros.
+ */
+static void replay_reset(ReplayState *state, const ReplayConfig *config) {
+    memset(state, 0, sizeof(*state));
+    if (config->legacy) {
+        kalman_init(&state->kalman, config->q, config->r, 0);
+    } else {
+        kalman_init_steady(&state->kalman, config->q, config->r, 0, (uint32_t)(1e6f / config->rate_hz));
+    }
+    pid_bank_init(&state->bank);
+    state->axis = pid_bank_add_axis(&state->bank, config->kp, config->ki, config->kd, -config->limit, config->limit);
+    pid_controller_init(&state->legacy, config->kp, config->ki, config->kd, 0.0f);
+    state->dt = 1.0f / config->rate_hz;
+}
+
+/**
+ * @brief Repite un paso del lazo con un registro grabado.
+ *
+ * @param state Estado del lazo.
+ * @param config Parámetros.
+ * @param in Registro grabado.
+ * @param out Registro con el pitch, el pitch filtrado, los términos y la salida repetidos.
+ */
+static void replay_step(ReplayState *state, const ReplayConfig *config, const int32_t *in, int32_t *out) {
+    memcpy(out, in, BLACKBOX_FIELDS * sizeof(int32_t));
+    uint32_t now = (uint32_t)in[BB_TIMESTAMP_US];
+    if (state->have_time && now - state->last_timestamp_us <= PAUSE_US) {
+        state->dt = (now - state->last_timestamp_us) * 1e-6f;
+    }
+    state->have_time = true;
+    state->last_timestamp_us = now;
+    float dt = state->dt;
+
+    float pitch;
+    calculate_pitch(in[BB_ACCEL_X], in[BB_ACCEL_Y], in[BB_ACCEL_Z], &pitch);
+    float output;
+    if (config->legacy) {
+        state->filtered = kalman_update(&state->kalman, pitch + PITCH_OFFSET);
+        output = pid_controller_update(&state->legacy, state->filtered, dt);
+        out[BB_P_TERM_MILLI] = 0;
+        out[BB_I_TERM_MILLI] = 0;
+        out[BB_D_TERM_MILLI] = 0;
+    } else {
+        if (kalman_correct(&state->kalman, pitch + PITCH_OFFSET, now)) {
+            state->filtered = kalman_estimate(&state->kalman);
+        }
+        float measured[PID_BANK_MAX_AXES];
+        measured[state->axis] = state->filtered;
+        pid_bank_update(&state->bank, measured, dt);
+        output = state->bank.output[state->axis];
+
+        // Mismas escalas que control_record() en el firmware
+        const PIDBank *bank = &state->bank;
+        int axis = state->axis;
+        out[BB_P_TERM_MILLI] = (int32_t)(bank->kp[axis] * bank->previous_error[axis] * 1000.0f);
+        out[BB_I_TERM_MILLI] = (int32_t)(bank->ki[axis] * bank->integral[axis] * 1000.0f);
+        out[BB_D_TERM_MILLI] = (int32_t)(bank->kd[axis] * bank->derivative[axis] * 1000.0f);
+    }
+    out[BB_PITCH_CDEG] = (int32_t)(pitch * 100.0f);
+    out[BB_FILTERED_CDEG] = (int32_t)(state->filtered * 100.0f);
+    out[BB_OUTPUT_PITCH_MILLI] = (int32_t)(output * 1000.0f);
+}
+
+/**
+ * @brief Acumula la diferencia de un campo y cuenta si pasa de la tolerancia.
+ *
+ * @param stats Diferencias del campo.
+ * @param diff Diferencia del registro.
+ * @param tolerance Tolerancia, en las unidades del campo.
+ * @return Verdadero si pasa de la tolerancia.
+ */
+static bool diff_add(DiffStats *stats, double diff, double tolerance) {
+    double d = diff < 0.0 ? -diff : diff;
+    stats->max_diff = d > stats->max_diff ? d : stats->max_diff;
+    stats->sum_sq += d * d;
+    if (d > tolerance) {
+        stats->over++;
+        return true;
+    }
+    return false;
+}
+
+int main(int argc, char **argv) {
+    ReplayConfig config = {
+        .q = DEFAULT_KALMAN_Q, .r = DEFAULT_KALMAN_R,
+        .kp = DEFAULT_KP, .ki = DEFAULT_KI, .kd = DEFAULT_KD,
+        .limit = DEFAULT_LIMIT,
+        .rate_hz = DEFAULT_RATE_HZ,
+    };
+    const char *input = NULL;
+    const char *golden_path = NULL;
+    const char *output_path = NULL;
+    double tolerance = 1.0;
+    long session = -1;
+    bool usage = argc < 2;
+    for (int i = 1; i < argc && !usage; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "-q") == 0 && has_value) {
+            config.q = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "-r") == 0 && has_value) {
+            config.r = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "-P") == 0 && has_value) {
+            config.kp = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "-I") == 0 && has_value) {
+            config.ki = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "-D") == 0 && has_value) {
+            config.kd = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "-L") == 0 && has_value) {
+            config.limit = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "-f") == 0 && has_value) {
+            config.rate_hz = strtof(argv[++i], NULL);
+        } else if (strcmp(argv[i], "-p") == 0 && has_value) {
+            config.legacy = strcmp(argv[++i], "legacy") == 0;
+        } else if (strcmp(argv[i], "-t") == 0 && has_value) {
+            tolerance = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "-S") == 0 && has_value) {
+            session = strtol(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-g") == 0 && has_value) {
+            golden_path = argv[++i];
+        } else if (strcmp(argv[i], "-w") == 0 && has_value) {
+            output_path = argv[++i];
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            usage = true;
+        } else {
+            input = argv[i];
+        }
+    }
+    if (usage || !input) {
+        fprintf(stderr, "uso: %s [-q Q] [-r R] [-P kp] [-I ki] [-D kd] [-L límite] [-f Hz] [-p legacy]\n"
+                        "       [-S sesión] [-t tolerancia] [-g referencia.bbl] [-w salida.bbl] vuelos.bbl\n", argv[0]);
+        return 2;
+    }
+
+    BblReader reader, golden;
+    RecordCursor cursor, golden_cursor;
+    if (!bbl_reader_open(&reader, input) || !cursor_init(&cursor, &reader)) {
+        return 2;
+    }
+    if (golden_path && (!bbl_reader_open(&golden, golden_path) || !cursor_init(&golden_cursor, &golden))) {
+        return 2;
+    }
+    BblWriter writer;
+    if (output_path && !bbl_writer_open(&writer, output_path)) {
+        return 2;
+    }
+
+    // Diferencias en las unidades del registro: centésimas de grado y milésimas de salida
+    static const int cmp_field[CMP_COUNT] = {BB_PITCH_CDEG, BB_FILTERED_CDEG, BB_OUTPUT_PITCH_MILLI};
+    static const char *const cmp_name[CMP_COUNT] = {"pitch", "pitch filtrado", "salida"};
+    DiffStats diffs[CMP_COUNT] = {{0}};
+    ReplayState state;
+    bool have_session = false;
+    uint32_t current = 0;
+    uint64_t records = 0, sessions = 0;
+    bool reported = false;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    const int32_t *in;
+    uint32_t in_session;
+    while ((in = cursor_next(&cursor, &in_session)) != NULL) {
+        const int32_t *reference = in;
+        if (golden_path) {
+            uint32_t golden_session;
+            reference = cursor_next(&golden_cursor, &golden_session);
+            if (!reference) {
+                fprintf(stderr, "%s: se acaba antes que %s\n", golden_path, input);
+                return 1;
+            }
+        }
+        if (session >= 0 && in_session != (uint32_t)session) {
+            continue;
+        }
+        if (!have_session || in_session != current) {
+            replay_reset(&state, &config);
+            have_session = true;
+            current = in_session;
+            sessions++;
+        }
+
+        int32_t out[BLACKBOX_FIELDS];
+        replay_step(&state, &config, in, out);
+        records++;
+        bool over = false;
+        for (int c = 0; c < CMP_COUNT; c++) {
+            over |= diff_add(&diffs[c], (double)out[cmp_field[c]] - reference[cmp_field[c]], tolerance);
+        }
+        if (over && !reported) {
+            fprintf(stderr, "primera diferencia: sesión %lu, t = %lu us, registro %llu\n",
+                    (unsigned long)in_session, (unsigned long)(uint32_t)in[BB_TIMESTAMP_US],
+                    (unsigned long long)records);
+            reported = true;
+        }
+        if (output_path) {
+            bbl_writer_add(&writer, in_session, out);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    bool failed = false;
+    printf("registros: %llu en %llu sesiones (%.1f millones por segundo)\n", (unsigned long long)records,
+           (unsigned long long)sessions, seconds > 0.0 ? records / seconds / 1e6 : 0.0);
+    for (int c = 0; c < CMP_COUNT; c++) {
+        printf("  %-15s máx. %.0f, RMS %.3f, por encima de %.0f: %llu\n", cmp_name[c], diffs[c].max_diff,
+               records ? sqrt(diffs[c].sum_sq / records) : 0.0, tolerance, (unsigned long long)diffs[c].over);
+        failed |= diffs[c].over > 0;
+    }
+
+    if (output_path && !bbl_writer_close(&writer)) {
+        perror(output_path);
+        return 2;
+    }
+    free(cursor.values);
+    bbl_reader_close(&reader);
+    if (golden_path) {
+        free(golden_cursor.values);
+        bbl_reader_close(&golden);
+    }
+    return failed ? 1 : 0;
+}
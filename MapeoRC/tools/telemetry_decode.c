@@ -0,0 +1,509 @@
+/**
+ * @file telemetry_decode.c
+ * @brief Decodificador en el PC de las tramas binarias de telemetría.
+ *
+ * Lee el flujo del USB CDC (el puerto serie, un fichero capturado o la entrada
+ * estándar), busca las tramas, comprueba el CRC y escribe una fila CSV por trama,
+ * con una columna por campo:
+ *
+ *     cc -O2 -o telemetry_decode telemetry_decode.c blackbox_log.c
+ *     ./telemetry_decode -s estado.csv /dev/ttyACM0 > control.csv
+ *
+ * Las tramas de control van a la salida estándar y las de estado al fichero de -s
+ * (se descartan si no se indica). Los mensajes DLOG se rehacen con los formatos de
+ * la sección .dlog_fmt del ELF indicado con -e y van, uno por línea, al fichero de -l
+ * o a stderr:
+ *
+ *     ./telemetry_decode -e ../build/myblink_w.elf -l debug.log /dev/ttyACM0 > control.csv
+ *
+ * Con -o guarda además las tramas de control en el contenedor indexado de
+ * blackbox_log.h, para analizarlas con blackbox_stats. Cada pausa de más de
+ * FLIGHT_GAP_US sin tramas de control (fuera de estabilización no se envían) empieza
+ * una sesión nueva; los términos del PID, que la trama no lleva, quedan a cero:
+ *
+ *     ./telemetry_decode -o vuelos.bbl /dev/ttyACM0 > control.csv
+ *
+ * Al terminar resume en stderr las tramas leídas, los errores de CRC, las tramas
+ * perdidas según la secuencia y los bytes saltados (texto de printf o basura entre
+ * tramas).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <elf.h>
+#include "../telemetry_format.h"
+#include "blackbox_log.h"
+
+#define FRAME_MAX (TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_PAYLOAD + TELEMETRY_CRC_SIZE) ///< Mayor trama posible
+#define READ_CHUNK 4096 ///< Bytes pedidos en cada lectura
+#define FLIGHT_GAP_US 1000000 ///< Pausa entre tramas de control que separa dos sesiones del contenedor
+
+/**
+ * @brief Contadores del decodificador.
+ */
+typedef struct {
+    unsigned long frames;       ///< Tramas válidas
+    unsigned long crc_errors;   ///< Tramas con la sincronía correcta y el CRC mal
+    unsigned long lost;         ///< Tramas perdidas según los saltos de secuencia
+    unsigned long skipped;      ///< Bytes fuera de cualquier trama válida
+    unsigned long unknown;      ///< Tramas válidas de un tipo desconocido
+    bool have_seq;              ///< Ya se vio alguna secuencia
+    uint16_t last_seq;          ///< Última secuencia vista
+} DecodeStats;
+
+/**
+ * @brief Contenedor de salida de las tramas de control (opción -o).
+ */
+typedef struct {
+    BblWriter writer;           ///< Escritor del contenedor
+    uint32_t session;           ///< Sesión en curso
+    bool have_time;             ///< Ya se guardó alguna trama
+    uint32_t last_timestamp_us; ///< Instante de la última trama guardada
+} FlightLog;
+
+/**
+ * @brief Formatos de DLOG leídos del ELF.
+ */
+typedef struct {
+    char *data;         ///< Contenido de la sección .dlog_fmt (NULL sin ELF)
+    uint64_t addr;      ///< Dirección de la sección
+    uint64_t size;      ///< Tamaño de la sección
+} LogFormats;
+
+/**
+ * @brief Carga la sección .dlog_fmt de un ELF de 32 o 64 bits little-endian.
+ *
+ * @param path Ruta del ELF.
+ * @param formats Formatos cargados.
+ * @return Falso si el fichero no es un ELF válido o no tiene la sección.
+ */
+static bool load_formats(const char *path, LogFormats *formats) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char *elf = malloc(file_size > 0 ? (size_t)file_size : 1);
+    bool ok = elf && file_size > EI_NIDENT && fread(elf, 1, (size_t)file_size, f) == (size_t)file_size;
+    fclose(f);
+    if (!ok || memcmp(elf, ELFMAG, SELFMAG) != 0 || elf[EI_DATA] != ELFDATA2LSB) {
+        fprintf(stderr, "%s: no es un ELF little-endian\n", path);
+        free(elf);
+        return false;
+    }
+
+    // La cabecera entera de su clase debe caber en el fichero antes de leer sus campos
+    size_t header_size = elf[EI_CLASS] == ELFCLASS32   ? sizeof(Elf32_Ehdr)
+                         : elf[EI_CLASS] == ELFCLASS64 ? sizeof(Elf64_Ehdr)
+                                                       : 0;
+    if (header_size == 0 || (uint64_t)file_size < header_size) {
+        fprintf(stderr, "%s: cabecera ELF incompleta o de clase desconocida\n", path);
+        free(elf);
+        return false;
+    }
+
+    // Tabla de secciones y sección de nombres, en cualquiera de las dos clases
+    uint64_t shoff, sh_count, shstrndx, entsize;
+    if (elf[EI_CLASS] == ELFCLASS32) {
+        const Elf32_Ehdr *eh = (const Elf32_Ehdr *)elf;
+        shoff = eh->e_shoff; sh_count = eh->e_shnum; shstrndx = eh->e_shstrndx; entsize = sizeof(Elf32_Shdr);
+    } else {
+        const Elf64_Ehdr *eh = (const Elf64_Ehdr *)elf;
+        shoff = eh->e_shoff; sh_count = eh->e_shnum; shstrndx = eh->e_shstrndx; entsize = sizeof(Elf64_Shdr);
+    }
+    if (shoff + sh_count * entsize > (uint64_t)file_size || shstrndx >= sh_count) {
+        fprintf(stderr, "%s: tabla de secciones no válida\n", path);
+        free(elf);
+        return false;
+    }
+
+    uint64_t names = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint64_t i = 0; i < sh_count; i++) {
+            const unsigned char *sh = elf + shoff + i * entsize;
+            uint64_t name, addr, offset, size;
+            if (elf[EI_CLASS] == ELFCLASS32) {
+                const Elf32_Shdr *s32 = (const Elf32_Shdr *)sh;
+                name = s32->sh_name; addr = s32->sh_addr; offset = s32->sh_offset; size = s32->sh_size;
+            } else {
+                const Elf64_Shdr *s64 = (const Elf64_Shdr *)sh;
+                name = s64->sh_name; addr = s64->sh_addr; offset = s64->sh_offset; size = s64->sh_size;
+            }
+            if (offset + size > (uint64_t)file_size) {
+                continue;
+            }
+            if (pass == 0 && i == shstrndx) {
+                names = offset;
+            } else if (pass == 1 && names + name < (uint64_t)file_size &&
+                       strcmp((const char *)elf + names + name, ".dlog_fmt") == 0) {
+                formats->data = malloc(size + 1);
+                memcpy(formats->data, elf + offset, size);
+                formats->data[size] = '\0';
+                formats->addr = addr;
+                formats->size = size;
+                free(elf);
+                return true;
+            }
+        }
+    }
+    fprintf(stderr, "%s: no tiene la sección .dlog_fmt\n", path);
+    free(elf);
+    return false;
+}
+
+/**
+ * @brief Rehace el texto de un mensaje DLOG con su formato y sus argumentos.
+ *
+ * Los modificadores de longitud (l, h...) se ignoran: cada argumento es una palabra
+ * de 32 bits y la conversión decide si es entero o float.
+ *
+ * @param out Fichero de salida.
+ * @param fmt Formato.
+ * @param args Argumentos.
+ * @param nargs Número de argumentos.
+ */
+static void format_log(FILE *out, const char *fmt, const uint32_t *args, uint32_t nargs) {
+    uint32_t next = 0;
+    while (*fmt) {
+        if (*fmt != '%') {
+            fputc(*fmt++, out);
+            continue;
+        }
+        if (fmt[1] == '%') {
+            fputc('%', out);
+            fmt += 2;
+            continue;
+        }
+
+        // Copia banderas, ancho y precisión; salta la longitud
+        char spec[32] = "%";
+        size_t n = 1;
+        fmt++;
+        while (*fmt && strchr("-+ #0123456789.", *fmt) && n < sizeof(spec) - 3) {
+            spec[n++] = *fmt++;
+        }
+        while (*fmt && strchr("hlLqjzt", *fmt)) {
+            fmt++;
+        }
+        char conv = *fmt ? *fmt++ : '\0';
+        if (next >= nargs || conv == '\0') {
+            fputs("<?>", out);
+            continue;
+        }
+        uint32_t arg = args[next++];
+        spec[n++] = conv;
+        spec[n] = '\0';
+        if (strchr("di", conv)) {
+            fprintf(out, spec, (int)(int32_t)arg);
+        } else if (strchr("uxXoc", conv)) {
+            fprintf(out, spec, (unsigned)arg);
+        } else if (strchr("fFeEgGaA", conv)) {
+            float value;
+            memcpy(&value, &arg, sizeof(value));
+            fprintf(out, spec, (double)value);
+        } else {
+            fputs("<?>", out);
+        }
+    }
+    fputc('\n', out);
+}
+
+/**
+ * @brief Escribe un mensaje DLOG, con su texto si se cargaron los formatos.
+ *
+ * @param out Fichero de salida.
+ * @param formats Formatos leídos del ELF.
+ * @param msg Mensaje recibido.
+ * @param nargs Número de argumentos del mensaje.
+ */
+static void log_row(FILE *out, const LogFormats *formats, const TelemetryLog *msg, uint32_t nargs) {
+    fprintf(out, "%10lu ", (unsigned long)msg->timestamp_us);
+    if (formats->data && msg->format_id >= formats->addr && msg->format_id - formats->addr < formats->size) {
+        uint32_t args[TELEMETRY_LOG_MAX_ARGS];
+        memcpy(args, msg->args, nargs * sizeof(uint32_t));
+        format_log(out, formats->data + (msg->format_id - formats->addr), args, nargs);
+        return;
+    }
+    fprintf(out, "[formato 0x%08lx]", (unsigned long)msg->format_id);
+    for (uint32_t i = 0; i < nargs; i++) {
+        fprintf(out, " 0x%08lx", (unsigned long)msg->args[i]);
+    }
+    fputc('\n', out);
+}
+
+/**
+ * @brief Escribe la cabecera de columnas de las tramas de control.
+ *
+ * @param out Fichero de salida.
+ */
+static void control_header(FILE *out) {
+    fprintf(out, "seq,timestamp_us,accel_x,accel_y,accel_z,pitch,filtered_pitch,output_pitch,output_roll,"
+                 "rc_cn1,rc_cn2,rc_cn4,rc_cn6,wing_right_us,wing_left_us,stabilize,cascade\n");
+}
+
+/**
+ * @brief Escribe la cabecera de columnas de las tramas de estado.
+ *
+ * @param out Fichero de salida.
+ */
+static void status_header(FILE *out) {
+    fprintf(out, "seq,timestamp_us,rc_cn1,rc_cn2,rc_cn4,rc_cn6,control_dt,control_max_us,control_misses,control_jitter_us,"
+                 "sensor_latency_us,sensor_overruns,telemetry_drops,roll,pitch,yaw,rate_setpoint,rate_measured,rate_max_us,"
+                 "rate_misses,ahrs_cycles,ahrs_cycles_max,accel_frac_bits,stabilize,cascade\n");
+}
+
+/**
+ * @brief Escribe una fila con una trama de control.
+ *
+ * @param out Fichero de salida.
+ * @param seq Secuencia de la trama.
+ * @param c Carga de la trama.
+ */
+static void control_row(FILE *out, uint16_t seq, const TelemetryControl *c) {
+    fprintf(out, "%u,%lu,%ld,%ld,%ld,%.4f,%.4f,%.4f,%.4f,%d,%d,%d,%d,%d,%d,%d,%d\n", seq,
+            (unsigned long)c->timestamp_us, (long)c->accel[0], (long)c->accel[1], (long)c->accel[2], c->pitch,
+            c->filtered_pitch, c->output_pitch, c->output_roll, c->rc_pulse[0], c->rc_pulse[1], c->rc_pulse[2],
+            c->rc_pulse[3], c->wing_right_us, c->wing_left_us, !!(c->flags & TELEMETRY_FLAG_STABILIZE),
+            !!(c->flags & TELEMETRY_FLAG_CASCADE));
+}
+
+/**
+ * @brief Escribe una fila con una trama de estado.
+ *
+ * @param out Fichero de salida.
+ * @param seq Secuencia de la trama.
+ * @param s Carga de la trama.
+ */
+static void status_row(FILE *out, uint16_t seq, const TelemetryStatus *s) {
+    fprintf(out, "%u,%lu,%d,%d,%d,%d,%.6f,%lu,%lu,%lu,%lu,%lu,%lu,%.4f,%.4f,%.4f,%.4f,%.4f,%lu,%lu,%lu,%lu,%u,%d,%d\n",
+            seq, (unsigned long)s->timestamp_us, s->rc_pulse[0], s->rc_pulse[1], s->rc_pulse[2], s->rc_pulse[3],
+            s->control_dt, (unsigned long)s->control_max_us, (unsigned long)s->control_misses,
+            (unsigned long)s->control_jitter_us, (unsigned long)s->sensor_latency_us, (unsigned long)s->sensor_overruns,
+            (unsigned long)s->telemetry_drops, s->roll, s->pitch, s->yaw, s->rate_setpoint, s->rate_measured,
+            (unsigned long)s->rate_max_us, (unsigned long)s->rate_misses, (unsigned long)s->ahrs_cycles,
+            (unsigned long)s->ahrs_cycles_max, s->accel_frac_bits,
+            !!(s->flags & TELEMETRY_FLAG_STABILIZE), !!(s->flags & TELEMETRY_FLAG_CASCADE));
+}
+
+/**
+ * @brief Guarda una trama de control en el contenedor, con los campos del registro de vuelo.
+ *
+ * @param flights Contenedor de salida.
+ * @param c Carga de la trama.
+ */
+static void flight_add(FlightLog *flights, const TelemetryControl *c) {
+    if (flights->have_time && c->timestamp_us - flights->last_timestamp_us > FLIGHT_GAP_US) {
+        flights->session++;
+    }
+    flights->have_time = true;
+    flights->last_timestamp_us = c->timestamp_us;
+
+    int32_t v[BLACKBOX_FIELDS] = {0};
+    v[BB_TIMESTAMP_US] = (int32_t)c->timestamp_us;
+    for (int i = 0; i < 4; i++) {
+        v[BB_RC_CN1 + i] = c->rc_pulse[i];
+    }
+    for (int i = 0; i < 3; i++) {
+        v[BB_ACCEL_X + i] = c->accel[i];
+    }
+    v[BB_PITCH_CDEG] = (int32_t)(c->pitch * 100.0f);
+    v[BB_FILTERED_CDEG] = (int32_t)(c->filtered_pitch * 100.0f);
+    v[BB_OUTPUT_PITCH_MILLI] = (int32_t)(c->output_pitch * 1000.0f);
+    v[BB_OUTPUT_ROLL_MILLI] = (int32_t)(c->output_roll * 1000.0f);
+    v[BB_WING_RIGHT_US] = c->wing_right_us;
+    v[BB_WING_LEFT_US] = c->wing_left_us;
+    bbl_writer_add(&flights->writer, flights->session, v);
+}
+
+/**
+ * @brief Intenta decodificar una trama al principio del buffer.
+ *
+ * @param buf Bytes pendientes; buf[0] y buf[1] son la sincronía.
+ * @param len Bytes disponibles.
+ * @param control Salida de las tramas de control.
+ * @param status Salida de las tramas de estado (puede ser NULL).
+ * @param log Salida de los mensajes DLOG.
+ * @param formats Formatos de los mensajes DLOG.
+ * @param flights Contenedor de las tramas de control (puede ser NULL).
+ * @param stats Contadores.
+ * @return Bytes consumidos: el tamaño de la trama si es válida, 0 si faltan bytes y
+ *         1 si no es una trama (se salta la sincronía falsa).
+ */
+static size_t decode_frame(const uint8_t *buf, size_t len, FILE *control, FILE *status, FILE *log,
+                           const LogFormats *formats, FlightLog *flights, DecodeStats *stats) {
+    if (len < TELEMETRY_HEADER_SIZE) {
+        return 0;
+    }
+    uint8_t type = buf[2];
+    uint8_t payload_len = buf[3];
+    if (payload_len > TELEMETRY_MAX_PAYLOAD) {
+        return 1;
+    }
+    size_t size = TELEMETRY_HEADER_SIZE + payload_len + TELEMETRY_CRC_SIZE;
+    if (len < size) {
+        return 0;
+    }
+
+    uint16_t crc = telemetry_crc16(0xFFFF, &buf[2], TELEMETRY_HEADER_SIZE - 2 + payload_len);
+    uint16_t frame_crc = buf[size - 2] | (buf[size - 1] << 8);
+    if (crc != frame_crc) {
+        stats->crc_errors++;
+        return 1;
+    }
+
+    uint16_t seq = buf[4] | (buf[5] << 8);
+    if (stats->have_seq) {
+        stats->lost += (uint16_t)(seq - stats->last_seq - 1);
+    }
+    stats->have_seq = true;
+    stats->last_seq = seq;
+    stats->frames++;
+
+    const uint8_t *payload = &buf[TELEMETRY_HEADER_SIZE];
+    if (type == TELEMETRY_TYPE_CONTROL && payload_len == sizeof(TelemetryControl)) {
+        TelemetryControl c;
+        memcpy(&c, payload, sizeof(c));
+        control_row(control, seq, &c);
+        if (flights) {
+            flight_add(flights, &c);
+        }
+    } else if (type == TELEMETRY_TYPE_STATUS && payload_len == sizeof(TelemetryStatus)) {
+        if (status) {
+            TelemetryStatus s;
+            memcpy(&s, payload, sizeof(s));
+            status_row(status, seq, &s);
+        }
+    } else if (type == TELEMETRY_TYPE_LOG && payload_len >= TELEMETRY_LOG_HEADER_SIZE &&
+               payload_len <= sizeof(TelemetryLog) && (payload_len - TELEMETRY_LOG_HEADER_SIZE) % 4 == 0) {
+        TelemetryLog msg;
+        memcpy(&msg, payload, payload_len);
+        log_row(log, formats, &msg, (payload_len - TELEMETRY_LOG_HEADER_SIZE) / 4);
+    } else {
+        stats->unknown++;
+    }
+    return size;
+}
+
+/**
+ * @brief Pone un puerto serie en modo crudo para que no traduzca ningún byte.
+ *
+ * @param fd Descriptor del puerto.
+ */
+static void serial_raw(int fd) {
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+}
+
+int main(int argc, char **argv) {
+    FILE *status = NULL;
+    FILE *log = stderr;
+    LogFormats formats = {0};
+    const char *input = NULL;
+    const char *container = NULL;
+    static FlightLog flights;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            status = fopen(argv[++i], "w");
+            if (!status) {
+                perror(argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            log = fopen(argv[++i], "w");
+            if (!log) {
+                perror(argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            container = argv[++i];
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            if (!load_formats(argv[++i], &formats)) {
+                return 1;
+            }
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            fprintf(stderr, "uso: %s [-s estado.csv] [-e myblink_w.elf] [-l depuracion.log] [-o vuelos.bbl] [entrada]\n",
+                    argv[0]);
+            return 1;
+        } else {
+            input = argv[i];
+        }
+    }
+
+    int fd = STDIN_FILENO;
+    if (input && strcmp(input, "-") != 0) {
+        fd = open(input, O_RDONLY | O_NOCTTY);
+        if (fd < 0) {
+            perror(input);
+            return 1;
+        }
+    }
+    if (isatty(fd)) {
+        serial_raw(fd);
+    }
+
+    if (container && !bbl_writer_open(&flights.writer, container)) {
+        return 1;
+    }
+    control_header(stdout);
+    if (status) {
+        status_header(status);
+    }
+
+    DecodeStats stats = {0};
+    static uint8_t buf[READ_CHUNK + FRAME_MAX];
+    size_t len = 0;
+    for (;;) {
+        ssize_t n = read(fd, buf + len, READ_CHUNK);
+        if (n <= 0) {
+            break;
+        }
+        len += (size_t)n;
+
+        size_t pos = 0;
+        while (pos < len) {
+            if (buf[pos] != TELEMETRY_SYNC0 || (pos + 1 < len && buf[pos + 1] != TELEMETRY_SYNC1)) {
+                stats.skipped++;
+                pos++;
+                continue;
+            }
+            size_t used = decode_frame(&buf[pos], len - pos, stdout, status, log, &formats,
+                                       container ? &flights : NULL, &stats);
+            if (used == 0) {
+                break; // Trama incompleta: se espera a la siguiente lectura
+            }
+            if (used == 1) {
+                stats.skipped++;
+            }
+            pos += used;
+        }
+        memmove(buf, buf + pos, len - pos);
+        len -= pos;
+    }
+    stats.skipped += len;
+
+    if (status) {
+        fclose(status);
+    }
+    if (log != stderr) {
+        fclose(log);
+    }
+    free(formats.data);
+    if (container && !bbl_writer_close(&flights.writer)) {
+        perror(container);
+        return 1;
+    }
+    fprintf(stderr, "tramas: %lu, errores de CRC: %lu, perdidas: %lu, tipo desconocido: %lu, bytes saltados: %lu\n",
+            stats.frames, stats.crc_errors, stats.lost, stats.unknown, stats.skipped);
+    return 0;
+}